@@ -8,6 +8,7 @@ import android.media.session.MediaSessionManager
 import android.media.session.PlaybackState
 import android.os.Handler
 import android.os.Looper
+import android.os.SystemClock
 import android.service.notification.NotificationListenerService
 
 class MediaNotificationListener : NotificationListenerService() {
@@ -179,12 +180,21 @@ class MediaNotificationListener : NotificationListenerService() {
         val position = state.position
         val duration = controller.metadata?.getLong(MediaMetadata.METADATA_KEY_DURATION) ?: 0L
         val playbackSpeed = state.playbackSpeed
+        // state.position was valid at lastPositionUpdateTime (elapsed realtime);
+        // Dart extrapolates from the same moment on the wall clock.
+        val now = System.currentTimeMillis()
+        val anchorTimestamp = if (state.lastPositionUpdateTime > 0) {
+            now - (SystemClock.elapsedRealtime() - state.lastPositionUpdateTime)
+        } else {
+            now
+        }
 
         positionCallback?.invoke(mapOf(
             "position" to position,
             "duration" to duration,
             "playbackSpeed" to playbackSpeed,
-            "state" to state.state.toPlaybackStateString()
+            "state" to state.state.toPlaybackStateString(),
+            "anchorTimestamp" to anchorTimestamp
         ))
     }
 
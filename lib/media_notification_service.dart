@@ -13,35 +13,93 @@ class MediaNotificationService {
   Stream<PositionInfo?> get positionStream =>
       MediaNotificationServicePlatform.instance.positionStream;
 
+  /// Position updates at the subscriber's own pace. Several subscribers can
+  /// ask for different rates; the platform runs at the fastest one and each
+  /// subscriber only sees what it asked for. Playback state changes are always
+  /// delivered.
+  Stream<PositionInfo?> positionStreamWith({
+    Duration interval = const Duration(milliseconds: 100),
+    bool alignToSecond = false,
+  }) => MediaNotificationServicePlatform.instance.positionStreamWithOptions(
+    PositionStreamOptions(interval: interval, alignToSecond: alignToSecond),
+  );
+
+  /// Position anchors instead of ticks: an update only when playback state,
+  /// speed, duration or the timeline changes, or when the player drifts
+  /// from the extrapolation. Read [PositionInfo.currentPosition] per frame to
+  /// animate between updates.
+  Stream<PositionInfo?> get positionAnchorStream =>
+      MediaNotificationServicePlatform.instance.positionStreamWithOptions(
+        const PositionStreamOptions(anchorsOnly: true),
+      );
+
   Stream<List<QueueItem?>> get queueStream =>
       MediaNotificationServicePlatform.instance.queueStream;
 
-  Future<MediaInfo?> getCurrentMedia() =>
-      MediaNotificationServicePlatform.instance.getCurrentMedia();
+  /// Every open media session, not just the current one. Each update is the
+  /// full list, rebuilt from the sessions that changed.
+  Stream<List<MediaSession>> get sessionsStream =>
+      MediaNotificationServicePlatform.instance.sessionsStream;
+
+  /// [albumArt] shapes this call's album art; see [setAlbumArtOptions].
+  Future<MediaInfo?> getCurrentMedia({AlbumArtOptions? albumArt}) =>
+      MediaNotificationServicePlatform.instance.getCurrentMedia(
+        albumArt: albumArt,
+      );
 
   Future<List<QueueItem?>> getQueue() =>
       MediaNotificationServicePlatform.instance.getQueue();
 
+  Future<List<MediaSession>> getSessions() =>
+      MediaNotificationServicePlatform.instance.getSessions();
+
   Future<bool> hasPermission() =>
       MediaNotificationServicePlatform.instance.hasPermission();
 
   Future<void> openSettings() =>
       MediaNotificationServicePlatform.instance.openSettings();
 
-  Future<bool> playPause() =>
-      MediaNotificationServicePlatform.instance.playPause();
+  /// The commands act on the current session, or with [sessionId] on that
+  /// [MediaSession.id].
+  Future<bool> playPause({String? sessionId}) =>
+      MediaNotificationServicePlatform.instance.playPause(
+        sessionId: sessionId,
+      );
 
-  Future<bool> skipToNext() =>
-      MediaNotificationServicePlatform.instance.skipToNext();
+  Future<bool> skipToNext({String? sessionId}) =>
+      MediaNotificationServicePlatform.instance.skipToNext(
+        sessionId: sessionId,
+      );
 
-  Future<bool> skipToPrevious() =>
-      MediaNotificationServicePlatform.instance.skipToPrevious();
+  Future<bool> skipToPrevious({String? sessionId}) =>
+      MediaNotificationServicePlatform.instance.skipToPrevious(
+        sessionId: sessionId,
+      );
 
-  Future<bool> stop() => MediaNotificationServicePlatform.instance.stop();
+  Future<bool> stop({String? sessionId}) =>
+      MediaNotificationServicePlatform.instance.stop(sessionId: sessionId);
 
-  Future<bool> seekTo(Duration position) =>
-      MediaNotificationServicePlatform.instance.seekTo(position);
+  Future<bool> seekTo(Duration position, {String? sessionId}) =>
+      MediaNotificationServicePlatform.instance.seekTo(
+        position,
+        sessionId: sessionId,
+      );
 
   Future<bool> skipToQueueItem(int id) =>
       MediaNotificationServicePlatform.instance.skipToQueueItem(id);
+
+  Future<bool> setTimeouts(Map<String, Duration> timeouts) =>
+      MediaNotificationServicePlatform.instance.setTimeouts(timeouts);
+
+  /// Size and format of the album art in [mediaStream], e.g.
+  /// [AlbumArtOptions.thumbnail] for a list tile. Each shape of each
+  /// thumbnail is made once and cached.
+  Future<bool> setAlbumArtOptions(AlbumArtOptions options) =>
+      MediaNotificationServicePlatform.instance.setAlbumArtOptions(options);
+
+  /// How long [mediaStream] waits for a burst of changes, e.g. a track
+  /// change published piece by piece, to settle before it reads the track.
+  /// [MediaSettleOptions.none] reads on every change.
+  Future<bool> setMediaSettleOptions(MediaSettleOptions options) =>
+      MediaNotificationServicePlatform.instance.setMediaSettleOptions(options);
 }
@@ -1,3 +1,5 @@
+import 'dart:async';
+
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 
@@ -26,30 +28,179 @@ class MediaNotificationServiceMethodChannel
     'com.example.media_notification_service/queue_stream',
   );
 
+  @visibleForTesting
+  static const sessionsEventChannel = EventChannel(
+    'com.example.media_notification_service/sessions_stream',
+  );
+
   Stream<MediaInfoWithQueue?>? _mediaStream;
-  Stream<PositionInfo?>? _positionStream;
+  // Sent with every listen, so a new native subscription keeps the album
+  // art options.
+  final Map<String, dynamic> _mediaListenArguments = {'delta': true};
   Stream<List<QueueItem?>>? _queueStream;
+  Stream<List<MediaSession>>? _sessionsStream;
+  // Every session by id, rebuilt from keyframes and changes.
+  final Map<String, MediaSession> _sessions = {};
+
+  // The event channel carries a single native subscription, so every position
+  // subscriber shares it and the native side runs at their merged options.
+  final Map<Object, PositionStreamOptions> _positionSubscribers = {};
+  final StreamController<PositionInfo?> _positionEvents =
+      StreamController<PositionInfo?>.broadcast();
+  StreamSubscription<dynamic>? _nativePositionSubscription;
+  PositionStreamOptions? _nativePositionOptions;
+
+  // The media state rebuilt from delta events, and the sequence number of
+  // the last one applied.
+  Map<dynamic, dynamic>? _mediaState;
+  int? _mediaSequence;
 
   @override
   Stream<MediaInfoWithQueue?> get mediaStream {
-    _mediaStream ??= mediaEventChannel.receiveBroadcastStream().map((event) {
-      if (event == null) return null;
-      final map = event as Map;
-      return MediaInfoWithQueue.fromMap(map);
-    });
+    _mediaStream ??= mediaEventChannel
+        .receiveBroadcastStream(_mediaListenArguments)
+        .expand((event) {
+          if (event == null) {
+            _mediaState = null;
+            _mediaSequence = null;
+            return const <MediaInfoWithQueue?>[null];
+          }
+          final map = _applyMediaEvent(event as Map);
+          // Nothing to show while waiting for a keyframe.
+          return map == null
+              ? const <MediaInfoWithQueue?>[]
+              : [MediaInfoWithQueue.fromMap(map)];
+        });
     return _mediaStream!;
   }
 
+  // Platforms without delta support send full maps, minus the album art when
+  // it is flagged unchanged. Delta events carry {seq, keyframe, set, removed};
+  // a gap in seq means one was missed, so the state is only trusted again
+  // from the next keyframe. Every listener runs this for the same event, so
+  // applying one twice is a no-op.
+  Map<dynamic, dynamic>? _applyMediaEvent(Map<dynamic, dynamic> event) {
+    if (!event.containsKey('seq')) {
+      if (event['albumArtUnchanged'] == true &&
+          !event.containsKey('albumArt')) {
+        event = Map.of(event)..['albumArt'] = _mediaState?['albumArt'];
+      }
+      return _mediaState = event;
+    }
+
+    final sequence = event['seq'] as int;
+    if (sequence == _mediaSequence) return _mediaState;
+
+    final changes = event['set'] as Map;
+    if (event['keyframe'] == true) {
+      _mediaState = Map.of(changes);
+    } else if (_mediaState != null && sequence == _mediaSequence! + 1) {
+      _mediaState!
+        ..remove('songChanged')
+        ..remove('albumArtUnchanged')
+        ..addAll(changes);
+      for (final key in event['removed'] as List) {
+        _mediaState!.remove(key);
+      }
+    } else {
+      _mediaState = null;
+      methodChannel.invokeMethod('requestMediaKeyframe').catchError((e) {
+        print("Failed to request a media keyframe: $e");
+      });
+    }
+    _mediaSequence = sequence;
+    return _mediaState;
+  }
+
   @override
-  Stream<PositionInfo?> get positionStream {
-    _positionStream ??= positionEventChannel.receiveBroadcastStream().map((
-      event,
-    ) {
-      if (event == null) return null;
-      final map = event as Map;
-      return PositionInfo.fromMap(map);
-    });
-    return _positionStream!;
+  Stream<PositionInfo?> get positionStream =>
+      positionStreamWithOptions(const PositionStreamOptions());
+
+  @override
+  Stream<PositionInfo?> positionStreamWithOptions(
+    PositionStreamOptions options,
+  ) {
+    final key = Object();
+    StreamSubscription<PositionInfo?>? subscription;
+    late final StreamController<PositionInfo?> controller;
+    controller = StreamController<PositionInfo?>.broadcast(
+      onListen: () {
+        _positionSubscribers[key] = options;
+        subscription = _positionEvents.stream
+            .where(_positionFilter(options))
+            .listen(controller.add, onError: controller.addError);
+        _updateNativePositionStream();
+      },
+      onCancel: () async {
+        _positionSubscribers.remove(key);
+        _updateNativePositionStream();
+        await subscription?.cancel();
+      },
+    );
+    return controller.stream;
+  }
+
+  void _updateNativePositionStream() {
+    if (_positionSubscribers.isEmpty) {
+      _nativePositionSubscription?.cancel();
+      _nativePositionSubscription = null;
+      _nativePositionOptions = null;
+      return;
+    }
+
+    final merged = PositionStreamOptions.merge(_positionSubscribers.values);
+    if (_nativePositionSubscription == null) {
+      _nativePositionSubscription = positionEventChannel
+          .receiveBroadcastStream(merged.toMap())
+          .listen((event) {
+            _positionEvents.add(
+              event == null ? null : PositionInfo.fromMap(event as Map),
+            );
+          }, onError: _positionEvents.addError);
+    } else if (merged != _nativePositionOptions) {
+      methodChannel
+          .invokeMethod('setPositionOptions', merged.toMap())
+          .catchError((e) {
+            print("Failed to set position options: $e");
+          });
+    }
+    _nativePositionOptions = merged;
+  }
+
+  // Drops the updates a subscriber did not ask for; state changes always
+  // pass.
+  static bool Function(PositionInfo?) _positionFilter(
+    PositionStreamOptions options,
+  ) {
+    PositionInfo? last;
+    final sinceLast = Stopwatch();
+    return (info) {
+      final previous = last;
+      final bool wanted;
+      if (info == null || previous == null || info.state != previous.state) {
+        wanted = true;
+      } else if (options.anchorsOnly) {
+        // Same test as the Windows side, for when another subscriber keeps
+        // the platform ticking.
+        final drift =
+            info.position - previous.positionAt(info.anchorTimestamp);
+        wanted = info.playbackSpeed != previous.playbackSpeed ||
+            info.duration != previous.duration ||
+            drift.abs() > PositionStreamOptions.anchorDriftThreshold;
+      } else if (options.alignToSecond) {
+        wanted = info.position.inSeconds != previous.position.inSeconds;
+      } else {
+        // Allow some jitter so a tick arriving slightly early is not lost.
+        wanted = sinceLast.elapsed >= options.interval * 0.9;
+      }
+      if (wanted) {
+        last = info;
+        sinceLast
+          ..reset()
+          ..start();
+      }
+      return wanted;
+    };
   }
 
   @override
@@ -63,10 +214,30 @@ class MediaNotificationServiceMethodChannel
   }
 
   @override
-  Future<MediaInfo?> getCurrentMedia() async {
+  Stream<List<MediaSession>> get sessionsStream {
+    _sessionsStream ??= sessionsEventChannel.receiveBroadcastStream().map((
+      event,
+    ) {
+      final map = event as Map;
+      if (map['keyframe'] == true) _sessions.clear();
+      for (final id in map['removed'] as List) {
+        _sessions.remove(id);
+      }
+      for (final session in map['sessions'] as List) {
+        final parsed = MediaSession.fromMap(session as Map);
+        _sessions[parsed.id] = parsed;
+      }
+      return List.unmodifiable(_sessions.values);
+    });
+    return _sessionsStream!;
+  }
+
+  @override
+  Future<MediaInfo?> getCurrentMedia({AlbumArtOptions? albumArt}) async {
     try {
       final Map<dynamic, dynamic>? result = await methodChannel.invokeMethod(
         'getCurrentMedia',
+        albumArt?.toMap(),
       );
       if (result == null) return null;
       return MediaInfo.fromMap(result);
@@ -90,6 +261,20 @@ class MediaNotificationServiceMethodChannel
     }
   }
 
+  @override
+  Future<List<MediaSession>> getSessions() async {
+    try {
+      final List<dynamic>? result = await methodChannel.invokeMethod(
+        'getSessions',
+      );
+      if (result == null) return [];
+      return result.map((e) => MediaSession.fromMap(e as Map)).toList();
+    } catch (e) {
+      print("Failed to get sessions: $e");
+      return [];
+    }
+  }
+
   @override
   Future<bool> hasPermission() async {
     try {
@@ -110,9 +295,12 @@ class MediaNotificationServiceMethodChannel
   }
 
   @override
-  Future<bool> playPause() async {
+  Future<bool> playPause({String? sessionId}) async {
     try {
-      final bool result = await methodChannel.invokeMethod('playPause');
+      final bool result = await methodChannel.invokeMethod(
+        'playPause',
+        _sessionArguments(sessionId),
+      );
       return result;
     } catch (e) {
       print("Failed to play/pause: $e");
@@ -121,9 +309,12 @@ class MediaNotificationServiceMethodChannel
   }
 
   @override
-  Future<bool> skipToNext() async {
+  Future<bool> skipToNext({String? sessionId}) async {
     try {
-      final bool result = await methodChannel.invokeMethod('skipToNext');
+      final bool result = await methodChannel.invokeMethod(
+        'skipToNext',
+        _sessionArguments(sessionId),
+      );
       return result;
     } catch (e) {
       print("Failed to skip to next: $e");
@@ -132,9 +323,12 @@ class MediaNotificationServiceMethodChannel
   }
 
   @override
-  Future<bool> skipToPrevious() async {
+  Future<bool> skipToPrevious({String? sessionId}) async {
     try {
-      final bool result = await methodChannel.invokeMethod('skipToPrevious');
+      final bool result = await methodChannel.invokeMethod(
+        'skipToPrevious',
+        _sessionArguments(sessionId),
+      );
       return result;
     } catch (e) {
       print("Failed to skip to previous: $e");
@@ -143,9 +337,12 @@ class MediaNotificationServiceMethodChannel
   }
 
   @override
-  Future<bool> stop() async {
+  Future<bool> stop({String? sessionId}) async {
     try {
-      final bool result = await methodChannel.invokeMethod('stop');
+      final bool result = await methodChannel.invokeMethod(
+        'stop',
+        _sessionArguments(sessionId),
+      );
       return result;
     } catch (e) {
       print("Failed to stop: $e");
@@ -154,10 +351,11 @@ class MediaNotificationServiceMethodChannel
   }
 
   @override
-  Future<bool> seekTo(Duration position) async {
+  Future<bool> seekTo(Duration position, {String? sessionId}) async {
     try {
       final bool result = await methodChannel.invokeMethod('seekTo', {
         'position': position.inMilliseconds,
+        ...?_sessionArguments(sessionId),
       });
       return result;
     } catch (e) {
@@ -166,6 +364,9 @@ class MediaNotificationServiceMethodChannel
     }
   }
 
+  static Map<String, dynamic>? _sessionArguments(String? sessionId) =>
+      sessionId == null ? null : {'sessionId': sessionId};
+
   @override
   Future<bool> skipToQueueItem(int id) async {
     try {
@@ -178,4 +379,48 @@ class MediaNotificationServiceMethodChannel
       return false;
     }
   }
+
+  @override
+  Future<bool> setTimeouts(Map<String, Duration> timeouts) async {
+    try {
+      final bool result = await methodChannel.invokeMethod('setTimeouts', {
+        for (final entry in timeouts.entries)
+          entry.key: entry.value.inMilliseconds,
+      });
+      return result;
+    } catch (e) {
+      print("Failed to set timeouts: $e");
+      return false;
+    }
+  }
+
+  @override
+  Future<bool> setAlbumArtOptions(AlbumArtOptions options) async {
+    _mediaListenArguments.addAll(options.toMap());
+    try {
+      final bool result = await methodChannel.invokeMethod(
+        'setAlbumArtOptions',
+        options.toMap(),
+      );
+      return result;
+    } catch (e) {
+      print("Failed to set album art options: $e");
+      return false;
+    }
+  }
+
+  @override
+  Future<bool> setMediaSettleOptions(MediaSettleOptions options) async {
+    _mediaListenArguments.addAll(options.toMap());
+    try {
+      final bool result = await methodChannel.invokeMethod(
+        'setMediaSettleOptions',
+        options.toMap(),
+      );
+      return result;
+    } catch (e) {
+      print("Failed to set media settle options: $e");
+      return false;
+    }
+  }
 }
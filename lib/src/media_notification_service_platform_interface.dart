@@ -27,12 +27,24 @@ abstract class MediaNotificationServicePlatform extends PlatformInterface {
     throw UnimplementedError('positionStream has not been implemented.');
   }
 
+  Stream<PositionInfo?> positionStreamWithOptions(
+    PositionStreamOptions options,
+  ) {
+    throw UnimplementedError(
+      'positionStreamWithOptions() has not been implemented.',
+    );
+  }
+
   Stream<List<QueueItem?>> get queueStream {
     throw UnimplementedError('queueStream has not been implemented.');
   }
 
+  Stream<List<MediaSession>> get sessionsStream {
+    throw UnimplementedError('sessionsStream has not been implemented.');
+  }
+
   // methods
-  Future<MediaInfo?> getCurrentMedia() {
+  Future<MediaInfo?> getCurrentMedia({AlbumArtOptions? albumArt}) {
     throw UnimplementedError('getCurrentMedia() has not been implemented.');
   }
 
@@ -40,6 +52,10 @@ abstract class MediaNotificationServicePlatform extends PlatformInterface {
     throw UnimplementedError('getQueue() has not been implemented.');
   }
 
+  Future<List<MediaSession>> getSessions() {
+    throw UnimplementedError('getSessions() has not been implemented.');
+  }
+
   Future<bool> hasPermission() {
     throw UnimplementedError('hasPermission() has not been implemented.');
   }
@@ -48,27 +64,41 @@ abstract class MediaNotificationServicePlatform extends PlatformInterface {
     throw UnimplementedError('openSettings() has not been implemented.');
   }
 
-  Future<bool> playPause() {
+  Future<bool> playPause({String? sessionId}) {
     throw UnimplementedError('playPause() has not been implemented.');
   }
 
-  Future<bool> skipToNext() {
+  Future<bool> skipToNext({String? sessionId}) {
     throw UnimplementedError('skipToNext() has not been implemented.');
   }
 
-  Future<bool> skipToPrevious() {
+  Future<bool> skipToPrevious({String? sessionId}) {
     throw UnimplementedError('skipToPrevious() has not been implemented.');
   }
 
-  Future<bool> stop() {
+  Future<bool> stop({String? sessionId}) {
     throw UnimplementedError('stop() has not been implemented.');
   }
 
-  Future<bool> seekTo(Duration position) {
+  Future<bool> seekTo(Duration position, {String? sessionId}) {
     throw UnimplementedError('seekTo() has not been implemented.');
   }
 
   Future<bool> skipToQueueItem(int id) {
     throw UnimplementedError('skipToQueueItem() has not been implemented.');
   }
+
+  Future<bool> setTimeouts(Map<String, Duration> timeouts) {
+    throw UnimplementedError('setTimeouts() has not been implemented.');
+  }
+
+  Future<bool> setAlbumArtOptions(AlbumArtOptions options) {
+    throw UnimplementedError('setAlbumArtOptions() has not been implemented.');
+  }
+
+  Future<bool> setMediaSettleOptions(MediaSettleOptions options) {
+    throw UnimplementedError(
+      'setMediaSettleOptions() has not been implemented.',
+    );
+  }
 }
@@ -1,3 +1,4 @@
+import 'dart:io';
 import 'dart:typed_data';
 
 enum PlaybackState {
@@ -64,6 +65,10 @@ class MediaInfo {
   final int? queueIndex;
   final String? packageName;
   final Uint8List? albumArt;
+
+  /// Where to read the album art instead of [albumArt], with
+  /// [AlbumArtDelivery.file].
+  final AlbumArtFile? albumArtFile;
   final bool isPlaying;
   final PlaybackState state;
 
@@ -74,6 +79,7 @@ class MediaInfo {
     this.queueIndex,
     this.packageName,
     this.albumArt,
+    this.albumArtFile,
     this.isPlaying = false,
     this.state = PlaybackState.none,
   });
@@ -95,6 +101,9 @@ class MediaInfo {
       queueIndex: map['queueIndex'] as int?,
       packageName: map['packageName'] as String?,
       albumArt: updateArt ? map['albumArt'] as Uint8List? : oldMedia?.albumArt,
+      albumArtFile: updateArt
+          ? AlbumArtFile.fromMap(map['albumArtFile'] as Map?)
+          : oldMedia?.albumArtFile,
       isPlaying: map['isPlaying'] as bool? ?? false,
       state: PlaybackState.fromString(map['state'] as String?),
     );
@@ -107,6 +116,7 @@ class MediaInfo {
     int? queueIndex,
     String? packageName,
     Uint8List? albumArt,
+    AlbumArtFile? albumArtFile,
     bool? isPlaying,
     PlaybackState? state,
   }) {
@@ -117,6 +127,7 @@ class MediaInfo {
       queueIndex: queueIndex ?? this.queueIndex,
       packageName: packageName ?? this.packageName,
       albumArt: albumArt ?? this.albumArt,
+      albumArtFile: albumArtFile ?? this.albumArtFile,
       isPlaying: isPlaying ?? this.isPlaying,
       state: state ?? this.state,
     );
@@ -128,6 +139,50 @@ class MediaInfo {
   }
 }
 
+/// One media session among all those open, e.g. a browser tab next to a
+/// music player. [id] is the app that owns it and targets it in commands.
+class MediaSession {
+  final String id;
+  final String? title;
+  final String? artist;
+  final String? album;
+  final bool isPlaying;
+  final PlaybackState state;
+
+  const MediaSession({
+    required this.id,
+    this.title,
+    this.artist,
+    this.album,
+    this.isPlaying = false,
+    this.state = PlaybackState.none,
+  });
+
+  factory MediaSession.fromMap(Map<dynamic, dynamic> map) {
+    return MediaSession(
+      id: map['id'] as String,
+      title: map['title'] as String?,
+      artist: map['artist'] as String?,
+      album: map['album'] as String?,
+      isPlaying: map['isPlaying'] as bool? ?? false,
+      state: PlaybackState.fromString(map['state'] as String?),
+    );
+  }
+
+  @override
+  bool operator ==(Object other) =>
+      other is MediaSession &&
+      other.id == id &&
+      other.title == title &&
+      other.artist == artist &&
+      other.album == album &&
+      other.isPlaying == isPlaying &&
+      other.state == state;
+
+  @override
+  int get hashCode => Object.hash(id, title, artist, album, isPlaying, state);
+}
+
 class MediaInfoWithQueue {
   final MediaInfo mediaInfo;
   final QueueItem? nextItem;
@@ -197,22 +252,50 @@ class PositionInfo {
   final double playbackSpeed;
   final PlaybackState state;
 
+  /// When [position] was valid. While playing, the position keeps moving
+  /// from there at [playbackSpeed]; see [positionAt].
+  final DateTime anchorTimestamp;
+
   PositionInfo({
     required this.position,
     required this.duration,
     this.playbackSpeed = 1.0,
     this.state = PlaybackState.none,
-  });
+    DateTime? anchorTimestamp,
+  }) : anchorTimestamp = anchorTimestamp ?? DateTime.now();
 
   factory PositionInfo.fromMap(Map<dynamic, dynamic> map) {
+    final anchor = map['anchorTimestamp'] as int?;
     return PositionInfo(
       position: Duration(milliseconds: map['position'] as int? ?? 0),
       duration: Duration(milliseconds: map['duration'] as int? ?? 0),
       playbackSpeed: (map['playbackSpeed'] as num?)?.toDouble() ?? 1.0,
       state: PlaybackState.fromString(map['state'] as String?),
+      anchorTimestamp: anchor == null
+          ? null
+          : DateTime.fromMillisecondsSinceEpoch(anchor),
     );
   }
 
+  bool get isAdvancing => state == PlaybackState.playing && playbackSpeed > 0;
+
+  /// The position at [time], extrapolated from the anchor while playing and
+  /// capped at [duration].
+  Duration positionAt(DateTime time) {
+    if (!isAdvancing) return position;
+    final elapsed = time.difference(anchorTimestamp).inMicroseconds;
+    var extrapolated =
+        position + Duration(microseconds: (elapsed * playbackSpeed).round());
+    if (duration > Duration.zero && extrapolated > duration) {
+      extrapolated = duration;
+    }
+    return extrapolated < Duration.zero ? Duration.zero : extrapolated;
+  }
+
+  /// The position right now. Cheap enough to call on every frame, e.g. from a
+  /// Ticker, between updates of [MediaNotificationService.positionAnchorStream].
+  Duration get currentPosition => positionAt(DateTime.now());
+
   double get progress {
     if (duration.inMilliseconds == 0) return 0.0;
     return (position.inMilliseconds / duration.inMilliseconds).clamp(0.0, 1.0);
@@ -220,6 +303,225 @@ class PositionInfo {
 
   @override
   String toString() {
-    return 'PositionInfo(position: $position, duration: $duration, speed: $playbackSpeed)';
+    return 'PositionInfo(position: $position, duration: $duration, speed: $playbackSpeed, anchor: $anchorTimestamp)';
+  }
+}
+
+/// How often a position stream subscriber wants updates.
+class PositionStreamOptions {
+  /// Time between updates while playing.
+  final Duration interval;
+
+  /// Update when the displayed second changes (the position crosses a whole
+  /// second) instead of every [interval]. Suits mm:ss displays.
+  final bool alignToSecond;
+
+  /// Only send updates that change where [PositionInfo.positionAt] puts
+  /// playback: state, speed or duration changes, seeks, and corrections once
+  /// the player drifts from the extrapolation by more than
+  /// [anchorDriftThreshold]. Overrides [interval] and [alignToSecond].
+  final bool anchorsOnly;
+
+  static const anchorDriftThreshold = Duration(milliseconds: 250);
+
+  const PositionStreamOptions({
+    this.interval = const Duration(milliseconds: 100),
+    this.alignToSecond = false,
+    this.anchorsOnly = false,
+  });
+
+  /// The options that satisfy every subscriber: the shortest interval,
+  /// second alignment only if every ticking subscriber asked for it, and
+  /// anchors only if everyone did.
+  factory PositionStreamOptions.merge(Iterable<PositionStreamOptions> all) {
+    final ticking = all.where((o) => !o.anchorsOnly).toList();
+    if (ticking.isEmpty) {
+      return const PositionStreamOptions(anchorsOnly: true);
+    }
+    final fixed = ticking.where((o) => !o.alignToSecond).toList();
+    if (fixed.isEmpty) {
+      return const PositionStreamOptions(alignToSecond: true);
+    }
+    return PositionStreamOptions(
+      interval: fixed
+          .map((o) => o.interval)
+          .reduce((a, b) => a < b ? a : b),
+    );
   }
+
+  Map<String, dynamic> toMap() {
+    return {
+      'intervalMs': interval.inMilliseconds,
+      'alignToSecond': alignToSecond,
+      'anchorsOnly': anchorsOnly,
+    };
+  }
+
+  @override
+  bool operator ==(Object other) =>
+      other is PositionStreamOptions &&
+      other.interval == interval &&
+      other.alignToSecond == alignToSecond &&
+      other.anchorsOnly == anchorsOnly;
+
+  @override
+  int get hashCode => Object.hash(interval, alignToSecond, anchorsOnly);
+}
+
+enum AlbumArtFormat { original, png, jpeg }
+
+enum AlbumArtDelivery {
+  /// The image travels in the event as [MediaInfo.albumArt].
+  bytes,
+
+  /// The image is written once to a native file store and the event carries
+  /// only [MediaInfo.albumArtFile]. Falls back to [bytes] when the store is
+  /// unavailable.
+  file,
+}
+
+/// The shape album art should arrive in. Shrinking and re-encoding happen
+/// natively, so a small tile never makes Dart decode a 1500×1500 image.
+class AlbumArtOptions {
+  /// Longest side in pixels; 0 keeps the size the media app published.
+  /// Never enlarges.
+  final int maxDimension;
+
+  /// [AlbumArtFormat.original] keeps a PNG or JPEG as it is, and re-encodes
+  /// anything else as PNG when it has to be resized.
+  final AlbumArtFormat format;
+
+  final AlbumArtDelivery delivery;
+
+  const AlbumArtOptions({
+    this.maxDimension = 0,
+    this.format = AlbumArtFormat.original,
+    this.delivery = AlbumArtDelivery.bytes,
+  });
+
+  static const original = AlbumArtOptions();
+  static const thumbnail = AlbumArtOptions(maxDimension: 96);
+  static const small = AlbumArtOptions(maxDimension: 256);
+  static const medium = AlbumArtOptions(maxDimension: 512);
+  static const large = AlbumArtOptions(maxDimension: 1024);
+
+  Map<String, dynamic> toMap() {
+    return {
+      'artSize': maxDimension,
+      'artFormat': format.name,
+      'artDelivery': delivery.name,
+    };
+  }
+
+  @override
+  bool operator ==(Object other) =>
+      other is AlbumArtOptions &&
+      other.maxDimension == maxDimension &&
+      other.format == format &&
+      other.delivery == delivery;
+
+  @override
+  int get hashCode => Object.hash(maxDimension, format, delivery);
+}
+
+/// How long `mediaStream` lets a burst of media events settle before it
+/// reads the media app. Browsers publish a track change piece by piece
+/// (title, artist, then the thumbnail), and a read in between would show a
+/// half-filled track.
+class MediaSettleOptions {
+  /// Quiet time after the last event before the burst counts as settled.
+  /// [Duration.zero] reads on every event.
+  final Duration window;
+
+  /// Read on the first event of a burst too, before it settles.
+  final bool leading;
+
+  /// Read once the burst settles.
+  final bool trailing;
+
+  /// Longest an event waits while events keep coming; [Duration.zero] for no
+  /// limit.
+  final Duration maxWait;
+
+  const MediaSettleOptions({
+    this.window = const Duration(milliseconds: 250),
+    this.leading = false,
+    this.trailing = true,
+    this.maxWait = const Duration(seconds: 1),
+  });
+
+  static const none = MediaSettleOptions(window: Duration.zero);
+
+  Map<String, dynamic> toMap() {
+    return {
+      'settleWindowMs': window.inMilliseconds,
+      'settleLeading': leading,
+      'settleTrailing': trailing,
+      'settleMaxWaitMs': maxWait.inMilliseconds,
+    };
+  }
+
+  @override
+  bool operator ==(Object other) =>
+      other is MediaSettleOptions &&
+      other.window == window &&
+      other.leading == leading &&
+      other.trailing == trailing &&
+      other.maxWait == maxWait;
+
+  @override
+  int get hashCode => Object.hash(window, leading, trailing, maxWait);
+}
+
+/// Album art left in a native file: [length] bytes at [offset] of [path].
+/// [hash] identifies the image, so it doubles as an image cache key. The
+/// file may be gone once newer art has pushed it out of the store; [read]
+/// then returns null and the next media event carries a fresh reference.
+class AlbumArtFile {
+  final String path;
+  final int offset;
+  final int length;
+  final int hash;
+
+  const AlbumArtFile({
+    required this.path,
+    required this.offset,
+    required this.length,
+    required this.hash,
+  });
+
+  static AlbumArtFile? fromMap(Map<dynamic, dynamic>? map) {
+    if (map == null) return null;
+    return AlbumArtFile(
+      path: map['path'] as String,
+      offset: map['offset'] as int,
+      length: map['length'] as int,
+      hash: map['hash'] as int,
+    );
+  }
+
+  Future<Uint8List?> read() async {
+    RandomAccessFile? file;
+    try {
+      file = await File(path).open();
+      await file.setPosition(offset);
+      final bytes = await file.read(length);
+      return bytes.length == length ? bytes : null;
+    } on FileSystemException {
+      return null;
+    } finally {
+      await file?.close();
+    }
+  }
+
+  @override
+  bool operator ==(Object other) =>
+      other is AlbumArtFile &&
+      other.path == path &&
+      other.offset == offset &&
+      other.length == length &&
+      other.hash == hash;
+
+  @override
+  int get hashCode => Object.hash(path, offset, length, hash);
 }
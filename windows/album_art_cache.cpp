@@ -0,0 +1,73 @@
+#include "album_art_cache.h"
+
+#include <utility>
+
+namespace media_notification_service
+{
+    AlbumArtCache::AlbumArtCache(size_t byte_budget) : byte_budget_(byte_budget) {}
+
+    std::string AlbumArtCache::MakeKey(const AlbumArtKey &key)
+    {
+        // Unit separators keep ("ab", "c") and ("a", "bc") apart.
+        std::string joined;
+        joined.reserve(key.source_app_id.size() + key.title.size() + key.artist.size() + key.album.size() + key.variant.size() + 4);
+        joined.append(key.source_app_id).push_back('\x1f');
+        joined.append(key.title).push_back('\x1f');
+        joined.append(key.artist).push_back('\x1f');
+        joined.append(key.album).push_back('\x1f');
+        joined.append(key.variant);
+        return joined;
+    }
+
+    bool AlbumArtCache::Lookup(const AlbumArtKey &key, std::vector<uint8_t> &bytes)
+    {
+        auto it = index_.find(MakeKey(key));
+        if (it == index_.end())
+        {
+            ++misses_;
+            return false;
+        }
+
+        entries_.splice(entries_.begin(), entries_, it->second);
+        bytes = it->second->bytes;
+        ++hits_;
+        bytes_saved_ += bytes.size();
+        return true;
+    }
+
+    void AlbumArtCache::Insert(const AlbumArtKey &key, std::vector<uint8_t> bytes)
+    {
+        std::string joined = MakeKey(key);
+
+        auto existing = index_.find(joined);
+        if (existing != index_.end())
+        {
+            size_bytes_ -= existing->second->bytes.size();
+            entries_.erase(existing->second);
+            index_.erase(existing);
+        }
+
+        if (bytes.size() > byte_budget_)
+        {
+            return;
+        }
+
+        EvictToFit(bytes.size());
+        size_bytes_ += bytes.size();
+        entries_.push_front(Entry{joined, std::move(bytes)});
+        index_.emplace(std::move(joined), entries_.begin());
+    }
+
+    void AlbumArtCache::EvictToFit(size_t incoming)
+    {
+        while (!entries_.empty() && size_bytes_ + incoming > byte_budget_)
+        {
+            auto &oldest = entries_.back();
+            size_bytes_ -= oldest.bytes.size();
+            index_.erase(oldest.key);
+            entries_.pop_back();
+            ++evictions_;
+        }
+    }
+
+} // namespace media_notification_service
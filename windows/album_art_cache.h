@@ -0,0 +1,77 @@
+#ifndef ALBUM_ART_CACHE_H_
+#define ALBUM_ART_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace media_notification_service
+{
+    // Which track a thumbnail belongs to.
+    struct AlbumArtKey
+    {
+        std::string source_app_id;
+        std::string title;
+        std::string artist;
+        std::string album;
+        // Empty for the thumbnail as read; otherwise which resized or
+        // re-encoded copy of it.
+        std::string variant;
+
+        bool operator==(const AlbumArtKey &) const = default;
+    };
+
+    // Thumbnails already read from the media app, so refreshes of the same
+    // track (play/pause, getCurrentMedia) do not read them again. Least
+    // recently used entries go first once |byte_budget| is exceeded. Not
+    // synchronized; the owner keeps it on one thread.
+    class AlbumArtCache
+    {
+    public:
+        explicit AlbumArtCache(size_t byte_budget);
+
+        AlbumArtCache(const AlbumArtCache &) = delete;
+        AlbumArtCache &operator=(const AlbumArtCache &) = delete;
+
+        // Copies the art for |key| into |bytes| and returns true if cached.
+        bool Lookup(const AlbumArtKey &key, std::vector<uint8_t> &bytes);
+
+        // Art larger than the whole budget is not kept.
+        void Insert(const AlbumArtKey &key, std::vector<uint8_t> bytes);
+
+        size_t SizeBytes() const { return size_bytes_; }
+        size_t EntryCount() const { return entries_.size(); }
+        uint64_t HitCount() const { return hits_; }
+        uint64_t MissCount() const { return misses_; }
+        // Bytes that hits did not have to read from the media app.
+        uint64_t BytesSaved() const { return bytes_saved_; }
+        uint64_t EvictionCount() const { return evictions_; }
+
+    private:
+        struct Entry
+        {
+            std::string key;
+            std::vector<uint8_t> bytes;
+        };
+
+        static std::string MakeKey(const AlbumArtKey &key);
+        void EvictToFit(size_t incoming);
+
+        size_t byte_budget_;
+        size_t size_bytes_ = 0;
+        // Most recently used first.
+        std::list<Entry> entries_;
+        std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+
+        uint64_t hits_ = 0;
+        uint64_t misses_ = 0;
+        uint64_t bytes_saved_ = 0;
+        uint64_t evictions_ = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // ALBUM_ART_CACHE_H_
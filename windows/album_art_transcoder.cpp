@@ -0,0 +1,182 @@
+#include "album_art_transcoder.h"
+#include "image_resize.h"
+
+#include <objbase.h>
+
+#include <utility>
+
+namespace media_notification_service
+{
+    namespace
+    {
+        constexpr float kJpegQuality = 0.85f;
+
+        GUID EncoderContainer(ArtFormat format, const GUID &decoded)
+        {
+            switch (format)
+            {
+            case ArtFormat::Png:
+                return GUID_ContainerFormatPng;
+            case ArtFormat::Jpeg:
+                return GUID_ContainerFormatJpeg;
+            case ArtFormat::Original:
+                break;
+            }
+            if (IsEqualGUID(decoded, GUID_ContainerFormatJpeg))
+            {
+                return GUID_ContainerFormatJpeg;
+            }
+            return GUID_ContainerFormatPng;
+        }
+    } // namespace
+
+    std::string ArtRequest::VariantName() const
+    {
+        static const char *const kFormatNames[] = {"original", "png", "jpeg"};
+        return std::to_string(max_dimension) + "/" + kFormatNames[static_cast<int>(format)];
+    }
+
+    std::optional<uint32_t> ArtSizePreset(const std::string &name)
+    {
+        static const std::pair<const char *, uint32_t> kPresets[] = {
+            {"thumbnail", 96}, {"small", 256}, {"medium", 512}, {"large", 1024}, {"original", 0}};
+        for (const auto &[preset, dimension] : kPresets)
+        {
+            if (name == preset)
+            {
+                return dimension;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::vector<uint8_t> AlbumArtTranscoder::Transcode(const std::vector<uint8_t> &bytes, const ArtRequest &request)
+    {
+        if (request.IsOriginal() || bytes.empty())
+        {
+            return bytes;
+        }
+
+        try
+        {
+            if (!factory_)
+            {
+                factory_ = winrt::create_instance<IWICImagingFactory>(CLSID_WICImagingFactory);
+            }
+
+            winrt::com_ptr<IWICStream> input;
+            winrt::check_hresult(factory_->CreateStream(input.put()));
+            winrt::check_hresult(input->InitializeFromMemory(const_cast<BYTE *>(bytes.data()),
+                                                             static_cast<DWORD>(bytes.size())));
+
+            winrt::com_ptr<IWICBitmapDecoder> decoder;
+            winrt::check_hresult(factory_->CreateDecoderFromStream(input.get(), nullptr,
+                                                                   WICDecodeMetadataCacheOnDemand, decoder.put()));
+            GUID decoded_container{};
+            winrt::check_hresult(decoder->GetContainerFormat(&decoded_container));
+            GUID container = EncoderContainer(request.format, decoded_container);
+
+            winrt::com_ptr<IWICBitmapFrameDecode> frame;
+            winrt::check_hresult(decoder->GetFrame(0, frame.put()));
+            UINT width = 0;
+            UINT height = 0;
+            winrt::check_hresult(frame->GetSize(&width, &height));
+
+            ImageSize size{width, height};
+            ImageSize target = FitWithin(size, request.max_dimension);
+            if (target == size && IsEqualGUID(container, decoded_container))
+            {
+                return bytes;
+            }
+
+            // Premultiplied, so averaging never pulls colour out of fully
+            // transparent pixels.
+            winrt::com_ptr<IWICFormatConverter> converter;
+            winrt::check_hresult(factory_->CreateFormatConverter(converter.put()));
+            winrt::check_hresult(converter->Initialize(frame.get(), GUID_WICPixelFormat32bppPBGRA,
+                                                       WICBitmapDitherTypeNone, nullptr, 0.0,
+                                                       WICBitmapPaletteTypeCustom));
+            Bitmap decoded{width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 4)};
+            winrt::check_hresult(converter->CopyPixels(nullptr, width * 4, static_cast<UINT>(decoded.pixels.size()),
+                                                       decoded.pixels.data()));
+
+            Bitmap resized = target == size ? std::move(decoded) : ResizeArea(decoded.View(), target);
+
+            winrt::com_ptr<IWICBitmap> bitmap;
+            winrt::check_hresult(factory_->CreateBitmapFromMemory(
+                resized.width, resized.height, GUID_WICPixelFormat32bppPBGRA, resized.width * 4,
+                static_cast<UINT>(resized.pixels.size()), resized.pixels.data(), bitmap.put()));
+
+            auto encoded = Encode(bitmap.get(), container);
+            ++transcodes_;
+            bytes_in_ += bytes.size();
+            bytes_out_ += encoded.size();
+            return encoded;
+        }
+        catch (...)
+        {
+            return {};
+        }
+    }
+
+    std::vector<uint8_t> AlbumArtTranscoder::Encode(IWICBitmapSource *source, const GUID &container)
+    {
+        winrt::com_ptr<IStream> output;
+        winrt::check_hresult(CreateStreamOnHGlobal(nullptr, TRUE, output.put()));
+
+        winrt::com_ptr<IWICBitmapEncoder> encoder;
+        winrt::check_hresult(factory_->CreateEncoder(container, nullptr, encoder.put()));
+        winrt::check_hresult(encoder->Initialize(output.get(), WICBitmapEncoderNoCache));
+
+        winrt::com_ptr<IWICBitmapFrameEncode> frame;
+        winrt::com_ptr<IPropertyBag2> options;
+        winrt::check_hresult(encoder->CreateNewFrame(frame.put(), options.put()));
+        if (IsEqualGUID(container, GUID_ContainerFormatJpeg))
+        {
+            PROPBAG2 option{};
+            option.pstrName = const_cast<LPOLESTR>(L"ImageQuality");
+            VARIANT value;
+            VariantInit(&value);
+            value.vt = VT_R4;
+            value.fltVal = kJpegQuality;
+            winrt::check_hresult(options->Write(1, &option, &value));
+        }
+        winrt::check_hresult(frame->Initialize(options.get()));
+
+        UINT width = 0;
+        UINT height = 0;
+        winrt::check_hresult(source->GetSize(&width, &height));
+        winrt::check_hresult(frame->SetSize(width, height));
+
+        // The encoder says which format it takes instead; PNG wants straight
+        // alpha and JPEG no alpha at all.
+        WICPixelFormatGUID format = GUID_WICPixelFormat32bppPBGRA;
+        winrt::check_hresult(frame->SetPixelFormat(&format));
+        winrt::com_ptr<IWICFormatConverter> converter;
+        if (!IsEqualGUID(format, GUID_WICPixelFormat32bppPBGRA))
+        {
+            winrt::check_hresult(factory_->CreateFormatConverter(converter.put()));
+            winrt::check_hresult(converter->Initialize(source, format, WICBitmapDitherTypeNone, nullptr, 0.0,
+                                                       WICBitmapPaletteTypeCustom));
+            source = converter.get();
+        }
+
+        winrt::check_hresult(frame->WriteSource(source, nullptr));
+        winrt::check_hresult(frame->Commit());
+        winrt::check_hresult(encoder->Commit());
+
+        HGLOBAL memory = nullptr;
+        winrt::check_hresult(GetHGlobalFromStream(output.get(), &memory));
+        STATSTG stat{};
+        winrt::check_hresult(output->Stat(&stat, STATFLAG_NONAME));
+        const auto *data = static_cast<const uint8_t *>(GlobalLock(memory));
+        if (!data)
+        {
+            return {};
+        }
+        std::vector<uint8_t> encoded(data, data + stat.cbSize.QuadPart);
+        GlobalUnlock(memory);
+        return encoded;
+    }
+
+} // namespace media_notification_service
@@ -0,0 +1,66 @@
+#ifndef ALBUM_ART_TRANSCODER_H_
+#define ALBUM_ART_TRANSCODER_H_
+
+#include <winrt/base.h>
+#include <wincodec.h>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace media_notification_service
+{
+    enum class ArtFormat
+    {
+        // Whatever the media app published, if it is PNG or JPEG; PNG
+        // otherwise.
+        Original,
+        Png,
+        Jpeg
+    };
+
+    // What an app wants "albumArt" to be. The default is the thumbnail as
+    // the media app published it.
+    struct ArtRequest
+    {
+        // Longest side in pixels; 0 keeps the published size.
+        uint32_t max_dimension = 0;
+        ArtFormat format = ArtFormat::Original;
+
+        bool IsOriginal() const { return max_dimension == 0 && format == ArtFormat::Original; }
+        // Tells cached variants of one thumbnail apart, e.g. "256/jpeg".
+        std::string VariantName() const;
+
+        bool operator==(const ArtRequest &) const = default;
+    };
+
+    // "thumbnail" 96, "small" 256, "medium" 512, "large" 1024, "original" 0.
+    std::optional<uint32_t> ArtSizePreset(const std::string &name);
+
+    // Decode, shrink and re-encode through WIC, with the resize itself done
+    // by ResizeArea. Not thread-safe; give it a strand.
+    class AlbumArtTranscoder
+    {
+    public:
+        // |bytes| when nothing would change (already small enough and in the
+        // wanted format), nothing if they do not decode.
+        std::vector<uint8_t> Transcode(const std::vector<uint8_t> &bytes, const ArtRequest &request);
+
+        uint64_t TranscodeCount() const { return transcodes_; }
+        uint64_t BytesIn() const { return bytes_in_; }
+        uint64_t BytesOut() const { return bytes_out_; }
+
+    private:
+        std::vector<uint8_t> Encode(IWICBitmapSource *source, const GUID &container);
+
+        winrt::com_ptr<IWICImagingFactory> factory_;
+
+        uint64_t transcodes_ = 0;
+        uint64_t bytes_in_ = 0;
+        uint64_t bytes_out_ = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // ALBUM_ART_TRANSCODER_H_
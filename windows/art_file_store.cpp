@@ -0,0 +1,368 @@
+#include "art_file_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <system_error>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace media_notification_service
+{
+    namespace
+    {
+        constexpr char kDirectoryPrefix[] = "art-";
+        constexpr char kLockFileName[] = "lock";
+
+        uint64_t ProcessId()
+        {
+#ifdef _WIN32
+            return GetCurrentProcessId();
+#else
+            return static_cast<uint64_t>(getpid());
+#endif
+        }
+
+        std::string ToUtf8(const fs::path &path)
+        {
+            auto utf8 = path.u8string();
+            return std::string(utf8.begin(), utf8.end());
+        }
+    } // namespace
+
+    // A file mapped read-write in full. The mapping keeps the file alive, so
+    // no handle stays open and readers are not locked out.
+    class ArtFileStore::MappedFile
+    {
+    public:
+        static std::unique_ptr<MappedFile> Create(const fs::path &path, size_t size)
+        {
+            auto file = std::unique_ptr<MappedFile>(new MappedFile());
+            file->size_ = size;
+#ifdef _WIN32
+            HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                                        FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, CREATE_NEW,
+                                        FILE_ATTRIBUTE_TEMPORARY, nullptr);
+            if (handle == INVALID_HANDLE_VALUE)
+            {
+                return nullptr;
+            }
+            uint64_t size64 = size;
+            file->mapping_ = CreateFileMappingW(handle, nullptr, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32),
+                                                static_cast<DWORD>(size64), nullptr);
+            CloseHandle(handle);
+            if (!file->mapping_)
+            {
+                DeleteFileW(path.c_str());
+                return nullptr;
+            }
+            file->data_ = static_cast<uint8_t *>(MapViewOfFile(file->mapping_, FILE_MAP_WRITE, 0, 0, size));
+            if (!file->data_)
+            {
+                file.reset();
+                DeleteFileW(path.c_str());
+                return nullptr;
+            }
+#else
+            int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+            if (fd < 0)
+            {
+                return nullptr;
+            }
+            void *data = MAP_FAILED;
+            if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+            {
+                data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            }
+            close(fd);
+            if (data == MAP_FAILED)
+            {
+                unlink(path.c_str());
+                return nullptr;
+            }
+            file->data_ = static_cast<uint8_t *>(data);
+#endif
+            return file;
+        }
+
+        ~MappedFile()
+        {
+#ifdef _WIN32
+            if (data_)
+            {
+                UnmapViewOfFile(data_);
+            }
+            if (mapping_)
+            {
+                CloseHandle(mapping_);
+            }
+#else
+            if (data_)
+            {
+                munmap(data_, size_);
+            }
+#endif
+        }
+
+        uint8_t *Data() const { return data_; }
+
+    private:
+        MappedFile() = default;
+
+        uint8_t *data_ = nullptr;
+        size_t size_ = 0;
+#ifdef _WIN32
+        HANDLE mapping_ = nullptr;
+#endif
+    };
+
+    // Held for the life of a store. The OS lets go of it when the process
+    // dies, however it dies, which is what marks a directory as stale.
+    class ArtFileStore::LockFile
+    {
+    public:
+        // Nothing if another live store holds |path|.
+        static std::unique_ptr<LockFile> Acquire(const fs::path &path)
+        {
+#ifdef _WIN32
+            // No sharing: a second open fails while this one is alive.
+            HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+                                        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+            if (handle == INVALID_HANDLE_VALUE)
+            {
+                return nullptr;
+            }
+            return std::unique_ptr<LockFile>(new LockFile(handle));
+#else
+            int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+            if (fd < 0)
+            {
+                return nullptr;
+            }
+            if (flock(fd, LOCK_EX | LOCK_NB) != 0)
+            {
+                close(fd);
+                return nullptr;
+            }
+            return std::unique_ptr<LockFile>(new LockFile(fd));
+#endif
+        }
+
+        ~LockFile()
+        {
+#ifdef _WIN32
+            CloseHandle(handle_);
+#else
+            close(fd_);
+#endif
+        }
+
+    private:
+#ifdef _WIN32
+        explicit LockFile(HANDLE handle) : handle_(handle) {}
+        HANDLE handle_;
+#else
+        explicit LockFile(int fd) : fd_(fd) {}
+        int fd_;
+#endif
+    };
+
+    ArtFileStore::ArtFileStore(Options options) : options_(std::move(options))
+    {
+    }
+
+    ArtFileStore::~ArtFileStore()
+    {
+        segments_.clear();
+        lock_.reset();
+        if (!directory_.empty())
+        {
+            std::error_code error;
+            fs::remove_all(directory_, error);
+        }
+    }
+
+    bool ArtFileStore::Open()
+    {
+        if (lock_)
+        {
+            return true;
+        }
+
+        std::error_code error;
+        fs::create_directories(options_.root, error);
+        if (error)
+        {
+            return false;
+        }
+        RemoveStaleDirectories();
+
+        static std::atomic<uint64_t> instance{0};
+        directory_ = options_.root / (kDirectoryPrefix + std::to_string(ProcessId()) + "-" +
+                                      std::to_string(instance.fetch_add(1)));
+        fs::create_directory(directory_, error);
+        if (error)
+        {
+            directory_.clear();
+            return false;
+        }
+        lock_ = LockFile::Acquire(directory_ / kLockFileName);
+        if (!lock_)
+        {
+            fs::remove_all(directory_, error);
+            directory_.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void ArtFileStore::RemoveStaleDirectories()
+    {
+        std::error_code error;
+        std::vector<fs::path> stale;
+        for (fs::directory_iterator it(options_.root, error), end; !error && it != end; it.increment(error))
+        {
+            std::string name = ToUtf8(it->path().filename());
+            if (!it->is_directory(error) || name.rfind(kDirectoryPrefix, 0) != 0)
+            {
+                continue;
+            }
+            // Acquiring the lock means its owner is gone. A directory without
+            // one never got as far as storing anything.
+            if (LockFile::Acquire(it->path() / kLockFileName))
+            {
+                stale.push_back(it->path());
+            }
+        }
+
+        for (const auto &path : stale)
+        {
+            fs::remove_all(path, error);
+            if (!error)
+            {
+                ++stale_directories_;
+            }
+        }
+    }
+
+    std::optional<ArtFileRef> ArtFileStore::Put(const std::vector<uint8_t> &bytes)
+    {
+        if (!lock_ || bytes.empty() || bytes.size() > std::numeric_limits<uint32_t>::max())
+        {
+            return std::nullopt;
+        }
+        ++puts_;
+
+        uint64_t hash = Hash(bytes.data(), bytes.size());
+        auto existing = index_.find(hash);
+        if (existing != index_.end() && existing->second.length == bytes.size())
+        {
+            ++dedups_;
+            return ToRef(hash, existing->second);
+        }
+
+        Segment *segment = segments_.empty() ? nullptr : &segments_.back();
+        if (!segment || segment->capacity - segment->used < bytes.size())
+        {
+            segment = NewSegment((std::max)(options_.segment_bytes, bytes.size()));
+            if (!segment)
+            {
+                return std::nullopt;
+            }
+        }
+
+        std::memcpy(segment->file->Data() + segment->used, bytes.data(), bytes.size());
+        Entry entry{segment->generation, segment->used, static_cast<uint32_t>(bytes.size())};
+        segment->used += bytes.size();
+        segment->hashes.push_back(hash);
+        index_[hash] = entry;
+        bytes_written_ += bytes.size();
+        return ToRef(hash, entry);
+    }
+
+    ArtFileStore::Segment *ArtFileStore::NewSegment(size_t capacity)
+    {
+        while (!segments_.empty() && segments_.size() >= (std::max)(options_.max_segments, size_t{1}))
+        {
+            EvictOldest();
+        }
+        std::erase_if(orphans_, [](const fs::path &path)
+                      {
+                          std::error_code error;
+                          fs::remove(path, error);
+                          return !error; });
+
+        uint64_t generation = next_generation_++;
+        fs::path path = directory_ / (std::to_string(generation) + ".seg");
+        auto file = MappedFile::Create(path, capacity);
+        if (!file)
+        {
+            return nullptr;
+        }
+
+        Segment &segment = segments_.emplace_back();
+        segment.generation = generation;
+        segment.path = std::move(path);
+        segment.file = std::move(file);
+        segment.capacity = capacity;
+        return &segment;
+    }
+
+    void ArtFileStore::EvictOldest()
+    {
+        Segment &oldest = segments_.front();
+        for (uint64_t hash : oldest.hashes)
+        {
+            auto entry = index_.find(hash);
+            if (entry != index_.end() && entry->second.generation == oldest.generation)
+            {
+                index_.erase(entry);
+            }
+        }
+        fs::path path = std::move(oldest.path);
+        segments_.pop_front();
+
+        std::error_code error;
+        fs::remove(path, error);
+        if (error)
+        {
+            orphans_.push_back(std::move(path));
+        }
+        ++evicted_segments_;
+    }
+
+    ArtFileRef ArtFileStore::ToRef(uint64_t hash, const Entry &entry) const
+    {
+        for (const auto &segment : segments_)
+        {
+            if (segment.generation == entry.generation)
+            {
+                return ArtFileRef{ToUtf8(segment.path), entry.offset, entry.length, hash};
+            }
+        }
+        return ArtFileRef{};
+    }
+
+    uint64_t ArtFileStore::Hash(const uint8_t *data, size_t size)
+    {
+        // FNV-1a.
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+} // namespace media_notification_service
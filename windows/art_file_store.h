@@ -0,0 +1,120 @@
+#ifndef ART_FILE_STORE_H_
+#define ART_FILE_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace media_notification_service
+{
+    // Where a stored image can be read: |length| bytes at |offset| of the
+    // file at |path| (UTF-8). |hash| identifies the content.
+    struct ArtFileRef
+    {
+        std::string path;
+        uint64_t offset = 0;
+        uint32_t length = 0;
+        uint64_t hash = 0;
+
+        bool operator==(const ArtFileRef &) const = default;
+    };
+
+    // Album art written to memory-mapped segment files instead of being sent
+    // through the channel. Each distinct image is written once, keyed by its
+    // content hash, and appended to the newest segment. Past
+    // |max_segments| the oldest segment is deleted along with every image
+    // in it; segment files are never reused, so a stale ref fails to open
+    // rather than reading other bytes.
+    //
+    // Each store owns a directory under |root| and holds a lock file in it
+    // while alive. Open() deletes directories whose lock nobody holds, i.e.
+    // those left behind by a crashed process. Not synchronized.
+    class ArtFileStore
+    {
+    public:
+        struct Options
+        {
+            std::filesystem::path root;
+            size_t segment_bytes = 4 * 1024 * 1024;
+            size_t max_segments = 4;
+        };
+
+        explicit ArtFileStore(Options options);
+        // Unmaps and deletes the store's directory.
+        ~ArtFileStore();
+
+        ArtFileStore(const ArtFileStore &) = delete;
+        ArtFileStore &operator=(const ArtFileStore &) = delete;
+
+        // False if the directory or its lock cannot be created; Put() then
+        // fails too.
+        bool Open();
+        bool IsOpen() const { return lock_ != nullptr; }
+
+        std::optional<ArtFileRef> Put(const std::vector<uint8_t> &bytes);
+
+        const std::filesystem::path &Directory() const { return directory_; }
+
+        static uint64_t Hash(const uint8_t *data, size_t size);
+
+        uint64_t PutCount() const { return puts_; }
+        // Puts answered with an image already stored.
+        uint64_t DedupCount() const { return dedups_; }
+        uint64_t BytesWritten() const { return bytes_written_; }
+        uint64_t EvictedSegmentCount() const { return evicted_segments_; }
+        // Directories of crashed instances removed by Open().
+        uint64_t StaleDirectoryCount() const { return stale_directories_; }
+
+    private:
+        class MappedFile;
+        class LockFile;
+
+        struct Segment
+        {
+            uint64_t generation = 0;
+            std::filesystem::path path;
+            std::unique_ptr<MappedFile> file;
+            size_t capacity = 0;
+            size_t used = 0;
+            std::vector<uint64_t> hashes;
+        };
+
+        struct Entry
+        {
+            uint64_t generation = 0;
+            uint64_t offset = 0;
+            uint32_t length = 0;
+        };
+
+        void RemoveStaleDirectories();
+        Segment *NewSegment(size_t capacity);
+        void EvictOldest();
+        ArtFileRef ToRef(uint64_t hash, const Entry &entry) const;
+
+        Options options_;
+        std::filesystem::path directory_;
+        std::unique_ptr<LockFile> lock_;
+
+        std::deque<Segment> segments_;
+        std::unordered_map<uint64_t, Entry> index_;
+        uint64_t next_generation_ = 0;
+        // Evicted segments that could not be deleted yet, e.g. because a
+        // reader still had one open on Windows.
+        std::vector<std::filesystem::path> orphans_;
+
+        uint64_t puts_ = 0;
+        uint64_t dedups_ = 0;
+        uint64_t bytes_written_ = 0;
+        uint64_t evicted_segments_ = 0;
+        uint64_t stale_directories_ = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // ART_FILE_STORE_H_
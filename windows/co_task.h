@@ -0,0 +1,307 @@
+#ifndef CO_TASK_H_
+#define CO_TASK_H_
+
+#include "deadline.h"
+#include "executor.h"
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace media_notification_service
+{
+    template <typename T>
+    class CoTask;
+
+    namespace detail
+    {
+        // Resumes whoever awaited the task once it finishes; a task nobody
+        // awaits just stays suspended until its CoTask destroys it.
+        struct FinalAwaiter
+        {
+            bool await_ready() const noexcept { return false; }
+
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+            {
+                auto continuation = handle.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        template <typename T>
+        struct PromiseBase
+        {
+            std::coroutine_handle<> continuation;
+
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+
+            // Coroutine bodies catch their own errors, like the rest of the
+            // plugin; anything escaping is a bug.
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+
+        template <typename T>
+        struct Promise : PromiseBase<T>
+        {
+            std::optional<T> value;
+
+            CoTask<T> get_return_object();
+
+            void return_value(T result)
+            {
+                value.emplace(std::move(result));
+            }
+
+            T Take() { return std::move(*value); }
+        };
+
+        template <>
+        struct Promise<void> : PromiseBase<void>
+        {
+            CoTask<void> get_return_object();
+
+            void return_void() const noexcept {}
+
+            void Take() const noexcept {}
+        };
+
+        // Fire-and-forget frame used by Spawn; it frees itself on completion.
+        struct DetachedTask
+        {
+            struct promise_type
+            {
+                DetachedTask get_return_object() const noexcept { return {}; }
+                std::suspend_never initial_suspend() const noexcept { return {}; }
+                std::suspend_never final_suspend() const noexcept { return {}; }
+                void return_void() const noexcept {}
+                void unhandled_exception() const noexcept { std::terminate(); }
+            };
+        };
+    } // namespace detail
+
+    // Lazily started, single-awaiter coroutine. The body runs when the task is
+    // first awaited (or spawned) and continues on whatever thread resumes it;
+    // use ScheduleOn to pick the thread explicitly.
+    template <typename T = void>
+    class CoTask
+    {
+    public:
+        using promise_type = detail::Promise<T>;
+        using Handle = std::coroutine_handle<promise_type>;
+
+        CoTask(CoTask &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+        CoTask &operator=(CoTask &&other) noexcept
+        {
+            if (this != &other)
+            {
+                Reset();
+                handle_ = std::exchange(other.handle_, nullptr);
+            }
+            return *this;
+        }
+
+        CoTask(const CoTask &) = delete;
+        CoTask &operator=(const CoTask &) = delete;
+
+        ~CoTask()
+        {
+            Reset();
+        }
+
+        auto operator co_await() && noexcept
+        {
+            struct Awaiter
+            {
+                Handle handle;
+
+                bool await_ready() const noexcept { return false; }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    handle.promise().continuation = awaiting;
+                    return handle;
+                }
+
+                T await_resume() { return handle.promise().Take(); }
+            };
+            return Awaiter{handle_};
+        }
+
+    private:
+        friend promise_type;
+
+        explicit CoTask(Handle handle) : handle_(handle) {}
+
+        void Reset()
+        {
+            if (handle_)
+            {
+                handle_.destroy();
+                handle_ = nullptr;
+            }
+        }
+
+        Handle handle_;
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        CoTask<T> Promise<T>::get_return_object()
+        {
+            return CoTask<T>(CoTask<T>::Handle::from_promise(*this));
+        }
+
+        inline CoTask<void> Promise<void>::get_return_object()
+        {
+            return CoTask<void>(CoTask<void>::Handle::from_promise(*this));
+        }
+
+        template <typename T, typename Callback>
+        DetachedTask RunDetached(CoTask<T> task, Callback done)
+        {
+            if constexpr (std::is_void_v<T>)
+            {
+                co_await std::move(task);
+                done();
+            }
+            else
+            {
+                done(co_await std::move(task));
+            }
+        }
+    } // namespace detail
+
+    // Starts |task| on the calling thread and hands its result to |done| on
+    // whichever thread the task finishes on.
+    template <typename T, typename Callback>
+    void Spawn(CoTask<T> task, Callback done)
+    {
+        detail::RunDetached(std::move(task), std::move(done));
+    }
+
+    template <typename T>
+    void Spawn(CoTask<T> task)
+    {
+        if constexpr (std::is_void_v<T>)
+        {
+            Spawn(std::move(task), [] {});
+        }
+        else
+        {
+            Spawn(std::move(task), [](T &&) {});
+        }
+    }
+
+    // co_await ScheduleOn(executor) continues the coroutine as a task posted to
+    // |executor|.
+    inline auto ScheduleOn(Executor &executor)
+    {
+        struct Awaiter
+        {
+            Executor &executor;
+
+            bool await_ready() const noexcept { return false; }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                executor.Post([handle] { handle.resume(); });
+            }
+
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{executor};
+    }
+
+    // Awaits an IAsyncOperation/IAsyncAction (or anything with the same
+    // Status/Completed/Cancel shape) without blocking a thread. The coroutine
+    // resumes on |executor|; if the operation is still running after |timeout|
+    // it is cancelled and the await yields CallResult::Timeout. Only read the
+    // operation's results after CallResult::Success. The completion handler
+    // keeps |executor| alive since it may fire after everything else is gone.
+    template <typename Operation>
+    class OperationAwaiter
+    {
+    public:
+        using Status = decltype(std::declval<const Operation &>().Status());
+
+        OperationAwaiter(Operation operation, std::shared_ptr<Executor> executor, Timer &timer,
+                         std::chrono::milliseconds timeout)
+            : operation_(std::move(operation)), executor_(std::move(executor)), timer_(timer),
+              timeout_(timeout) {}
+
+        bool await_ready() const
+        {
+            return operation_.Status() != Status::Started;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            // The coroutine, and this awaiter with it, can be resumed on
+            // another thread as soon as Completed is registered, so everything
+            // the callbacks need lives in |state_| and locals.
+            state_ = std::make_shared<State>();
+            auto state = state_;
+            Operation operation = operation_;
+            auto executor = executor_;
+
+            timer_.PostAfter(timeout_, [state, operation]
+                             {
+                                 state->timed_out.store(true);
+                                 operation.Cancel();
+                             });
+
+            operation.Completed([state, executor, handle](auto &&, Status status)
+                                {
+                                    state->status = status;
+                                    executor->Post([handle] { handle.resume(); });
+                                });
+        }
+
+        CallResult await_resume() const
+        {
+            Status status = state_ ? state_->status : operation_.Status();
+            if (status == Status::Completed)
+            {
+                return CallResult::Success;
+            }
+            if (state_ && state_->timed_out.load())
+            {
+                return CallResult::Timeout;
+            }
+            return CallResult::Failure;
+        }
+
+    private:
+        struct State
+        {
+            std::atomic<bool> timed_out{false};
+            Status status{Status::Started};
+        };
+
+        Operation operation_;
+        std::shared_ptr<Executor> executor_;
+        Timer &timer_;
+        std::chrono::milliseconds timeout_;
+        std::shared_ptr<State> state_;
+    };
+
+    template <typename Operation>
+    OperationAwaiter<Operation> AwaitOperation(Operation operation, std::shared_ptr<Executor> executor,
+                                               Timer &timer, std::chrono::milliseconds timeout)
+    {
+        return OperationAwaiter<Operation>(std::move(operation), std::move(executor), timer, timeout);
+    }
+
+} // namespace media_notification_service
+
+#endif // CO_TASK_H_
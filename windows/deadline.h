@@ -0,0 +1,88 @@
+#ifndef DEADLINE_H_
+#define DEADLINE_H_
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+namespace media_notification_service
+{
+    enum class CallResult
+    {
+        Success,
+        Failure,
+        Timeout,
+    };
+
+    class Deadline
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit Deadline(std::chrono::milliseconds timeout)
+            : expiry_(Clock::now() + timeout) {}
+
+        std::chrono::milliseconds Remaining() const
+        {
+            auto remaining = expiry_ - Clock::now();
+            if (remaining <= Clock::duration::zero())
+            {
+                return std::chrono::milliseconds::zero();
+            }
+            return std::chrono::ceil<std::chrono::milliseconds>(remaining);
+        }
+
+        bool Expired() const
+        {
+            return Clock::now() >= expiry_;
+        }
+
+    private:
+        Clock::time_point expiry_;
+    };
+
+    // Waits for an IAsyncOperation/IAsyncAction (or anything with the same
+    // wait_for/Cancel shape) until |deadline|. If the operation is still
+    // running by then it is cancelled and false is returned; the caller must
+    // not touch its results in that case.
+    template <typename Operation>
+    bool WaitForOperation(const Operation &operation, const Deadline &deadline)
+    {
+        using Status = decltype(operation.wait_for(deadline.Remaining()));
+
+        if (operation.wait_for(deadline.Remaining()) != Status::Started)
+        {
+            return true;
+        }
+
+        operation.Cancel();
+        return false;
+    }
+
+    // Per-method timeouts, keyed by the method channel name. Not synchronized;
+    // the plugin only reads and updates it on the worker thread.
+    class DeadlineTable
+    {
+    public:
+        explicit DeadlineTable(std::chrono::milliseconds default_timeout)
+            : default_timeout_(default_timeout) {}
+
+        void Set(const std::string &method, std::chrono::milliseconds timeout)
+        {
+            timeouts_[method] = timeout;
+        }
+
+        std::chrono::milliseconds Get(const std::string &method) const
+        {
+            auto it = timeouts_.find(method);
+            return it != timeouts_.end() ? it->second : default_timeout_;
+        }
+
+    private:
+        std::chrono::milliseconds default_timeout_;
+        std::unordered_map<std::string, std::chrono::milliseconds> timeouts_;
+    };
+
+} // namespace media_notification_service
+
+#endif // DEADLINE_H_
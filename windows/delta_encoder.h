@@ -0,0 +1,98 @@
+#ifndef DELTA_ENCODER_H_
+#define DELTA_ENCODER_H_
+
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace media_notification_service
+{
+    // Turns a stream of full maps into deltas against the previous one: the
+    // keys whose values changed, and the keys that went away. Every
+    // |keyframe_interval|-th map, and the next one after RequestKeyframe, is
+    // sent whole so a receiver that lost track can start over. Transient
+    // keys (per-event flags) are always sent and never remembered.
+    template <typename Map>
+    class DeltaEncoder
+    {
+    public:
+        using Key = typename Map::key_type;
+
+        struct Delta
+        {
+            // Starts at 1 and goes up by one per Encode; a receiver that sees
+            // a gap must wait for (or ask for) a keyframe.
+            uint64_t sequence = 0;
+            bool keyframe = false;
+            Map set;
+            std::vector<Key> removed;
+        };
+
+        explicit DeltaEncoder(uint32_t keyframe_interval, std::vector<Key> transient_keys = {})
+            : keyframe_interval_(keyframe_interval > 0 ? keyframe_interval : 1),
+              transient_keys_(transient_keys.begin(), transient_keys.end()) {}
+
+        Delta Encode(Map current)
+        {
+            Delta delta;
+            delta.sequence = ++sequence_;
+            delta.keyframe = keyframe_requested_ || delta.sequence - last_keyframe_ >= keyframe_interval_;
+
+            if (delta.keyframe)
+            {
+                delta.set = current;
+                keyframe_requested_ = false;
+                last_keyframe_ = delta.sequence;
+                ++keyframe_count_;
+            }
+            else
+            {
+                for (const auto &[key, value] : current)
+                {
+                    auto previous = last_.find(key);
+                    if (IsTransient(key) || previous == last_.end() || !(previous->second == value))
+                    {
+                        delta.set.emplace(key, value);
+                    }
+                }
+                for (const auto &[key, value] : last_)
+                {
+                    if (current.find(key) == current.end())
+                    {
+                        delta.removed.push_back(key);
+                    }
+                }
+            }
+
+            for (const auto &key : transient_keys_)
+            {
+                current.erase(key);
+            }
+            last_ = std::move(current);
+            return delta;
+        }
+
+        // The next Encode sends everything, e.g. for a new subscriber.
+        void RequestKeyframe() { keyframe_requested_ = true; }
+
+        uint64_t KeyframeCount() const { return keyframe_count_; }
+
+    private:
+        bool IsTransient(const Key &key) const
+        {
+            return transient_keys_.find(key) != transient_keys_.end();
+        }
+
+        uint32_t keyframe_interval_;
+        std::set<Key> transient_keys_;
+        Map last_;
+        uint64_t sequence_ = 0;
+        uint64_t last_keyframe_ = 0;
+        bool keyframe_requested_ = true;
+        uint64_t keyframe_count_ = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // DELTA_ENCODER_H_
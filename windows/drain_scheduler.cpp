@@ -0,0 +1,43 @@
+#include "drain_scheduler.h"
+
+namespace media_notification_service
+{
+    DrainScheduler::DrainScheduler(WakeSignal &wake) : wake_(wake) {}
+
+    bool DrainScheduler::Schedule()
+    {
+        // acq_rel pairs with BeginDrain: either the drain that cleared the
+        // flag sees our item, or we see the flag cleared and wake again.
+        if (drain_scheduled_.exchange(true, std::memory_order_acq_rel))
+        {
+            saved_wake_count_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        if (!wake_.Wake())
+        {
+            // Nothing is coming to clear the flag; let the next item retry.
+            drain_scheduled_.store(false, std::memory_order_release);
+            return false;
+        }
+
+        wake_count_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void DrainScheduler::BeginDrain()
+    {
+        drain_scheduled_.exchange(false, std::memory_order_acq_rel);
+    }
+
+    uint64_t DrainScheduler::WakeCount() const
+    {
+        return wake_count_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t DrainScheduler::SavedWakeCount() const
+    {
+        return saved_wake_count_.load(std::memory_order_relaxed);
+    }
+
+} // namespace media_notification_service
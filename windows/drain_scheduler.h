@@ -0,0 +1,43 @@
+#ifndef DRAIN_SCHEDULER_H_
+#define DRAIN_SCHEDULER_H_
+
+#include "wake_signal.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace media_notification_service
+{
+    // Wakes a consumer once per drain rather than once per item. Producers
+    // call Schedule after queuing; only the first call since the consumer's
+    // last BeginDrain sends a wake-up, the rest rely on that drain.
+    class DrainScheduler
+    {
+    public:
+        explicit DrainScheduler(WakeSignal &wake);
+
+        DrainScheduler(const DrainScheduler &) = delete;
+        DrainScheduler &operator=(const DrainScheduler &) = delete;
+
+        // Any thread, after the item is queued. Returns true if it woke the
+        // consumer.
+        bool Schedule();
+
+        // Consumer only, before it looks at the queue: items queued from here
+        // on schedule another drain.
+        void BeginDrain();
+
+        uint64_t WakeCount() const;
+        // Schedule calls that found a drain already pending.
+        uint64_t SavedWakeCount() const;
+
+    private:
+        WakeSignal &wake_;
+        std::atomic<bool> drain_scheduled_{false};
+        std::atomic<uint64_t> wake_count_{0};
+        std::atomic<uint64_t> saved_wake_count_{0};
+    };
+
+} // namespace media_notification_service
+
+#endif // DRAIN_SCHEDULER_H_
@@ -0,0 +1,104 @@
+#ifndef EVENT_MAILBOX_H_
+#define EVENT_MAILBOX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+namespace media_notification_service
+{
+    // What a stream does with events its consumer has not taken yet.
+    struct DeliveryPolicy
+    {
+        enum class Kind
+        {
+            // Keep everything.
+            Queue,
+            // Keep only the newest; for state snapshots such as positions.
+            LatestOnly,
+            // Keep the newest |capacity|, dropping the oldest.
+            Bounded,
+        };
+
+        Kind kind = Kind::Queue;
+        // 0 for unbounded.
+        size_t capacity = 0;
+
+        static DeliveryPolicy Queue() { return {Kind::Queue, 0}; }
+        static DeliveryPolicy LatestOnly() { return {Kind::LatestOnly, 1}; }
+        static DeliveryPolicy Bounded(size_t capacity)
+        {
+            return {Kind::Bounded, capacity > 0 ? capacity : 1};
+        }
+    };
+
+    // Pending events under a DeliveryPolicy. Not synchronized; the owner
+    // guards it.
+    template <typename T>
+    class EventMailbox
+    {
+    public:
+        explicit EventMailbox(DeliveryPolicy policy = DeliveryPolicy::Queue()) : policy_(policy) {}
+
+        // Returns false if an older event had to make room.
+        bool Push(T value)
+        {
+            bool kept_all = true;
+            if (policy_.capacity > 0)
+            {
+                while (events_.size() >= policy_.capacity)
+                {
+                    events_.pop_front();
+                    ++dropped_;
+                    kept_all = false;
+                }
+            }
+            events_.push_back(std::move(value));
+            return kept_all;
+        }
+
+        bool TryPop(T &value)
+        {
+            if (events_.empty())
+            {
+                return false;
+            }
+            value = std::move(events_.front());
+            events_.pop_front();
+            return true;
+        }
+
+        // Moves every pending event into |out|, which should be empty; a swap,
+        // so the caller can deliver them after dropping its lock.
+        void TakeAll(std::deque<T> &out)
+        {
+            out.swap(events_);
+            events_.clear();
+        }
+
+        // Events already pending beyond the new capacity are dropped.
+        void SetPolicy(DeliveryPolicy policy)
+        {
+            policy_ = policy;
+            while (policy_.capacity > 0 && events_.size() > policy_.capacity)
+            {
+                events_.pop_front();
+                ++dropped_;
+            }
+        }
+
+        DeliveryPolicy Policy() const { return policy_; }
+        size_t Size() const { return events_.size(); }
+        bool Empty() const { return events_.empty(); }
+        uint64_t DroppedCount() const { return dropped_; }
+
+    private:
+        DeliveryPolicy policy_;
+        std::deque<T> events_;
+        uint64_t dropped_ = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // EVENT_MAILBOX_H_
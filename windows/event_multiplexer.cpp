@@ -0,0 +1,160 @@
+#include "event_multiplexer.h"
+
+#include <utility>
+
+namespace media_notification_service
+{
+    size_t EventMultiplexer::KeyHash::operator()(const EventKey &key) const
+    {
+        return std::hash<std::string>()(key.source) * 31 + static_cast<size_t>(key.event);
+    }
+
+    EventMultiplexer::EventMultiplexer(Attach attach) : attach_(std::move(attach))
+    {
+    }
+
+    EventMultiplexer::~EventMultiplexer()
+    {
+        std::unordered_map<EventKey, Channel, KeyHash> channels;
+        {
+            std::lock_guard<std::mutex> lock(channels_mutex_);
+            channels.swap(channels_);
+        }
+        for (auto &[key, channel] : channels)
+        {
+            channel.revoke();
+        }
+    }
+
+    EventMultiplexer::SubscriptionId EventMultiplexer::Subscribe(const EventKey &key, Callback callback)
+    {
+        std::lock_guard<std::mutex> change_lock(change_mutex_);
+
+        bool attached;
+        {
+            std::lock_guard<std::mutex> lock(channels_mutex_);
+            attached = channels_.count(key) != 0;
+        }
+        Revoker revoke;
+        if (!attached)
+        {
+            // Outside channels_mutex_: the platform may raise the event
+            // before the attach returns.
+            revoke = attach_(key);
+            if (!revoke)
+            {
+                return 0;
+            }
+            ++attaches_;
+        }
+
+        SubscriptionId id = next_id_++;
+        keys_.emplace(id, key);
+        std::lock_guard<std::mutex> lock(channels_mutex_);
+        Channel &channel = channels_[key];
+        if (revoke)
+        {
+            channel.revoke = std::move(revoke);
+        }
+        auto subscribers = channel.subscribers ? std::make_shared<std::vector<Subscriber>>(*channel.subscribers)
+                                               : std::make_shared<std::vector<Subscriber>>();
+        subscribers->push_back({id, std::make_shared<Callback>(std::move(callback))});
+        channel.subscribers = std::move(subscribers);
+        return id;
+    }
+
+    void EventMultiplexer::Unsubscribe(SubscriptionId id)
+    {
+        std::lock_guard<std::mutex> change_lock(change_mutex_);
+        auto found = keys_.find(id);
+        if (found == keys_.end())
+        {
+            return;
+        }
+        EventKey key = std::move(found->second);
+        keys_.erase(found);
+
+        Revoker revoke;
+        {
+            std::lock_guard<std::mutex> lock(channels_mutex_);
+            auto channel = channels_.find(key);
+            if (channel == channels_.end())
+            {
+                return;
+            }
+            auto subscribers = std::make_shared<std::vector<Subscriber>>();
+            for (const auto &subscriber : *channel->second.subscribers)
+            {
+                if (subscriber.id != id)
+                {
+                    subscribers->push_back(subscriber);
+                }
+            }
+            if (subscribers->empty())
+            {
+                revoke = std::move(channel->second.revoke);
+                channels_.erase(channel);
+            }
+            else
+            {
+                channel->second.subscribers = std::move(subscribers);
+            }
+        }
+        if (revoke)
+        {
+            revoke();
+        }
+    }
+
+    void EventMultiplexer::Raise(const EventKey &key)
+    {
+        std::shared_ptr<const std::vector<Subscriber>> subscribers;
+        {
+            std::lock_guard<std::mutex> lock(channels_mutex_);
+            ++raises_;
+            auto channel = channels_.find(key);
+            if (channel == channels_.end())
+            {
+                return;
+            }
+            subscribers = channel->second.subscribers;
+            deliveries_ += subscribers->size();
+        }
+        for (const auto &subscriber : *subscribers)
+        {
+            (*subscriber.callback)();
+        }
+    }
+
+    bool EventMultiplexer::IsAttached(const EventKey &key) const
+    {
+        std::lock_guard<std::mutex> lock(channels_mutex_);
+        return channels_.count(key) != 0;
+    }
+
+    size_t EventMultiplexer::AttachedCount() const
+    {
+        std::lock_guard<std::mutex> lock(channels_mutex_);
+        return channels_.size();
+    }
+
+    size_t EventMultiplexer::SubscriberCount(const EventKey &key) const
+    {
+        std::lock_guard<std::mutex> lock(channels_mutex_);
+        auto channel = channels_.find(key);
+        return channel == channels_.end() ? 0 : channel->second.subscribers->size();
+    }
+
+    uint64_t EventMultiplexer::RaiseCount() const
+    {
+        std::lock_guard<std::mutex> lock(channels_mutex_);
+        return raises_;
+    }
+
+    uint64_t EventMultiplexer::DeliveryCount() const
+    {
+        std::lock_guard<std::mutex> lock(channels_mutex_);
+        return deliveries_;
+    }
+
+} // namespace media_notification_service
@@ -0,0 +1,112 @@
+#ifndef EVENT_MULTIPLEXER_H_
+#define EVENT_MULTIPLEXER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace media_notification_service
+{
+    enum class SessionEvent
+    {
+        SessionsChanged,
+        CurrentSessionChanged,
+        MediaPropertiesChanged,
+        PlaybackInfoChanged,
+        TimelinePropertiesChanged
+    };
+
+    // One event of one source: a session's SourceAppUserModelId, or empty
+    // for the session manager's own events.
+    struct EventKey
+    {
+        std::string source;
+        SessionEvent event = SessionEvent::SessionsChanged;
+
+        bool operator==(const EventKey &) const = default;
+    };
+
+    // Shares one platform subscription per EventKey among every consumer of
+    // it. The first Subscribe() for a key attaches, i.e. registers a handler
+    // that calls Raise(); the last Unsubscribe() runs what the attach
+    // returned to take it back.
+    //
+    // Raise() may be called from any thread and never waits for a
+    // subscription change. A callback may still run once after its
+    // Unsubscribe() if the event was already being raised.
+    class EventMultiplexer
+    {
+    public:
+        using Callback = std::function<void()>;
+        // Undoes an attach.
+        using Revoker = std::function<void()>;
+        // Registers the handler for |key|; an empty Revoker means it failed.
+        using Attach = std::function<Revoker(const EventKey &key)>;
+        using SubscriptionId = uint64_t;
+
+        explicit EventMultiplexer(Attach attach);
+        // Revokes whatever is still attached.
+        ~EventMultiplexer();
+
+        EventMultiplexer(const EventMultiplexer &) = delete;
+        EventMultiplexer &operator=(const EventMultiplexer &) = delete;
+
+        // 0 if the key was not attached and attaching failed.
+        SubscriptionId Subscribe(const EventKey &key, Callback callback);
+        // Unknown ids, 0 included, are ignored.
+        void Unsubscribe(SubscriptionId id);
+
+        // Runs every callback subscribed to |key|, in subscription order.
+        void Raise(const EventKey &key);
+
+        bool IsAttached(const EventKey &key) const;
+        size_t AttachedCount() const;
+        size_t SubscriberCount(const EventKey &key) const;
+
+        uint64_t AttachCount() const { return attaches_; }
+        uint64_t RaiseCount() const;
+        // Callbacks run; above RaiseCount() by what sharing saved.
+        uint64_t DeliveryCount() const;
+
+    private:
+        struct KeyHash
+        {
+            size_t operator()(const EventKey &key) const;
+        };
+
+        struct Subscriber
+        {
+            SubscriptionId id;
+            std::shared_ptr<Callback> callback;
+        };
+
+        struct Channel
+        {
+            Revoker revoke;
+            // Replaced, never modified, so Raise() can run a copy unlocked.
+            std::shared_ptr<const std::vector<Subscriber>> subscribers;
+        };
+
+        Attach attach_;
+
+        // Serializes subscription changes, attaches and revokes included.
+        std::mutex change_mutex_;
+        std::unordered_map<SubscriptionId, EventKey> keys_;
+        SubscriptionId next_id_ = 1;
+        uint64_t attaches_ = 0;
+
+        // Held only to read or swap a channel's subscriber list.
+        mutable std::mutex channels_mutex_;
+        std::unordered_map<EventKey, Channel, KeyHash> channels_;
+        uint64_t raises_ = 0;
+        uint64_t deliveries_ = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // EVENT_MULTIPLEXER_H_
@@ -0,0 +1,31 @@
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+#include "inplace_task.h"
+
+#include <chrono>
+
+namespace media_notification_service
+{
+    // Something tasks can be posted to: a worker lane, a strand, a pool.
+    class Executor
+    {
+    public:
+        virtual ~Executor() = default;
+
+        virtual void Post(InplaceTask task) = 0;
+    };
+
+    // Runs a task once after a delay, on whatever thread the implementation
+    // owns. Used to arm operation timeouts.
+    class Timer
+    {
+    public:
+        virtual ~Timer() = default;
+
+        virtual void PostAfter(std::chrono::milliseconds delay, InplaceTask task) = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // EXECUTOR_H_
@@ -0,0 +1,298 @@
+#include "image_resize.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_RESIZE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace media_notification_service
+{
+    namespace
+    {
+        constexpr int kWeightBits = 14;
+        constexpr int32_t kWeightOne = 1 << kWeightBits;
+        constexpr int32_t kWeightRound = 1 << (kWeightBits - 1);
+
+        // For each output pixel along one axis: the first source pixel it
+        // covers and one fixed-point weight per covered pixel, summing to
+        // exactly kWeightOne. Rows of |weights| are padded with zeros to
+        // |stride| so every output has the same number of taps.
+        struct Taps
+        {
+            std::vector<uint32_t> first;
+            std::vector<uint32_t> count;
+            std::vector<int16_t> weights;
+            uint32_t stride = 0;
+
+            const int16_t *WeightsOf(uint32_t i) const { return weights.data() + static_cast<size_t>(i) * stride; }
+        };
+
+        // Output pixel i covers [i * src, (i + 1) * src) and source pixel j
+        // covers [j * dst, (j + 1) * dst), both in units of 1 / dst source
+        // pixels, so the overlaps are exact integers.
+        Taps ComputeTaps(uint32_t src, uint32_t dst)
+        {
+            Taps taps;
+            taps.first.resize(dst);
+            taps.count.resize(dst);
+            for (uint32_t i = 0; i < dst; ++i)
+            {
+                uint64_t first = static_cast<uint64_t>(i) * src / dst;
+                uint64_t end = (static_cast<uint64_t>(i + 1) * src + dst - 1) / dst;
+                taps.first[i] = static_cast<uint32_t>(first);
+                taps.count[i] = static_cast<uint32_t>(end - first);
+                taps.stride = std::max(taps.stride, taps.count[i]);
+            }
+
+            taps.weights.assign(static_cast<size_t>(dst) * taps.stride, 0);
+            for (uint32_t i = 0; i < dst; ++i)
+            {
+                int16_t *weights = taps.weights.data() + static_cast<size_t>(i) * taps.stride;
+                uint64_t out_begin = static_cast<uint64_t>(i) * src;
+                uint64_t out_end = out_begin + src;
+                int32_t sum = 0;
+                uint32_t largest = 0;
+                for (uint32_t k = 0; k < taps.count[i]; ++k)
+                {
+                    uint64_t j = taps.first[i] + k;
+                    uint64_t overlap = std::min(out_end, (j + 1) * dst) - std::max(out_begin, j * dst);
+                    weights[k] = static_cast<int16_t>((overlap * kWeightOne + src / 2) / src);
+                    sum += weights[k];
+                    if (weights[k] > weights[largest])
+                    {
+                        largest = k;
+                    }
+                }
+                weights[largest] = static_cast<int16_t>(weights[largest] + kWeightOne - sum);
+            }
+            return taps;
+        }
+
+        uint8_t Narrow(int32_t sum)
+        {
+            int32_t value = (sum + kWeightRound) >> kWeightBits;
+            return static_cast<uint8_t>(std::clamp(value, 0, 255));
+        }
+
+        void HorizontalScalar(const BitmapView &source, const Taps &taps, uint32_t width, uint8_t *out)
+        {
+            for (uint32_t y = 0; y < source.height; ++y)
+            {
+                const uint8_t *row = source.pixels + static_cast<size_t>(y) * source.stride;
+                uint8_t *dst = out + static_cast<size_t>(y) * width * 4;
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    const uint8_t *p = row + static_cast<size_t>(taps.first[x]) * 4;
+                    const int16_t *weights = taps.WeightsOf(x);
+                    int32_t sums[4] = {0, 0, 0, 0};
+                    for (uint32_t k = 0; k < taps.count[x]; ++k)
+                    {
+                        for (int c = 0; c < 4; ++c)
+                        {
+                            sums[c] += weights[k] * p[k * 4 + c];
+                        }
+                    }
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        dst[x * 4 + c] = Narrow(sums[c]);
+                    }
+                }
+            }
+        }
+
+        // |source| is |row_bytes| wide with packed rows.
+        void VerticalScalar(const uint8_t *source, size_t row_bytes, const Taps &taps, uint32_t height,
+                            uint8_t *out)
+        {
+            std::vector<int32_t> sums(row_bytes);
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                std::fill(sums.begin(), sums.end(), 0);
+                const int16_t *weights = taps.WeightsOf(y);
+                for (uint32_t k = 0; k < taps.count[y]; ++k)
+                {
+                    const uint8_t *row = source + (taps.first[y] + k) * row_bytes;
+                    for (size_t b = 0; b < row_bytes; ++b)
+                    {
+                        sums[b] += weights[k] * row[b];
+                    }
+                }
+                uint8_t *dst = out + y * row_bytes;
+                for (size_t b = 0; b < row_bytes; ++b)
+                {
+                    dst[b] = Narrow(sums[b]);
+                }
+            }
+        }
+
+#ifdef IMAGE_RESIZE_SSE2
+        // Both passes multiply two source values at a time with madd: the
+        // bytes of two pixels (or rows) are interleaved per channel and
+        // widened to 16 bits, against the weight pair (w0, w1) repeated.
+
+        __m128i Load32(const uint8_t *p)
+        {
+            int32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return _mm_cvtsi32_si128(value);
+        }
+
+        __m128i WeightPair(int16_t w0, int16_t w1)
+        {
+            return _mm_set1_epi32(static_cast<int32_t>(static_cast<uint16_t>(w0)) |
+                                  (static_cast<int32_t>(static_cast<uint16_t>(w1)) << 16));
+        }
+
+        __m128i NarrowSums(__m128i sums)
+        {
+            return _mm_srai_epi32(_mm_add_epi32(sums, _mm_set1_epi32(kWeightRound)), kWeightBits);
+        }
+
+        void HorizontalSse2(const BitmapView &source, const Taps &taps, uint32_t width, uint8_t *out)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            for (uint32_t y = 0; y < source.height; ++y)
+            {
+                const uint8_t *row = source.pixels + static_cast<size_t>(y) * source.stride;
+                uint8_t *dst = out + static_cast<size_t>(y) * width * 4;
+                for (uint32_t x = 0; x < width; ++x)
+                {
+                    const uint8_t *p = row + static_cast<size_t>(taps.first[x]) * 4;
+                    const int16_t *weights = taps.WeightsOf(x);
+                    uint32_t count = taps.count[x];
+                    __m128i sums = zero;
+                    uint32_t k = 0;
+                    for (; k + 1 < count; k += 2)
+                    {
+                        __m128i pair = _mm_unpacklo_epi8(Load32(p + k * 4), Load32(p + k * 4 + 4));
+                        sums = _mm_add_epi32(sums, _mm_madd_epi16(_mm_unpacklo_epi8(pair, zero),
+                                                                  WeightPair(weights[k], weights[k + 1])));
+                    }
+                    if (k < count)
+                    {
+                        __m128i single = _mm_unpacklo_epi8(Load32(p + k * 4), zero);
+                        sums = _mm_add_epi32(sums, _mm_madd_epi16(_mm_unpacklo_epi8(single, zero),
+                                                                  WeightPair(weights[k], 0)));
+                    }
+                    __m128i narrowed = NarrowSums(sums);
+                    narrowed = _mm_packus_epi16(_mm_packs_epi32(narrowed, zero), zero);
+                    int32_t pixel = _mm_cvtsi128_si32(narrowed);
+                    std::memcpy(dst + x * 4, &pixel, sizeof(pixel));
+                }
+            }
+        }
+
+        void VerticalSse2(const uint8_t *source, size_t row_bytes, const Taps &taps, uint32_t height,
+                          uint8_t *out)
+        {
+            const __m128i zero = _mm_setzero_si128();
+            size_t vector_bytes = row_bytes & ~size_t{7};
+            for (uint32_t y = 0; y < height; ++y)
+            {
+                const int16_t *weights = taps.WeightsOf(y);
+                uint32_t count = taps.count[y];
+                const uint8_t *rows = source + taps.first[y] * row_bytes;
+                uint8_t *dst = out + y * row_bytes;
+
+                for (size_t b = 0; b < vector_bytes; b += 8)
+                {
+                    __m128i low = zero;
+                    __m128i high = zero;
+                    uint32_t k = 0;
+                    for (; k < count; k += 2)
+                    {
+                        __m128i r0 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(rows + k * row_bytes + b));
+                        __m128i r1 = k + 1 < count
+                                         ? _mm_loadl_epi64(reinterpret_cast<const __m128i *>(rows + (k + 1) * row_bytes + b))
+                                         : zero;
+                        __m128i weight = WeightPair(weights[k], k + 1 < count ? weights[k + 1] : int16_t{0});
+                        __m128i pair = _mm_unpacklo_epi8(r0, r1);
+                        low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi8(pair, zero), weight));
+                        high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi8(pair, zero), weight));
+                    }
+                    __m128i narrowed = _mm_packs_epi32(NarrowSums(low), NarrowSums(high));
+                    _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + b), _mm_packus_epi16(narrowed, zero));
+                }
+
+                for (size_t b = vector_bytes; b < row_bytes; ++b)
+                {
+                    int32_t sum = 0;
+                    for (uint32_t k = 0; k < count; ++k)
+                    {
+                        sum += weights[k] * rows[k * row_bytes + b];
+                    }
+                    dst[b] = Narrow(sum);
+                }
+            }
+        }
+#endif
+    } // namespace
+
+    ImageSize FitWithin(ImageSize source, uint32_t max_dimension)
+    {
+        uint32_t longer = std::max(source.width, source.height);
+        if (max_dimension == 0 || longer <= max_dimension)
+        {
+            return source;
+        }
+        auto scale = [&](uint32_t side)
+        {
+            uint64_t scaled = (static_cast<uint64_t>(side) * max_dimension + longer / 2) / longer;
+            return std::max<uint32_t>(1, static_cast<uint32_t>(scaled));
+        };
+        return {scale(source.width), scale(source.height)};
+    }
+
+    bool HasSse2Kernel()
+    {
+#ifdef IMAGE_RESIZE_SSE2
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    Bitmap ResizeArea(const BitmapView &source, ImageSize target, ResizeKernel kernel)
+    {
+        Bitmap result;
+        if (!source.pixels || source.width == 0 || source.height == 0 ||
+            target.width == 0 || target.height == 0)
+        {
+            return result;
+        }
+
+        [[maybe_unused]] bool use_sse2 = HasSse2Kernel() && kernel != ResizeKernel::Scalar;
+
+        Taps columns = ComputeTaps(source.width, target.width);
+        std::vector<uint8_t> narrowed(static_cast<size_t>(target.width) * source.height * 4);
+#ifdef IMAGE_RESIZE_SSE2
+        if (use_sse2)
+        {
+            HorizontalSse2(source, columns, target.width, narrowed.data());
+        }
+        else
+#endif
+        {
+            HorizontalScalar(source, columns, target.width, narrowed.data());
+        }
+
+        Taps rows = ComputeTaps(source.height, target.height);
+        size_t row_bytes = static_cast<size_t>(target.width) * 4;
+        result.width = target.width;
+        result.height = target.height;
+        result.pixels.resize(row_bytes * target.height);
+#ifdef IMAGE_RESIZE_SSE2
+        if (use_sse2)
+        {
+            VerticalSse2(narrowed.data(), row_bytes, rows, target.height, result.pixels.data());
+            return result;
+        }
+#endif
+        VerticalScalar(narrowed.data(), row_bytes, rows, target.height, result.pixels.data());
+        return result;
+    }
+
+} // namespace media_notification_service
@@ -0,0 +1,61 @@
+#ifndef IMAGE_RESIZE_H_
+#define IMAGE_RESIZE_H_
+
+#include <cstdint>
+#include <vector>
+
+namespace media_notification_service
+{
+    struct ImageSize
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        bool operator==(const ImageSize &) const = default;
+    };
+
+    // 4 bytes per pixel in any channel order; channels are filtered alike.
+    // Premultiplied alpha keeps transparent edges from bleeding colour.
+    struct BitmapView
+    {
+        const uint8_t *pixels = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // Bytes from one row to the next, at least width * 4.
+        uint32_t stride = 0;
+    };
+
+    struct Bitmap
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // Rows packed, width * 4 bytes each.
+        std::vector<uint8_t> pixels;
+
+        BitmapView View() const { return {pixels.data(), width, height, width * 4}; }
+    };
+
+    // The largest size with |source|'s aspect ratio whose longer side is at
+    // most |max_dimension|. Never enlarges; 0 means no limit.
+    ImageSize FitWithin(ImageSize source, uint32_t max_dimension);
+
+    enum class ResizeKernel
+    {
+        // SSE2 where the build targets it, scalar otherwise.
+        Auto,
+        Scalar,
+        Sse2
+    };
+
+    bool HasSse2Kernel();
+
+    // Area-averaging resize: every output pixel is the mean of the source
+    // pixels it covers, the filter that suits large downscales. Runs as a
+    // horizontal then a vertical pass in 14-bit fixed point, so every kernel
+    // produces the same bytes. Asking for Sse2 without it runs Scalar.
+    Bitmap ResizeArea(const BitmapView &source, ImageSize target,
+                      ResizeKernel kernel = ResizeKernel::Auto);
+
+} // namespace media_notification_service
+
+#endif // IMAGE_RESIZE_H_
@@ -0,0 +1,145 @@
+#ifndef INPLACE_TASK_H_
+#define INPLACE_TASK_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace media_notification_service
+{
+    template <typename Signature>
+    class InplaceFunction;
+
+    // Move-only replacement for std::function that always stores the
+    // callable inline, so creating and queueing a task never touches the
+    // heap. Captures that do not fit are rejected at compile time.
+    template <typename R, typename... Args>
+    class InplaceFunction<R(Args...)>
+    {
+    public:
+        // Enough for the largest capture in the plugin, the media stream's
+        // listen task with its album art and settle options.
+        static constexpr size_t kCapacity = 80;
+        static constexpr size_t kAlignment = alignof(std::max_align_t);
+
+        template <typename F>
+        static constexpr bool Fits =
+            sizeof(F) <= kCapacity && alignof(F) <= kAlignment;
+
+        InplaceFunction() noexcept = default;
+        InplaceFunction(std::nullptr_t) noexcept {}
+
+        template <typename F,
+                  typename Fn = std::decay_t<F>,
+                  typename = std::enable_if_t<!std::is_same_v<Fn, InplaceFunction> &&
+                                              std::is_invocable_r_v<R, Fn &, Args...>>>
+        InplaceFunction(F &&callable)
+        {
+            static_assert(sizeof(Fn) <= kCapacity,
+                          "InplaceFunction capture is too large; capture less or raise kCapacity");
+            static_assert(alignof(Fn) <= kAlignment,
+                          "InplaceFunction capture is over-aligned");
+
+            ::new (static_cast<void *>(&storage_)) Fn(std::forward<F>(callable));
+            ops_ = &OpsFor<Fn>::kOps;
+        }
+
+        InplaceFunction(InplaceFunction &&other) noexcept
+        {
+            MoveFrom(other);
+        }
+
+        InplaceFunction &operator=(InplaceFunction &&other) noexcept
+        {
+            if (this != &other)
+            {
+                Reset();
+                MoveFrom(other);
+            }
+            return *this;
+        }
+
+        InplaceFunction &operator=(std::nullptr_t) noexcept
+        {
+            Reset();
+            return *this;
+        }
+
+        InplaceFunction(const InplaceFunction &) = delete;
+        InplaceFunction &operator=(const InplaceFunction &) = delete;
+
+        ~InplaceFunction()
+        {
+            Reset();
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return ops_ != nullptr;
+        }
+
+        R operator()(Args... args)
+        {
+            return ops_->invoke(&storage_, std::forward<Args>(args)...);
+        }
+
+    private:
+        struct Ops
+        {
+            R (*invoke)(void *storage, Args &&...args);
+            void (*relocate)(void *from, void *to);
+            void (*destroy)(void *storage);
+        };
+
+        template <typename Fn>
+        struct OpsFor
+        {
+            static R Invoke(void *storage, Args &&...args)
+            {
+                return (*static_cast<Fn *>(storage))(std::forward<Args>(args)...);
+            }
+
+            static void Relocate(void *from, void *to)
+            {
+                Fn *source = static_cast<Fn *>(from);
+                ::new (to) Fn(std::move(*source));
+                source->~Fn();
+            }
+
+            static void Destroy(void *storage)
+            {
+                static_cast<Fn *>(storage)->~Fn();
+            }
+
+            static constexpr Ops kOps{&Invoke, &Relocate, &Destroy};
+        };
+
+        void MoveFrom(InplaceFunction &other) noexcept
+        {
+            if (other.ops_)
+            {
+                other.ops_->relocate(&other.storage_, &storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+
+        void Reset() noexcept
+        {
+            if (ops_)
+            {
+                ops_->destroy(&storage_);
+                ops_ = nullptr;
+            }
+        }
+
+        alignas(kAlignment) unsigned char storage_[kCapacity];
+        const Ops *ops_ = nullptr;
+    };
+
+    using InplaceTask = InplaceFunction<void()>;
+
+} // namespace media_notification_service
+
+#endif // INPLACE_TASK_H_
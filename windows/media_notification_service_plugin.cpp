@@ -3,169 +3,929 @@
 #include <flutter/method_channel.h>
 #include <flutter/standard_method_codec.h>
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace media_notification_service
 {
+  namespace
+  {
+    // Coalescing keys for WorkerThread::EnqueueCoalesced.
+    constexpr size_t kMediaRefreshKey = 0;
+    constexpr size_t kPositionRefreshKey = 1;
+    constexpr size_t kSessionsRefreshKey = 2;
+    static_assert(kSessionsRefreshKey < WorkerThread::kMaxCoalesceKeys);
+
+    constexpr uint32_t kSongChangedFlag = 1u << 0;
+
+    constexpr std::chrono::milliseconds kPositionTickInterval{100};
+    // 60 Hz, for scrubbers; anything faster is clamped.
+    constexpr std::chrono::milliseconds kMinPositionTickInterval{16};
+    // Lets the tick share a wake-up with other worker timers.
+    constexpr std::chrono::milliseconds kPositionTickSlack{10};
+    // In anchor mode the tick only looks for drift; changes arrive as events.
+    constexpr std::chrono::milliseconds kAnchorCheckInterval{1000};
+    // Drift from the last sent anchor that is worth a correction, a bit
+    // under what a seconds display could show.
+    constexpr std::chrono::milliseconds kAnchorDriftThreshold{250};
+
+    // A full media map every this many delta events.
+    constexpr uint32_t kMediaKeyframeInterval = 20;
+
+    constexpr std::chrono::milliseconds kDefaultCallTimeout{3000};
+    constexpr std::chrono::milliseconds kShutdownBudget{500};
+    // DeadlineTable key for thumbnail reads, next to the method names.
+    constexpr char kAlbumArtDeadline[] = "albumArt";
+
+    void CompleteCall(flutter::MethodResult<flutter::EncodableValue> &result,
+                      CallResult call_result,
+                      const std::string &method_name)
+    {
+      switch (call_result)
+      {
+      case CallResult::Success:
+        result.Success(flutter::EncodableValue(true));
+        break;
+      case CallResult::Failure:
+        result.Success(flutter::EncodableValue(false));
+        break;
+      case CallResult::Timeout:
+        result.Error("TIMEOUT", method_name + " did not complete before its deadline");
+        break;
+      }
+    }
+
+    // Reads {"intervalMs": int, "alignToSecond": bool, "anchorsOnly": bool},
+    // as sent with the position stream's listen call or with
+    // setPositionOptions.
+    PositionStreamOptions ParsePositionOptions(const flutter::EncodableValue *arguments)
+    {
+      PositionStreamOptions options;
+      options.tick.interval = kPositionTickInterval;
+
+      const auto *map = arguments ? std::get_if<flutter::EncodableMap>(arguments) : nullptr;
+      if (!map)
+      {
+        return options;
+      }
+
+      auto interval = map->find(flutter::EncodableValue("intervalMs"));
+      if (interval != map->end() &&
+          (std::holds_alternative<int32_t>(interval->second) || std::holds_alternative<int64_t>(interval->second)))
+      {
+        options.tick.interval = std::max(kMinPositionTickInterval, std::chrono::milliseconds(interval->second.LongValue()));
+      }
+
+      auto align = map->find(flutter::EncodableValue("alignToSecond"));
+      if (align != map->end())
+      {
+        if (const auto *value = std::get_if<bool>(&align->second))
+        {
+          options.tick.align_to_second = *value;
+        }
+      }
+
+      auto anchors_only = map->find(flutter::EncodableValue("anchorsOnly"));
+      if (anchors_only != map->end())
+      {
+        if (const auto *value = std::get_if<bool>(&anchors_only->second))
+        {
+          options.anchors_only = *value;
+        }
+      }
+
+      if (options.anchors_only)
+      {
+        options.tick.interval = kAnchorCheckInterval;
+        options.tick.align_to_second = false;
+      }
+
+      return options;
+    }
+
+    // Reads {"delta": bool} from the media stream's listen call.
+    bool ParseMediaDeltaMode(const flutter::EncodableValue *arguments)
+    {
+      const auto *map = arguments ? std::get_if<flutter::EncodableMap>(arguments) : nullptr;
+      if (!map)
+      {
+        return false;
+      }
+      auto delta = map->find(flutter::EncodableValue("delta"));
+      if (delta == map->end())
+      {
+        return false;
+      }
+      const auto *value = std::get_if<bool>(&delta->second);
+      return value && *value;
+    }
+
+    // Reads {"settleWindowMs": int, "settleLeading": bool, "settleTrailing":
+    // bool, "settleMaxWaitMs": int}, as sent with the media stream's listen
+    // call or with setMediaSettleOptions.
+    SettleOptions ParseSettleOptions(const flutter::EncodableValue *arguments)
+    {
+      SettleOptions options;
+      const auto *map = arguments ? std::get_if<flutter::EncodableMap>(arguments) : nullptr;
+      if (!map)
+      {
+        return options;
+      }
+
+      auto milliseconds = [map](const char *key, std::chrono::milliseconds &out)
+      {
+        auto value = map->find(flutter::EncodableValue(key));
+        if (value != map->end() &&
+            (std::holds_alternative<int32_t>(value->second) || std::holds_alternative<int64_t>(value->second)))
+        {
+          out = std::chrono::milliseconds(std::max<int64_t>(0, value->second.LongValue()));
+        }
+      };
+      auto flag = [map](const char *key, bool &out)
+      {
+        auto value = map->find(flutter::EncodableValue(key));
+        if (value != map->end())
+        {
+          if (const auto *b = std::get_if<bool>(&value->second))
+          {
+            out = *b;
+          }
+        }
+      };
+
+      milliseconds("settleWindowMs", options.window);
+      flag("settleLeading", options.leading);
+      flag("settleTrailing", options.trailing);
+      milliseconds("settleMaxWaitMs", options.max_wait);
+      return options;
+    }
+
+    // Reads {"artSize": int | preset name, "artFormat": "png" | "jpeg" |
+    // "original", "artDelivery": "bytes" | "file"}, as sent with the media
+    // stream's listen call, with getCurrentMedia or with setAlbumArtOptions.
+    MediaArtOptions ParseMediaArtOptions(const flutter::EncodableValue *arguments)
+    {
+      MediaArtOptions options;
+      const auto *map = arguments ? std::get_if<flutter::EncodableMap>(arguments) : nullptr;
+      if (!map)
+      {
+        return options;
+      }
+
+      auto size = map->find(flutter::EncodableValue("artSize"));
+      if (size != map->end())
+      {
+        if (std::holds_alternative<int32_t>(size->second) || std::holds_alternative<int64_t>(size->second))
+        {
+          options.shape.max_dimension = static_cast<uint32_t>(std::max<int64_t>(0, size->second.LongValue()));
+        }
+        else if (const auto *preset = std::get_if<std::string>(&size->second))
+        {
+          options.shape.max_dimension = ArtSizePreset(*preset).value_or(0);
+        }
+      }
+
+      auto format = map->find(flutter::EncodableValue("artFormat"));
+      if (format != map->end())
+      {
+        if (const auto *value = std::get_if<std::string>(&format->second))
+        {
+          if (*value == "png")
+          {
+            options.shape.format = ArtFormat::Png;
+          }
+          else if (*value == "jpeg")
+          {
+            options.shape.format = ArtFormat::Jpeg;
+          }
+        }
+      }
+
+      auto delivery = map->find(flutter::EncodableValue("artDelivery"));
+      if (delivery != map->end())
+      {
+        if (const auto *value = std::get_if<std::string>(&delivery->second))
+        {
+          options.as_file = *value == "file";
+        }
+      }
+      return options;
+    }
+
+    // {"path": string, "offset": int, "length": int, "hash": int}
+    flutter::EncodableMap ToArtFileEvent(const ArtFileRef &ref)
+    {
+      return flutter::EncodableMap{
+          {flutter::EncodableValue("path"), flutter::EncodableValue(ref.path)},
+          {flutter::EncodableValue("offset"), flutter::EncodableValue(static_cast<int64_t>(ref.offset))},
+          {flutter::EncodableValue("length"), flutter::EncodableValue(static_cast<int64_t>(ref.length))},
+          {flutter::EncodableValue("hash"), flutter::EncodableValue(static_cast<int64_t>(ref.hash))},
+      };
+    }
+
+    // The SourceAppUserModelId a method targets; empty for the current
+    // session.
+    std::string ParseSessionId(const flutter::EncodableValue *arguments)
+    {
+      const auto *map = arguments ? std::get_if<flutter::EncodableMap>(arguments) : nullptr;
+      if (!map)
+      {
+        return {};
+      }
+      auto id = map->find(flutter::EncodableValue("sessionId"));
+      if (id == map->end())
+      {
+        return {};
+      }
+      const auto *value = std::get_if<std::string>(&id->second);
+      return value ? *value : std::string();
+    }
+
+    flutter::EncodableValue ToSessionMap(const SessionState &state)
+    {
+      return flutter::EncodableValue(flutter::EncodableMap{
+          {flutter::EncodableValue("id"), flutter::EncodableValue(state.id)},
+          {flutter::EncodableValue("title"), flutter::EncodableValue(state.title)},
+          {flutter::EncodableValue("artist"), flutter::EncodableValue(state.artist)},
+          {flutter::EncodableValue("album"), flutter::EncodableValue(state.album)},
+          {flutter::EncodableValue("state"), flutter::EncodableValue(state.playback_state)},
+          {flutter::EncodableValue("isPlaying"), flutter::EncodableValue(state.is_playing)},
+      });
+    }
+
+    flutter::EncodableList ToSessionList(const std::vector<SessionState> &states)
+    {
+      flutter::EncodableList list;
+      list.reserve(states.size());
+      for (const auto &state : states)
+      {
+        list.push_back(ToSessionMap(state));
+      }
+      return list;
+    }
+
+    std::filesystem::path ArtFileRoot()
+    {
+      std::error_code error;
+      auto temp = std::filesystem::temp_directory_path(error);
+      return error ? std::filesystem::path() : temp / "media_notification_service";
+    }
+
+    // {"seq": int, "keyframe": bool, "set": map, "removed": [keys]}
+    flutter::EncodableMap ToDeltaEvent(DeltaEncoder<flutter::EncodableMap>::Delta &&delta)
+    {
+      flutter::EncodableList removed(std::make_move_iterator(delta.removed.begin()),
+                                     std::make_move_iterator(delta.removed.end()));
+      return flutter::EncodableMap{
+          {flutter::EncodableValue("seq"), flutter::EncodableValue(static_cast<int64_t>(delta.sequence))},
+          {flutter::EncodableValue("keyframe"), flutter::EncodableValue(delta.keyframe)},
+          {flutter::EncodableValue("set"), flutter::EncodableValue(std::move(delta.set))},
+          {flutter::EncodableValue("removed"), flutter::EncodableValue(std::move(removed))},
+      };
+    }
+
+    PositionAnchor ToPositionAnchor(const flutter::EncodableMap &map, const PlaybackSample &sample)
+    {
+      PositionAnchor anchor;
+      anchor.position_ms = sample.position.count();
+      anchor.rate = sample.rate;
+      anchor.playing = sample.advancing;
+
+      auto timestamp = map.find(flutter::EncodableValue("anchorTimestamp"));
+      if (timestamp != map.end())
+      {
+        anchor.timestamp_ms = timestamp->second.LongValue();
+      }
+      auto duration = map.find(flutter::EncodableValue("duration"));
+      if (duration != map.end())
+      {
+        anchor.duration_ms = duration->second.LongValue();
+      }
+      auto state = map.find(flutter::EncodableValue("state"));
+      if (state != map.end())
+      {
+        if (const auto *value = std::get_if<std::string>(&state->second))
+        {
+          anchor.state = *value;
+        }
+      }
+      return anchor;
+    }
+  } // namespace
+
+  // Hands a method result to the platform thread instead of completing it
+  // on whichever thread the call finished on.
+  class PlatformThreadResult : public flutter::MethodResult<flutter::EncodableValue>
+  {
+  public:
+    PlatformThreadResult(std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result,
+                         PlatformDispatcher &dispatcher)
+        : result_(std::move(result)), dispatcher_(dispatcher) {}
+
+    // Moves |value| across instead of copying it as Success() must, e.g.
+    // for a media map with its album art.
+    void SuccessMoved(flutter::EncodableValue value)
+    {
+      dispatcher_.Post([inner = result_, value = std::make_shared<flutter::EncodableValue>(std::move(value))]()
+                       { inner->Success(*value); });
+    }
+
+  protected:
+    void SuccessInternal(const flutter::EncodableValue *value) override
+    {
+      auto copy = std::make_shared<flutter::EncodableValue>(value ? *value : flutter::EncodableValue());
+      dispatcher_.Post([inner = result_, copy]()
+                       { inner->Success(*copy); });
+    }
+
+    void ErrorInternal(const std::string &error_code,
+                       const std::string &error_message,
+                       const flutter::EncodableValue *error_details) override
+    {
+      struct Error
+      {
+        std::string code;
+        std::string message;
+        std::optional<flutter::EncodableValue> details;
+      };
+      auto error = std::make_shared<Error>();
+      error->code = error_code;
+      error->message = error_message;
+      if (error_details)
+      {
+        error->details = *error_details;
+      }
+      dispatcher_.Post([inner = result_, error]()
+                       { inner->Error(error->code, error->message,
+                                      error->details ? *error->details : flutter::EncodableValue()); });
+    }
+
+    void NotImplementedInternal() override
+    {
+      dispatcher_.Post([inner = result_]()
+                       { inner->NotImplemented(); });
+    }
+
+  private:
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> result_;
+    PlatformDispatcher &dispatcher_;
+  };
+
   void MediaNotificationServicePlugin::RegisterWithRegistrar(
       flutter::PluginRegistrarWindows *registrar)
   {
     auto plugin = std::make_unique<MediaNotificationServicePlugin>();
+    plugin->service_->RegisterChannels(registrar);
+    registrar->AddPlugin(std::move(plugin));
+  }
+
+  MediaNotificationServicePlugin::MediaNotificationServicePlugin() {}
 
+  MediaNotificationServicePlugin::~MediaNotificationServicePlugin()
+  {
+    service_->Shutdown();
+  }
+
+  void MediaNotificationService::RegisterChannels(flutter::PluginRegistrarWindows *registrar)
+  {
     auto method_channel =
         std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
             registrar->messenger(),
             "com.example.media_notification_service/media",
             &flutter::StandardMethodCodec::GetInstance());
 
-    auto plugin_pointer = plugin.get();
-
     method_channel->SetMethodCallHandler(
-        [plugin_pointer](const auto &call, auto result)
+        [this](const auto &call, auto result)
         {
-          plugin_pointer->HandleMethodCall(call, std::move(result));
+          HandleMethodCall(call, std::move(result));
         });
 
-    plugin->media_stream_handler_.RegisterEventChannel(
+    media_stream_handler_.RegisterEventChannel(
         registrar,
         "com.example.media_notification_service/media_stream",
-        [plugin_pointer](const flutter::EncodableValue *arguments)
+        [this](const flutter::EncodableValue *arguments)
         {
-          plugin_pointer->worker_thread_.EnqueueTask([plugin_pointer]()
-                                                     {
-                    plugin_pointer->media_session_manager_.SetupMediaEventListeners(
-                        [plugin_pointer](bool song_changed)
+          bool delta_mode = ParseMediaDeltaMode(arguments);
+          MediaArtOptions art_options = ParseMediaArtOptions(arguments);
+          SettleOptions settle_options = ParseSettleOptions(arguments);
+          worker_thread_.EnqueueTask([this, delta_mode, art_options, settle_options]()
+                                     {
+                    media_delta_mode_ = delta_mode;
+                    media_settle_.SetOptions(settle_options);
+                    media_delta_encoder_.RequestKeyframe();
+                    ApplyMediaArtOptions(art_options);
+                    media_stream_art_version_ = 0;
+                    media_session_manager_.SetupMediaEventListeners(
+                        [this](bool song_changed)
                         {
-                            plugin_pointer->OnMediaChanged(song_changed);
+                            RequestMediaRefresh(song_changed);
                         });
-                    plugin_pointer->OnMediaChanged(true); });
+                    OnMediaChanged(true); },
+                                     TaskPriority::Control);
         },
-        [plugin_pointer](const flutter::EncodableValue *arguments)
+        [this](const flutter::EncodableValue *arguments)
         {
-          plugin_pointer->worker_thread_.EnqueueTask([plugin_pointer]()
-                                                     { plugin_pointer->media_session_manager_.RemoveMediaEventListeners(); });
+          worker_thread_.EnqueueTask([this]()
+                                     {
+                    media_session_manager_.RemoveMediaEventListeners();
+                    StopMediaSettle(); },
+                                     TaskPriority::Control);
         });
 
-    plugin->position_stream_handler_.RegisterEventChannel(
+    position_stream_handler_.RegisterEventChannel(
         registrar,
         "com.example.media_notification_service/position_stream",
-        [plugin_pointer](const flutter::EncodableValue *arguments)
-        {
-          plugin_pointer->worker_thread_.EnqueueTask([plugin_pointer]()
-                                                     { plugin_pointer->media_session_manager_.SetupPositionEventListeners(
-                                                           [plugin_pointer]()
-                                                           {
-                                                             plugin_pointer->OnPositionChanged();
-                                                           }); });
-
-          plugin_pointer->position_timer_.Start(
-              std::chrono::milliseconds(100),
-              [plugin_pointer]()
-              {
-                plugin_pointer->worker_thread_.EnqueueTask([plugin_pointer]()
-                                                           { plugin_pointer->OnPositionChanged(); });
-              });
+        [this](const flutter::EncodableValue *arguments)
+        {
+          auto options = ParsePositionOptions(arguments);
+          worker_thread_.EnqueueTask([this, options]()
+                                     {
+                    ApplyPositionOptions(options);
+                    media_session_manager_.SetupPositionEventListeners(
+                        [this]()
+                        {
+                            RequestPositionRefresh();
+                        });
+                    position_ticker_.Start(
+                        [this]()
+                        {
+                            return SendPositionInfo();
+                        }); },
+                                     TaskPriority::Control);
         },
-        [plugin_pointer](const flutter::EncodableValue *arguments)
+        [this](const flutter::EncodableValue *arguments)
         {
-          plugin_pointer->position_timer_.Stop();
-          plugin_pointer->worker_thread_.EnqueueTask([plugin_pointer]()
-                                                     { plugin_pointer->media_session_manager_.RemovePositionEventListeners(); });
+          worker_thread_.EnqueueTask([this]()
+                                     {
+                    position_ticker_.Stop();
+                    media_session_manager_.RemovePositionEventListeners(); },
+                                     TaskPriority::Control);
+        });
+
+    sessions_stream_handler_.RegisterEventChannel(
+        registrar,
+        "com.example.media_notification_service/sessions_stream",
+        [this](const flutter::EncodableValue *arguments)
+        {
+          worker_thread_.EnqueueTask([this]()
+                                     {
+                    sessions_listening_ = true;
+                    sessions_keyframe_pending_ = true;
+                    media_session_manager_.SetupSessionsListeners(
+                        [this]()
+                        {
+                            RequestSessionsRefresh();
+                        });
+                    OnSessionsChanged(); },
+                                     TaskPriority::Control);
+        },
+        [this](const flutter::EncodableValue *arguments)
+        {
+          worker_thread_.EnqueueTask([this]()
+                                     {
+                    sessions_listening_ = false;
+                    media_session_manager_.RemoveSessionsListeners(); },
+                                     TaskPriority::Control);
         });
 
     // queue stream is not supported on Windows
-    plugin->queue_stream_handler_.RegisterEventChannel(
+    queue_stream_handler_.RegisterEventChannel(
         registrar,
         "com.example.media_notification_service/queue_stream");
-
-    registrar->AddPlugin(std::move(plugin));
   }
 
-  MediaNotificationServicePlugin::MediaNotificationServicePlugin()
+  MediaNotificationService::MediaNotificationService()
+      : position_ticker_(worker_thread_, kPositionTickInterval, kPositionTickSlack),
+        position_anchor_filter_(kAnchorDriftThreshold),
+        deadlines_(kDefaultCallTimeout),
+        media_delta_encoder_(kMediaKeyframeInterval, {flutter::EncodableValue("songChanged"),
+                                                     flutter::EncodableValue("albumArtUnchanged")}),
+        art_file_store_(ArtFileStore::Options{ArtFileRoot()})
   {
     worker_thread_.EnqueueTask([this]()
-                               { media_session_manager_.Initialize(); });
+                               { media_session_manager_.Initialize(); },
+                               TaskPriority::Control);
   }
 
-  MediaNotificationServicePlugin::~MediaNotificationServicePlugin()
+  MediaNotificationService::~MediaNotificationService()
+  {
+    // Finishes a transcode in progress; the worker it would resume on is gone.
+    image_pool_.Stop();
+  }
+
+  void MediaNotificationService::Shutdown()
   {
     worker_thread_.EnqueueTask([this]()
-                               { media_session_manager_.RemoveMediaEventListeners(); });
+                               {
+                                 position_ticker_.Stop();
+                                 media_session_manager_.RemoveMediaEventListeners();
+                                 media_session_manager_.RemovePositionEventListeners();
+                                 media_session_manager_.RemoveSessionsListeners(); },
+                               TaskPriority::Control);
+
+    // Pending refreshes and ticks are dropped; only the listener cleanup runs.
+    // Async operations completing after this never resume their coroutines.
+    auto report = worker_thread_.Shutdown(kShutdownBudget, shared_from_this());
+    if (report.timed_out)
+    {
+      // The worker holds on to this until the stuck task returns and the
+      // cleanup has run, and may be the one to destroy it.
+      OutputDebugStringA("media_notification_service: worker shutdown timed out, leaving it to clean up\n");
+    }
+    // Whatever the worker still sends is dropped from here on.
+    message_window_.Close();
+  }
+
+  void MediaNotificationService::RequestMediaRefresh(bool song_changed)
+  {
+    // Track changes fire several WinRT events back to back; while one refresh
+    // is still queued the others only add their songChanged bit to it.
+    worker_thread_.EnqueueCoalesced(
+        kMediaRefreshKey,
+        [this](uint32_t flags)
+        { OnMediaEvent((flags & kSongChangedFlag) != 0); },
+        song_changed ? kSongChangedFlag : 0,
+        TaskPriority::Metadata);
+  }
+
+  void MediaNotificationService::RequestPositionRefresh()
+  {
+    worker_thread_.EnqueueCoalesced(
+        kPositionRefreshKey,
+        [this](uint32_t)
+        { position_ticker_.Refresh(); },
+        0,
+        TaskPriority::Position);
+  }
+
+  void MediaNotificationService::RequestSessionsRefresh()
+  {
+    worker_thread_.EnqueueCoalesced(
+        kSessionsRefreshKey,
+        [this](uint32_t)
+        { OnSessionsChanged(); },
+        0,
+        TaskPriority::Metadata);
+  }
+
+  void MediaNotificationService::OnMediaEvent(bool song_changed)
+  {
+    // Browsers publish a track change piece by piece: title, artist, then
+    // the thumbnail once it loads. Refreshing on each would fetch and send
+    // half-filled tracks, so the burst settles first. Other changes go
+    // straight through unless they land inside a burst.
+    if (!song_changed && !media_settle_.InBurst())
+    {
+      OnMediaChanged(false);
+      return;
+    }
+
+    settle_song_changed_ = settle_song_changed_ || song_changed;
+    if (media_settle_.OnEvent(std::chrono::steady_clock::now()))
+    {
+      OnMediaChanged(std::exchange(settle_song_changed_, false));
+    }
+    ArmMediaSettleTimer();
   }
 
-  void MediaNotificationServicePlugin::OnMediaChanged(bool song_changed)
+  void MediaNotificationService::OnMediaSettleTimer()
   {
-    auto map = media_session_manager_.GetCurrentMediaInfo();
+    media_settle_timer_.reset();
+    if (media_settle_.OnTimer(std::chrono::steady_clock::now()))
+    {
+      OnMediaChanged(std::exchange(settle_song_changed_, false));
+    }
+    if (!media_settle_.InBurst())
+    {
+      // Dropped with the rest of the burst when there is no trailing emit.
+      settle_song_changed_ = false;
+    }
+    ArmMediaSettleTimer();
+  }
+
+  void MediaNotificationService::ArmMediaSettleTimer()
+  {
+    // Events only push the deadline back, so one timer per burst is enough;
+    // firing early just re-arms it.
+    auto deadline = media_settle_.Deadline();
+    if (!deadline || media_settle_timer_)
+    {
+      return;
+    }
+    auto delay = std::chrono::ceil<std::chrono::milliseconds>(*deadline - std::chrono::steady_clock::now());
+    media_settle_timer_ = worker_thread_.EnqueueAfter(std::max(delay, std::chrono::milliseconds::zero()),
+                                                      [this]()
+                                                      { OnMediaSettleTimer(); },
+                                                      std::chrono::milliseconds::zero(), TaskPriority::Metadata);
+  }
+
+  void MediaNotificationService::StopMediaSettle()
+  {
+    if (media_settle_timer_)
+    {
+      worker_thread_.CancelTimer(*media_settle_timer_);
+      media_settle_timer_.reset();
+    }
+    media_settle_.Reset();
+    settle_song_changed_ = false;
+  }
+
+  void MediaNotificationService::OnMediaChanged(bool song_changed)
+  {
+    pending_song_changed_ = pending_song_changed_ || song_changed;
+
+    // The fetch no longer holds up the worker, so without this every event
+    // during a slow fetch would start another one.
+    if (media_refresh_in_flight_)
+    {
+      media_refresh_requested_ = true;
+      return;
+    }
+
+    media_refresh_in_flight_ = true;
+    Spawn(RefreshMediaAsync(), [this]()
+          {
+            media_refresh_in_flight_ = false;
+            if (std::exchange(media_refresh_requested_, false))
+            {
+              OnMediaChanged();
+            } });
+  }
+
+  CoTask<> MediaNotificationService::RefreshMediaAsync()
+  {
+    // Events during the fetch set the flag again for the follow-up refresh.
+    bool song_changed = std::exchange(pending_song_changed_, false);
+    auto info = co_await media_session_manager_.GetCurrentMediaInfoAsync(
+        deadlines_.Get("getCurrentMedia"), deadlines_.Get(kAlbumArtDeadline), media_art_options_.shape);
+    if (info.result != CallResult::Success)
+    {
+      // The map is empty, and a delta against it would clear every field
+      // the receiver has. The next refresh reports the track change.
+      pending_song_changed_ = pending_song_changed_ || song_changed;
+      co_return;
+    }
+
+    // Sent even if events arrived meanwhile: under a steady stream of them
+    // dropping it would mean never sending anything. The follow-up brings
+    // the newer state.
+    auto &map = info.map;
     map[flutter::EncodableValue("songChanged")] = flutter::EncodableValue(song_changed);
-    media_stream_handler_.Send(flutter::EncodableValue(map));
+
+    // getCurrentMedia() calls share the manager, so whether the art changed
+    // is decided against what this stream last sent.
+    auto art = map.find(flutter::EncodableValue("albumArt"));
+    if (art != map.end())
+    {
+      bool art_unchanged = info.art_version == media_stream_art_version_;
+      media_stream_art_version_ = info.art_version;
+      map[flutter::EncodableValue("albumArtUnchanged")] = flutter::EncodableValue(art_unchanged);
+      if (media_art_options_.as_file)
+      {
+        MoveArtToFile(map);
+      }
+      // Delta events leave out unchanged fields anyway.
+      else if (art_unchanged && !media_delta_mode_)
+      {
+        map.erase(art);
+      }
+    }
+    else
+    {
+      media_stream_art_version_ = 0;
+    }
+
+    if (media_delta_mode_)
+    {
+      media_stream_handler_.Send(flutter::EncodableValue(ToDeltaEvent(media_delta_encoder_.Encode(std::move(map)))));
+      co_return;
+    }
+    media_stream_handler_.Send(flutter::EncodableValue(std::move(map)));
   }
 
-  void MediaNotificationServicePlugin::OnPositionChanged()
+  void MediaNotificationService::OnSessionsChanged()
   {
-    auto map = media_session_manager_.GetCurrentPositionInfo();
-    position_stream_handler_.Send(flutter::EncodableValue(map));
+    // Events that land during a refresh mark their sessions stale; one
+    // follow-up fetches all of them.
+    if (sessions_refresh_in_flight_)
+    {
+      sessions_refresh_requested_ = true;
+      return;
+    }
+
+    sessions_refresh_in_flight_ = true;
+    Spawn(RefreshSessionsAsync(), [this]()
+          {
+            sessions_refresh_in_flight_ = false;
+            if (std::exchange(sessions_refresh_requested_, false))
+            {
+              OnSessionsChanged();
+            } });
+  }
+
+  CoTask<> MediaNotificationService::RefreshSessionsAsync()
+  {
+    SendSessionsEvent(co_await media_session_manager_.RefreshSessionsAsync(deadlines_.Get("getSessions")));
   }
 
-  void MediaNotificationServicePlugin::HandleMethodCall(
+  CoTask<> MediaNotificationService::GetSessionsAsync(std::shared_ptr<PlatformThreadResult> result)
+  {
+    // Changes this refresh finds are the stream's to report too.
+    SendSessionsEvent(co_await media_session_manager_.RefreshSessionsAsync(deadlines_.Get("getSessions")));
+    result->SuccessMoved(flutter::EncodableValue(ToSessionList(media_session_manager_.Sessions().All())));
+  }
+
+  // {"keyframe": bool, "sessions": [session], "removed": [id]}; a keyframe
+  // lists every session and replaces whatever the receiver had.
+  void MediaNotificationService::SendSessionsEvent(SessionRegistry::Changes changes)
+  {
+    if (!sessions_listening_)
+    {
+      return;
+    }
+    bool keyframe = std::exchange(sessions_keyframe_pending_, false);
+    if (!keyframe && changes.Empty())
+    {
+      return;
+    }
+
+    flutter::EncodableList removed;
+    if (!keyframe)
+    {
+      removed.reserve(changes.removed.size());
+      for (auto &id : changes.removed)
+      {
+        removed.emplace_back(std::move(id));
+      }
+    }
+    flutter::EncodableMap event{
+        {flutter::EncodableValue("keyframe"), flutter::EncodableValue(keyframe)},
+        {flutter::EncodableValue("sessions"),
+         flutter::EncodableValue(ToSessionList(keyframe ? media_session_manager_.Sessions().All() : changes.changed))},
+        {flutter::EncodableValue("removed"), flutter::EncodableValue(std::move(removed))},
+    };
+    sessions_stream_handler_.Send(flutter::EncodableValue(std::move(event)));
+  }
+
+  PlaybackSample MediaNotificationService::SendPositionInfo()
+  {
+    PlaybackSample sample;
+    auto map = media_session_manager_.GetCurrentPositionInfo(&sample.advancing);
+
+    auto position = map.find(flutter::EncodableValue("position"));
+    if (position != map.end())
+    {
+      sample.position = std::chrono::milliseconds(position->second.LongValue());
+    }
+    auto speed = map.find(flutter::EncodableValue("playbackSpeed"));
+    if (speed != map.end())
+    {
+      if (const auto *rate = std::get_if<double>(&speed->second))
+      {
+        sample.rate = *rate;
+      }
+    }
+
+    // Anchor subscribers extrapolate on their own, so a sample that matches
+    // where they already are is not sent.
+    if (!position_anchors_only_ || position_anchor_filter_.Accept(ToPositionAnchor(map, sample)))
+    {
+      position_stream_handler_.Send(flutter::EncodableValue(std::move(map)));
+    }
+    return sample;
+  }
+
+  void MediaNotificationService::ApplyPositionOptions(const PositionStreamOptions &options)
+  {
+    position_anchors_only_ = options.anchors_only;
+    // Whatever was sent before may have been filtered differently.
+    position_anchor_filter_.Reset();
+    position_ticker_.SetOptions(options.tick);
+  }
+
+  void MediaNotificationService::ApplyMediaArtOptions(const MediaArtOptions &options)
+  {
+    if (options == media_art_options_)
+    {
+      return;
+    }
+    media_art_options_ = options;
+    // The next event carries the art in its new shape.
+    media_stream_art_version_ = 0;
+  }
+
+  CoTask<> MediaNotificationService::GetCurrentMediaAsync(
+      std::shared_ptr<PlatformThreadResult> result,
+      MediaArtOptions art_options)
+  {
+    auto info = co_await media_session_manager_.GetCurrentMediaInfoAsync(
+        deadlines_.Get("getCurrentMedia"), deadlines_.Get(kAlbumArtDeadline), art_options.shape);
+    if (info.result == CallResult::Timeout)
+    {
+      CompleteCall(*result, info.result, "getCurrentMedia");
+      co_return;
+    }
+    if (art_options.as_file)
+    {
+      MoveArtToFile(info.map);
+    }
+    result->SuccessMoved(flutter::EncodableValue(std::move(info.map)));
+  }
+
+  void MediaNotificationService::MoveArtToFile(flutter::EncodableMap &map)
+  {
+    auto art = map.find(flutter::EncodableValue("albumArt"));
+    if (art == map.end() || !art_file_store_.Open())
+    {
+      return;
+    }
+    const auto *bytes = std::get_if<std::vector<uint8_t>>(&art->second);
+    if (!bytes)
+    {
+      return;
+    }
+    // Falls back to sending the bytes if the store cannot take them.
+    auto ref = art_file_store_.Put(*bytes);
+    if (!ref)
+    {
+      return;
+    }
+    map.erase(art);
+    map[flutter::EncodableValue("albumArtFile")] = flutter::EncodableValue(ToArtFileEvent(*ref));
+  }
+
+  void MediaNotificationService::HandleMethodCall(
       const flutter::MethodCall<flutter::EncodableValue> &method_call,
-      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result)
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> engine_result)
   {
     std::string name = method_call.method_name();
     Method method = MethodStringToEnum(name);
+    auto result = std::make_shared<PlatformThreadResult>(std::move(engine_result), dispatcher_);
 
     switch (method)
     {
     case Method::GetCurrentMedia:
     {
-      auto result_shared = std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>(std::move(result));
+      MediaArtOptions art_options = ParseMediaArtOptions(method_call.arguments());
 
-      worker_thread_.EnqueueTask([this, result = result_shared]()
-                                 {
-             auto map = media_session_manager_.GetCurrentMediaInfo();
-             result->Success(flutter::EncodableValue(map)); });
+      worker_thread_.EnqueueTask([this, art_options, result]()
+                                 { Spawn(GetCurrentMediaAsync(result, art_options)); },
+                                 TaskPriority::Metadata);
     }
     break;
     case Method::PlayPause:
     {
-      auto result_shared = std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>(std::move(result));
+      std::string session_id = ParseSessionId(method_call.arguments());
 
-      worker_thread_.EnqueueTask([this, result = result_shared]()
-                                 {
-             auto success = media_session_manager_.PlayPause();
-             result->Success(flutter::EncodableValue(success)); });
+      worker_thread_.EnqueueTask([this, session_id = std::move(session_id), result]()
+                                 { Spawn(media_session_manager_.PlayPauseAsync(deadlines_.Get("playPause"), session_id),
+                                         [result](CallResult call_result)
+                                         { CompleteCall(*result, call_result, "playPause"); }); },
+                                 TaskPriority::Control);
     }
     break;
     case Method::SkipToNext:
     {
-      auto result_shared = std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>(std::move(result));
+      std::string session_id = ParseSessionId(method_call.arguments());
 
-      worker_thread_.EnqueueTask([this, result = result_shared]()
-                                 {
-             auto success = media_session_manager_.SkipToNext();
-             result->Success(flutter::EncodableValue(success)); });
+      worker_thread_.EnqueueTask([this, session_id = std::move(session_id), result]()
+                                 { Spawn(media_session_manager_.SkipToNextAsync(deadlines_.Get("skipToNext"), session_id),
+                                         [result](CallResult call_result)
+                                         { CompleteCall(*result, call_result, "skipToNext"); }); },
+                                 TaskPriority::Control);
     }
     break;
     case Method::SkipToPrevious:
     {
-      auto result_shared = std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>(std::move(result));
+      std::string session_id = ParseSessionId(method_call.arguments());
 
-      worker_thread_.EnqueueTask([this, result = result_shared]()
-                                 {
-             auto success = media_session_manager_.SkipToPrevious();
-             result->Success(flutter::EncodableValue(success)); });
+      worker_thread_.EnqueueTask([this, session_id = std::move(session_id), result]()
+                                 { Spawn(media_session_manager_.SkipToPreviousAsync(deadlines_.Get("skipToPrevious"), session_id),
+                                         [result](CallResult call_result)
+                                         { CompleteCall(*result, call_result, "skipToPrevious"); }); },
+                                 TaskPriority::Control);
     }
     break;
     case Method::Stop:
     {
-      auto result_shared = std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>(std::move(result));
+      std::string session_id = ParseSessionId(method_call.arguments());
 
-      worker_thread_.EnqueueTask([this, result = result_shared]()
-                                 {
-             auto success = media_session_manager_.Stop();
-             result->Success(flutter::EncodableValue(success)); });
+      worker_thread_.EnqueueTask([this, session_id = std::move(session_id), result]()
+                                 { Spawn(media_session_manager_.StopAsync(deadlines_.Get("stop"), session_id),
+                                         [result](CallResult call_result)
+                                         { CompleteCall(*result, call_result, "stop"); }); },
+                                 TaskPriority::Control);
     }
+    break;
     case Method::SeekTo:
     {
-      auto result_shared = std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>>(std::move(result));
-
       int64_t position_ms = 0;
       if (const auto *arg = std::get_if<flutter::EncodableMap>(method_call.arguments()))
       {
@@ -176,10 +936,94 @@ namespace media_notification_service
         }
       }
 
-      worker_thread_.EnqueueTask([this, position_ms, result = result_shared]()
-                                 { 
-                                   auto success = media_session_manager_.SeekTo(position_ms);
-                                   result->Success(flutter::EncodableValue(success)); });
+      std::string session_id = ParseSessionId(method_call.arguments());
+
+      worker_thread_.EnqueueTask([this, position_ms, session_id = std::move(session_id), result]()
+                                 { Spawn(media_session_manager_.SeekToAsync(position_ms, deadlines_.Get("seekTo"), session_id),
+                                         [result](CallResult call_result)
+                                         { CompleteCall(*result, call_result, "seekTo"); }); },
+                                 TaskPriority::Control);
+    }
+    break;
+    case Method::SetTimeouts:
+    {
+      std::vector<std::pair<std::string, std::chrono::milliseconds>> timeouts;
+      if (const auto *arg = std::get_if<flutter::EncodableMap>(method_call.arguments()))
+      {
+        for (const auto &[key, value] : *arg)
+        {
+          const auto *method_name = std::get_if<std::string>(&key);
+          bool is_integer = std::holds_alternative<int32_t>(value) || std::holds_alternative<int64_t>(value);
+          if (method_name && is_integer)
+          {
+            timeouts.emplace_back(*method_name, std::chrono::milliseconds(value.LongValue()));
+          }
+        }
+      }
+
+      worker_thread_.EnqueueTask([this, timeouts = std::move(timeouts), result]()
+                                 {
+                                   for (const auto &[method_name, timeout] : timeouts)
+                                   {
+                                     deadlines_.Set(method_name, timeout);
+                                   }
+                                   result->Success(flutter::EncodableValue(true)); },
+                                 TaskPriority::Control);
+    }
+    break;
+    case Method::RequestMediaKeyframe:
+    {
+      // A receiver that lost track of the deltas; resend everything.
+      worker_thread_.EnqueueTask([this]()
+                                 {
+                                   media_delta_encoder_.RequestKeyframe();
+                                   RequestMediaRefresh(false); },
+                                 TaskPriority::Control);
+      result->Success(flutter::EncodableValue(true));
+    }
+    break;
+    case Method::SetAlbumArtOptions:
+    {
+      MediaArtOptions art_options = ParseMediaArtOptions(method_call.arguments());
+      worker_thread_.EnqueueTask([this, art_options]()
+                                 {
+                                   ApplyMediaArtOptions(art_options);
+                                   RequestMediaRefresh(false); },
+                                 TaskPriority::Control);
+      result->Success(flutter::EncodableValue(true));
+    }
+    break;
+    case Method::SetMediaSettleOptions:
+    {
+      SettleOptions settle_options = ParseSettleOptions(method_call.arguments());
+      worker_thread_.EnqueueTask([this, settle_options]()
+                                 {
+                                   media_settle_.SetOptions(settle_options);
+                                   // A shorter window may bring the deadline forward.
+                                   if (media_settle_timer_)
+                                   {
+                                     worker_thread_.CancelTimer(*media_settle_timer_);
+                                     media_settle_timer_.reset();
+                                     ArmMediaSettleTimer();
+                                   } },
+                                 TaskPriority::Control);
+      result->Success(flutter::EncodableValue(true));
+    }
+    break;
+    case Method::GetSessions:
+    {
+      worker_thread_.EnqueueTask([this, result]()
+                                 { Spawn(GetSessionsAsync(result)); },
+                                 TaskPriority::Metadata);
+    }
+    break;
+    case Method::SetPositionOptions:
+    {
+      auto options = ParsePositionOptions(method_call.arguments());
+      worker_thread_.EnqueueTask([this, options]()
+                                 { ApplyPositionOptions(options); },
+                                 TaskPriority::Control);
+      result->Success(flutter::EncodableValue(true));
     }
     break;
     // methods not supported on Windows
@@ -203,7 +1047,7 @@ namespace media_notification_service
     }
   }
 
-  Method MediaNotificationServicePlugin::MethodStringToEnum(const std::string &method_name)
+  Method MediaNotificationService::MethodStringToEnum(const std::string &method_name)
   {
     static const std::unordered_map<std::string, Method> method_map = {
         {"getCurrentMedia", Method::GetCurrentMedia},
@@ -215,6 +1059,12 @@ namespace media_notification_service
         {"skipToPrevious", Method::SkipToPrevious},
         {"stop", Method::Stop},
         {"seekTo", Method::SeekTo},
+        {"setTimeouts", Method::SetTimeouts},
+        {"setPositionOptions", Method::SetPositionOptions},
+        {"requestMediaKeyframe", Method::RequestMediaKeyframe},
+        {"setAlbumArtOptions", Method::SetAlbumArtOptions},
+        {"setMediaSettleOptions", Method::SetMediaSettleOptions},
+        {"getSessions", Method::GetSessions},
         {"skipToQueueItem", Method::SkipToQueueItem}};
 
     auto it = method_map.find(method_name);
@@ -5,9 +5,19 @@
 #include <flutter/plugin_registrar_windows.h>
 
 #include "stream_controller.h"
+#include "platform_dispatcher.h"
+#include "message_window.h"
 #include "media_session_manager.h"
 #include "worker_thread.h"
-#include "periodic_timer.h"
+#include "thread_pool.h"
+#include "strand.h"
+#include "position_ticker.h"
+#include "position_anchor.h"
+#include "co_task.h"
+#include "deadline.h"
+#include "delta_encoder.h"
+#include "art_file_store.h"
+#include "settle_window.h"
 
 #include <memory>
 #include <optional>
@@ -27,38 +37,166 @@ namespace media_notification_service
         Stop,
         SeekTo,
         SkipToQueueItem,
+        SetTimeouts,
+        SetPositionOptions,
+        RequestMediaKeyframe,
+        SetAlbumArtOptions,
+        SetMediaSettleOptions,
+        GetSessions,
         Unknown
     };
 
-    class MediaNotificationServicePlugin : public flutter::Plugin
+    struct PositionStreamOptions
+    {
+        PositionTickOptions tick;
+        // Send only samples that move the receiver's extrapolation anchor.
+        bool anchors_only = false;
+    };
+
+    struct MediaArtOptions
+    {
+        ArtRequest shape;
+        // Write the art to the file store and send where to read it instead
+        // of the bytes.
+        bool as_file = false;
+
+        bool operator==(const MediaArtOptions &) const = default;
+    };
+
+    // Completes a method result on the platform thread.
+    class PlatformThreadResult;
+
+    // The plugin's channels, worker and state. Worker tasks reach it through
+    // a raw pointer, so it is shared with the worker thread, which keeps it
+    // alive if a shutdown times out while one of them is still running.
+    class MediaNotificationService : public std::enable_shared_from_this<MediaNotificationService>
     {
     public:
-        static void RegisterWithRegistrar(flutter::PluginRegistrarWindows *registrar);
+        MediaNotificationService();
+        ~MediaNotificationService();
 
-        MediaNotificationServicePlugin();
-        virtual ~MediaNotificationServicePlugin();
+        MediaNotificationService(const MediaNotificationService &) = delete;
+        MediaNotificationService &operator=(const MediaNotificationService &) = delete;
 
-        MediaNotificationServicePlugin(const MediaNotificationServicePlugin &) = delete;
-        MediaNotificationServicePlugin &operator=(const MediaNotificationServicePlugin &) = delete;
+        void RegisterChannels(flutter::PluginRegistrarWindows *registrar);
 
-    private:
         void HandleMethodCall(
             const flutter::MethodCall<flutter::EncodableValue> &method_call,
             std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
+        // Platform thread. Returns within the shutdown budget; nothing
+        // reaches the platform thread after it.
+        void Shutdown();
+
+    private:
         Method MethodStringToEnum(const std::string &method_name);
 
+        void RequestMediaRefresh(bool song_changed);
+        void RequestPositionRefresh();
+        void RequestSessionsRefresh();
+
+        // Worker thread only: a media event, held back while a track change
+        // settles.
+        void OnMediaEvent(bool song_changed);
+        void OnMediaSettleTimer();
+        void ArmMediaSettleTimer();
+        void StopMediaSettle();
         void OnMediaChanged(bool song_changed = false);
-        void OnPositionChanged();
+        CoTask<> RefreshMediaAsync();
+        PlaybackSample SendPositionInfo();
+        void ApplyPositionOptions(const PositionStreamOptions &options);
+
+        void OnSessionsChanged();
+        CoTask<> RefreshSessionsAsync();
+        CoTask<> GetSessionsAsync(std::shared_ptr<PlatformThreadResult> result);
+        void SendSessionsEvent(SessionRegistry::Changes changes);
+
+        CoTask<> GetCurrentMediaAsync(
+            std::shared_ptr<PlatformThreadResult> result,
+            MediaArtOptions art_options);
+        void ApplyMediaArtOptions(const MediaArtOptions &options);
+        // Swaps "albumArt" for "albumArtFile" if the file store takes it.
+        void MoveArtToFile(flutter::EncodableMap &map);
+
+        // Everything bound for the platform thread, results and stream
+        // events alike, goes through this one wake-up channel. Declared
+        // first so it outlives the worker that feeds it.
+        MessageWindow message_window_{[this]()
+                                      { dispatcher_.Drain(); }};
+        PlatformDispatcher dispatcher_{message_window_};
 
         WorkerThread worker_thread_;
-        MediaSessionManager media_session_manager_;
+        // Thumbnail decoding and resizing, stopped after the worker. The only
+        // strand: commands, positions and metadata are ordered by the
+        // worker's lanes, and WinRT calls are awaited rather than held on a
+        // thread, so per-session strands would only put locks around state
+        // the worker owns.
+        ThreadPool image_pool_{1};
+        std::shared_ptr<Strand> image_strand_ = std::make_shared<Strand>(image_pool_);
+        // Art reads resume on the Background lane so a large thumbnail never
+        // delays a metadata fetch completing behind it.
+        MediaSessionManager media_session_manager_{
+            worker_thread_.LaneExecutor(TaskPriority::Control),
+            worker_thread_.LaneExecutor(TaskPriority::Metadata),
+            worker_thread_.LaneExecutor(TaskPriority::Background),
+            image_strand_};
+
+        // Drained in declaration order: media events before positions.
+        StreamController media_stream_handler_{dispatcher_};
+        // Only the newest position matters once the platform thread gets to
+        // it, e.g. after a window drag.
+        StreamController position_stream_handler_{dispatcher_, DeliveryPolicy::LatestOnly()};
+        StreamController queue_stream_handler_{dispatcher_};
+        StreamController sessions_stream_handler_{dispatcher_};
+
+        PositionTicker position_ticker_;
+        // Worker thread only.
+        AnchorFilter position_anchor_filter_;
+        bool position_anchors_only_ = false;
+
+        // Only touched on the worker thread. At most one media refresh is in
+        // flight; requests arriving meanwhile fold into one follow-up.
+        DeadlineTable deadlines_;
+        bool media_refresh_in_flight_ = false;
+        bool media_refresh_requested_ = false;
+        bool pending_song_changed_ = false;
+        // Media events as changes against the previous one, when the Dart
+        // side asks for it on listen.
+        bool media_delta_mode_ = false;
+        DeltaEncoder<flutter::EncodableMap> media_delta_encoder_;
+        // Art version of the last media event that carried art; 0 makes the
+        // next one carry it again.
+        uint64_t media_stream_art_version_ = 0;
+        // Shape and delivery of the media stream's album art.
+        MediaArtOptions media_art_options_;
+        // Opened on first use; worker thread only.
+        ArtFileStore art_file_store_;
+        // Folds the burst of events a track change fires into one refresh.
+        SettleWindow media_settle_;
+        std::optional<WorkerThread::TimerId> media_settle_timer_;
+        bool settle_song_changed_ = false;
+
+        // Worker thread only, like the media refresh state above.
+        bool sessions_listening_ = false;
+        // The next sessions event lists every session, not just changes.
+        bool sessions_keyframe_pending_ = false;
+        bool sessions_refresh_in_flight_ = false;
+        bool sessions_refresh_requested_ = false;
+    };
+
+    class MediaNotificationServicePlugin : public flutter::Plugin
+    {
+    public:
+        static void RegisterWithRegistrar(flutter::PluginRegistrarWindows *registrar);
 
-        StreamController media_stream_handler_;
-        StreamController position_stream_handler_;
-        StreamController queue_stream_handler_;
+        MediaNotificationServicePlugin();
+        virtual ~MediaNotificationServicePlugin();
 
-        PeriodicTimer position_timer_;
+        MediaNotificationServicePlugin(const MediaNotificationServicePlugin &) = delete;
+        MediaNotificationServicePlugin &operator=(const MediaNotificationServicePlugin &) = delete;
+
+    private:
+        std::shared_ptr<MediaNotificationService> service_ = std::make_shared<MediaNotificationService>();
     };
 } // namespace media_notification_service
 
@@ -4,6 +4,7 @@
 #include <flutter/standard_method_codec.h>
 #include <winrt/Windows.Media.Control.h>
 #include <winrt/Windows.Storage.Streams.h>
+#include <winrt/Windows.System.Threading.h>
 #include <winrt/Windows.Foundation.h>
 
 using namespace winrt;
@@ -13,20 +14,108 @@ using namespace Windows::Foundation;
 
 namespace media_notification_service
 {
-    MediaSessionManager::MediaSessionManager() = default;
+    namespace
+    {
+        constexpr std::chrono::milliseconds kInitializeTimeout{5000};
+        // A few dozen typical thumbnails.
+        constexpr size_t kAlbumArtCacheBudget = 8 * 1024 * 1024;
+
+        // Arms operation timeouts on the system thread pool; the callback only
+        // cancels the operation, the coroutine itself resumes on its executor.
+        class ThreadPoolTimeout : public Timer
+        {
+        public:
+            void PostAfter(std::chrono::milliseconds delay, InplaceTask task) override
+            {
+                try
+                {
+                    auto shared_task = std::make_shared<InplaceTask>(std::move(task));
+                    Windows::System::Threading::ThreadPoolTimer::CreateTimer(
+                        [shared_task](auto &&)
+                        { (*shared_task)(); },
+                        delay);
+                }
+                catch (...)
+                {
+                }
+            }
+        };
+
+        Timer &TimeoutTimer()
+        {
+            static ThreadPoolTimeout timer;
+            return timer;
+        }
+
+        // WinRT time points count 100 ns ticks from 1601; Dart wants Unix
+        // epoch milliseconds.
+        int64_t ToUnixMilliseconds(DateTime time)
+        {
+            constexpr int64_t kUnixEpochTicks = 116444736000000000;
+            return (time.time_since_epoch().count() - kUnixEpochTicks) / 10000;
+        }
+
+        std::string SessionIdOf(GlobalSystemMediaTransportControlsSession const &session)
+        {
+            try
+            {
+                return session ? winrt::to_string(session.SourceAppUserModelId()) : std::string();
+            }
+            catch (...)
+            {
+                return {};
+            }
+        }
+
+        // Revoking fails once the media app is gone, with nothing to undo.
+        template <typename Revoke>
+        EventMultiplexer::Revoker Guarded(Revoke revoke)
+        {
+            return [revoke]()
+            {
+                try
+                {
+                    revoke();
+                }
+                catch (...)
+                {
+                }
+            };
+        }
+    } // namespace
+
+    MediaSessionManager::MediaSessionManager(std::shared_ptr<Executor> command_executor,
+                                             std::shared_ptr<Executor> fetch_executor,
+                                             std::shared_ptr<Executor> art_executor,
+                                             std::shared_ptr<Executor> image_executor)
+        : command_executor_(std::move(command_executor)),
+          fetch_executor_(std::move(fetch_executor)),
+          art_executor_(std::move(art_executor)),
+          image_executor_(std::move(image_executor)),
+          art_cache_(kAlbumArtCacheBudget),
+          events_([this](const EventKey &key)
+                  { return AttachEvent(key); })
+    {
+    }
 
     MediaSessionManager::~MediaSessionManager()
     {
         RemoveMediaEventListeners();
         RemovePositionEventListeners();
+        RemoveSessionsListeners();
     }
 
     bool MediaSessionManager::Initialize()
     {
         try
         {
-            media_manager_ = GlobalSystemMediaTransportControlsSessionManager::RequestAsync().get();
+            auto operation = GlobalSystemMediaTransportControlsSessionManager::RequestAsync();
+            if (!WaitForOperation(operation, Deadline(kInitializeTimeout)))
+            {
+                return false;
+            }
 
+            media_manager_ = operation.GetResults();
             return media_manager_ != nullptr;
         }
         catch (...)
@@ -53,9 +142,96 @@ namespace media_notification_service
         }
     }
 
-    flutter::EncodableMap MediaSessionManager::GetCurrentMediaInfo()
+    GlobalSystemMediaTransportControlsSession MediaSessionManager::FindSession(const std::string &session_id)
     {
-        flutter::EncodableMap map;
+        if (session_id.empty())
+        {
+            return GetCurrentSession();
+        }
+        auto tracked = tracked_sessions_.find(session_id);
+        if (tracked != tracked_sessions_.end())
+        {
+            return tracked->second.session;
+        }
+        if (!media_manager_)
+        {
+            return nullptr;
+        }
+
+        try
+        {
+            for (auto const &session : media_manager_.GetSessions())
+            {
+                if (winrt::to_string(session.SourceAppUserModelId()) == session_id)
+                {
+                    return session;
+                }
+            }
+        }
+        catch (...)
+        {
+        }
+        return nullptr;
+    }
+
+    CoTask<MediaSessionManager::MediaInfoResult> MediaSessionManager::GetCurrentMediaInfoAsync(
+        std::chrono::milliseconds timeout, std::chrono::milliseconds art_timeout, ArtRequest art_request)
+    {
+        MediaInfoResult info;
+        MediaSnapshot snapshot;
+        if (!snapshot_cache_.Lookup(snapshot))
+        {
+            uint64_t version = snapshot_cache_.BeginFetch();
+            uint64_t session_mark = session_registry_.MarkCount();
+            ++snapshot_fetches_in_flight_;
+            auto fetch = co_await FetchSnapshotAsync(timeout, art_timeout);
+            --snapshot_fetches_in_flight_;
+            if (on_sessions_changed_)
+            {
+                // The sessions stream left the current session to this fetch;
+                // if it did not cover the latest change, that refresh fetches
+                // the session itself.
+                if (fetch.result == CallResult::Success && !fetch.snapshot.session.id.empty())
+                {
+                    session_registry_.Supply(fetch.snapshot.session, session_mark);
+                }
+                on_sessions_changed_();
+            }
+            if (fetch.result != CallResult::Success)
+            {
+                info.result = fetch.result;
+                co_return info;
+            }
+            if (fetch.complete)
+            {
+                snapshot_cache_.Store(version, fetch.snapshot);
+            }
+            snapshot = std::move(fetch.snapshot);
+        }
+
+        info.map = std::move(snapshot.map);
+        if (!snapshot.art.empty())
+        {
+            std::vector<uint8_t> image_data = std::move(snapshot.art);
+            if (!art_request.IsOriginal())
+            {
+                image_data = co_await ArtVariantAsync(std::move(snapshot.art_key), std::move(snapshot.same_art),
+                                                      std::move(image_data), art_request);
+            }
+            info.art_version = snapshot.art_version;
+            info.map[flutter::EncodableValue("albumArt")] =
+                flutter::EncodableValue(std::move(image_data));
+        }
+        co_return info;
+    }
+
+    CoTask<MediaSessionManager::SnapshotFetch> MediaSessionManager::FetchSnapshotAsync(
+        std::chrono::milliseconds timeout, std::chrono::milliseconds art_timeout)
+    {
+        SnapshotFetch fetch;
+        auto &snapshot = fetch.snapshot;
+        IRandomAccessStreamReference thumbnail{nullptr};
+        AlbumArtKey &art_key = snapshot.art_key;
 
         try
         {
@@ -63,43 +239,104 @@ namespace media_notification_service
 
             if (!session)
             {
-                return map;
+                fetch.complete = true;
+                co_return fetch;
+            }
+
+            auto operation = session.TryGetMediaPropertiesAsync();
+            fetch.result = co_await AwaitOperation(operation, fetch_executor_, TimeoutTimer(), timeout);
+            if (fetch.result != CallResult::Success)
+            {
+                co_return fetch;
             }
 
-            auto props = session.TryGetMediaPropertiesAsync().get();
+            auto props = operation.GetResults();
             auto playback_info = session.GetPlaybackInfo();
             auto status = playback_info.PlaybackStatus();
             auto playback_state = PlaybackStatusToString(status);
             bool is_playing = (status == GlobalSystemMediaTransportControlsSessionPlaybackStatus::Playing);
 
-            auto thumbnail = props.Thumbnail();
-            if (thumbnail)
-            {
-                auto image_data = IRandomAccessStreamReferenceToByteArray(thumbnail);
-                map[flutter::EncodableValue("albumArt")] =
-                    flutter::EncodableValue(flutter::EncodableValue(image_data));
-            }
+            thumbnail = props.Thumbnail();
+            art_key.source_app_id = winrt::to_string(session.SourceAppUserModelId());
+            art_key.title = winrt::to_string(props.Title());
+            art_key.artist = winrt::to_string(props.Artist());
+            art_key.album = winrt::to_string(props.AlbumTitle());
 
-            map[flutter::EncodableValue("title")] =
-                flutter::EncodableValue(winrt::to_string(props.Title()));
-            map[flutter::EncodableValue("artist")] =
-                flutter::EncodableValue(winrt::to_string(props.Artist()));
-            map[flutter::EncodableValue("album")] =
-                flutter::EncodableValue(winrt::to_string(props.AlbumTitle()));
+            auto &map = snapshot.map;
+            map[flutter::EncodableValue("title")] = flutter::EncodableValue(art_key.title);
+            map[flutter::EncodableValue("artist")] = flutter::EncodableValue(art_key.artist);
+            map[flutter::EncodableValue("album")] = flutter::EncodableValue(art_key.album);
             map[flutter::EncodableValue("state")] =
                 flutter::EncodableValue(playback_state);
             map[flutter::EncodableValue("isPlaying")] = flutter::EncodableValue(is_playing);
+            snapshot.session = SessionState{art_key.source_app_id, art_key.title, art_key.artist, art_key.album,
+                                            playback_state, is_playing};
+            fetch.complete = true;
         }
         catch (...)
         {
+            co_return fetch;
         }
 
-        return map;
+        if (thumbnail)
+        {
+            // Same track as before (a play/pause, a getCurrentMedia): the
+            // thumbnail has not changed, so do not read it again. Apps that
+            // publish the art after the title get a miss until then, as only
+            // art that was actually read is cached.
+            std::vector<uint8_t> image_data;
+            bool art_unchanged = false;
+            if (art_cache_.Lookup(art_key, image_data))
+            {
+                art_unchanged = art_key == last_art_key_;
+                if (!art_unchanged)
+                {
+                    // Back to an earlier track; the detector's fingerprint
+                    // describes some other thumbnail now.
+                    art_change_detector_.Reset();
+                }
+            }
+            else
+            {
+                auto art = co_await ReadAlbumArtAsync(thumbnail, art_timeout);
+                image_data = std::move(art.bytes);
+                art_unchanged = art.unchanged;
+                if (!image_data.empty())
+                {
+                    art_cache_.Insert(art_key, image_data);
+                }
+            }
+            if (!image_data.empty())
+            {
+                if (!art_unchanged || art_version_ == 0)
+                {
+                    ++art_version_;
+                }
+                if (art_unchanged && !(art_key == last_art_key_))
+                {
+                    snapshot.same_art = last_art_key_;
+                }
+                last_art_key_ = art_key;
+                snapshot.art_version = art_version_;
+                snapshot.art = std::move(image_data);
+            }
+            else
+            {
+                // A slow or failed read; try again next time.
+                fetch.complete = false;
+            }
+        }
+
+        co_return fetch;
     }
 
-    flutter::EncodableMap MediaSessionManager::GetCurrentPositionInfo()
+    flutter::EncodableMap MediaSessionManager::GetCurrentPositionInfo(bool *is_advancing)
     {
         flutter::EncodableMap map;
+        if (is_advancing)
+        {
+            *is_advancing = false;
+        }
 
         try
         {
@@ -112,21 +349,22 @@ namespace media_notification_service
             auto timeline = session.GetTimelineProperties();
             auto playback_info = session.GetPlaybackInfo();
             auto status = playback_info.PlaybackStatus();
-            auto playback_rate = playback_info.PlaybackRate().Value();
+            // Sessions that never report a rate play at normal speed.
+            auto rate = playback_info.PlaybackRate();
+            double reported_rate = rate ? rate.Value() : 1.0;
+            double playback_rate = reported_rate > 0.0 ? reported_rate : 1.0;
 
-            if (playback_rate <= 0.0)
+            if (is_advancing)
             {
-                playback_rate = 1.0;
+                *is_advancing = status == GlobalSystemMediaTransportControlsSessionPlaybackStatus::Playing &&
+                                reported_rate > 0.0;
             }
 
             int64_t stored_position = timeline.Position().count() / 10000;
             int64_t duration = timeline.EndTime().count() / 10000;
 
-            auto last_updated = timeline.LastUpdatedTime();
-            auto last_updated_ms = winrt::clock::to_time_t(last_updated) * 1000;
-
-            auto now = winrt::clock::now();
-            auto now_ms = winrt::clock::to_time_t(now) * 1000;
+            auto last_updated_ms = ToUnixMilliseconds(timeline.LastUpdatedTime());
+            auto now_ms = ToUnixMilliseconds(winrt::clock::now());
 
             int64_t current_position = stored_position;
 
@@ -147,6 +385,10 @@ namespace media_notification_service
             map[flutter::EncodableValue("position")] = flutter::EncodableValue(current_position);
             map[flutter::EncodableValue("duration")] = flutter::EncodableValue(duration);
             map[flutter::EncodableValue("state")] = flutter::EncodableValue(playback_state);
+            map[flutter::EncodableValue("playbackSpeed")] = flutter::EncodableValue(playback_rate);
+            // The time |position| was read at, so the receiver can keep
+            // extrapolating from it.
+            map[flutter::EncodableValue("anchorTimestamp")] = flutter::EncodableValue(now_ms);
         }
         catch (...)
         {
@@ -188,101 +430,70 @@ namespace media_notification_service
         }
     }
 
-    bool MediaSessionManager::PlayPause()
+    CoTask<CallResult> MediaSessionManager::RunCommandAsync(CommandStarter start,
+                                                            std::chrono::milliseconds timeout,
+                                                            bool require_true,
+                                                            std::string session_id)
     {
         try
         {
-            auto session = GetCurrentSession();
+            auto session = FindSession(session_id);
             if (!session)
             {
-                return false;
+                co_return CallResult::Failure;
             }
 
-            session.TryTogglePlayPauseAsync().get();
-            return true;
-        }
-        catch (...)
-        {
-            return false;
-        }
-    }
-
-    bool MediaSessionManager::SkipToNext()
-    {
-        try
-        {
-            auto session = GetCurrentSession();
-            if (!session)
+            auto operation = start(session);
+            auto result = co_await AwaitOperation(operation, command_executor_, TimeoutTimer(), timeout);
+            if (result != CallResult::Success)
             {
-                return false;
+                co_return result;
             }
 
-            session.TrySkipNextAsync().get();
-            return true;
+            bool accepted = operation.GetResults();
+            co_return (accepted || !require_true) ? CallResult::Success : CallResult::Failure;
         }
         catch (...)
         {
-            return false;
+            co_return CallResult::Failure;
         }
     }
 
-    bool MediaSessionManager::SkipToPrevious()
+    CoTask<CallResult> MediaSessionManager::PlayPauseAsync(std::chrono::milliseconds timeout, std::string session_id)
     {
-        try
-        {
-            auto session = GetCurrentSession();
-            if (!session)
-            {
-                return false;
-            }
-
-            session.TrySkipPreviousAsync().get();
-            return true;
-        }
-        catch (...)
-        {
-            return false;
-        }
+        return RunCommandAsync([](auto const &session)
+                               { return session.TryTogglePlayPauseAsync(); },
+                               timeout, false, std::move(session_id));
     }
 
-    bool MediaSessionManager::Stop()
+    CoTask<CallResult> MediaSessionManager::SkipToNextAsync(std::chrono::milliseconds timeout, std::string session_id)
     {
-        try
-        {
-            auto session = GetCurrentSession();
-            if (!session)
-            {
-                return false;
-            }
-
-            session.TryStopAsync().get();
-            return true;
-        }
-        catch (...)
-        {
-            return false;
-        }
+        return RunCommandAsync([](auto const &session)
+                               { return session.TrySkipNextAsync(); },
+                               timeout, false, std::move(session_id));
     }
 
-    bool MediaSessionManager::SeekTo(int64_t position_ms)
+    CoTask<CallResult> MediaSessionManager::SkipToPreviousAsync(std::chrono::milliseconds timeout, std::string session_id)
     {
-        try
-        {
-            auto session = GetCurrentSession();
-            if (!session)
-            {
-                return false;
-            }
+        return RunCommandAsync([](auto const &session)
+                               { return session.TrySkipPreviousAsync(); },
+                               timeout, false, std::move(session_id));
+    }
 
-            int64_t ticks = position_ms * 10000;
-            bool success = session.TryChangePlaybackPositionAsync(ticks).get();
+    CoTask<CallResult> MediaSessionManager::StopAsync(std::chrono::milliseconds timeout, std::string session_id)
+    {
+        return RunCommandAsync([](auto const &session)
+                               { return session.TryStopAsync(); },
+                               timeout, false, std::move(session_id));
+    }
 
-            return success;
-        }
-        catch (...)
-        {
-            return false;
-        }
+    CoTask<CallResult> MediaSessionManager::SeekToAsync(int64_t position_ms, std::chrono::milliseconds timeout,
+                                                        std::string session_id)
+    {
+        int64_t ticks = position_ms * 10000;
+        return RunCommandAsync([ticks](auto const &session)
+                               { return session.TryChangePlaybackPositionAsync(ticks); },
+                               timeout, true, std::move(session_id));
     }
 
     std::string MediaSessionManager::PlaybackStatusToString(
@@ -306,263 +517,522 @@ namespace media_notification_service
         }
     }
 
-    std::vector<uint8_t> MediaSessionManager::IRandomAccessStreamReferenceToByteArray(
-        winrt::Windows::Storage::Streams::IRandomAccessStreamReference const &stream_ref)
+    CoTask<MediaSessionManager::AlbumArtRead> MediaSessionManager::ReadAlbumArtAsync(
+        IRandomAccessStreamReference stream_ref, std::chrono::milliseconds timeout)
     {
-        auto thumbnailStream = stream_ref.OpenReadAsync().get();
-        uint64_t size = thumbnailStream.Size();
-
-        Buffer buffer(static_cast<uint32_t>(size));
-        thumbnailStream.ReadAsync(buffer, static_cast<uint32_t>(size), InputStreamOptions::None).get();
-
-        std::vector<uint8_t> bytes(size);
-        auto dataReader = DataReader::FromBuffer(buffer);
-        dataReader.ReadBytes(bytes);
+        AlbumArtRead art;
+        try
+        {
+            Deadline deadline(timeout);
 
-        return bytes;
-    }
+            auto open_operation = stream_ref.OpenReadAsync();
+            if (co_await AwaitOperation(open_operation, art_executor_, TimeoutTimer(),
+                                        deadline.Remaining()) != CallResult::Success)
+            {
+                co_return art;
+            }
 
-    // event listeners
-    void MediaSessionManager::SetupSessionSpecificListeners()
-    {
-        auto session = GetCurrentSession();
-        if (!session)
-            return;
+            auto thumbnailStream = open_operation.GetResults();
+            uint64_t size = thumbnailStream.Size();
+            std::string content_type = winrt::to_string(thumbnailStream.ContentType());
 
-        try
-        {
-            media_properties_changed_token_ = session.MediaPropertiesChanged(
-                [this](auto &&, auto &&)
+            // A new track often keeps the album's art. If the stream looks
+            // like the last one, and that one is still cached to hand back,
+            // compare a few KB before reading it all.
+            std::vector<uint8_t> previous;
+            if (!art_change_detector_.ShapeDiffers(size, content_type) &&
+                art_cache_.Lookup(last_art_key_, previous))
+            {
+                std::vector<uint8_t> samples;
+                for (const auto &range : ThumbnailChangeDetector::SampleRanges(size))
                 {
-                    if (on_media_changed_)
+                    thumbnailStream.Seek(range.offset);
+                    if (!co_await ReadStreamAsync(thumbnailStream, range.length, deadline, samples))
                     {
-                        on_media_changed_(true);
+                        co_return art;
                     }
-                });
-
-            playback_info_changed_token_ = session.PlaybackInfoChanged(
-                [this](auto &&, auto &&)
+                }
+                if (!art_change_detector_.SamplesDiffer(samples))
                 {
-                    if (on_media_changed_)
-                    {
-                        on_media_changed_(false);
-                    }
-                });
+                    art.bytes = std::move(previous);
+                    art.unchanged = true;
+                    co_return art;
+                }
+                thumbnailStream.Seek(0);
+            }
+
+            std::vector<uint8_t> bytes;
+            if (!co_await ReadStreamAsync(thumbnailStream, static_cast<uint32_t>(size), deadline, bytes))
+            {
+                co_return art;
+            }
+            art_change_detector_.Commit(content_type, bytes);
+            art.bytes = std::move(bytes);
+            co_return art;
         }
         catch (...)
         {
+            co_return AlbumArtRead{};
         }
     }
 
-    void MediaSessionManager::RemoveSessionSpecificListeners()
+    CoTask<std::vector<uint8_t>> MediaSessionManager::ArtVariantAsync(
+        AlbumArtKey key, std::optional<AlbumArtKey> same_art, std::vector<uint8_t> original, ArtRequest request)
     {
-        if (!media_manager_)
-            return;
+        key.variant = request.VariantName();
+        std::vector<uint8_t> variant;
+        if (art_cache_.Lookup(key, variant))
+        {
+            co_return variant;
+        }
+        if (same_art)
+        {
+            same_art->variant = key.variant;
+            if (art_cache_.Lookup(*same_art, variant))
+            {
+                art_cache_.Insert(key, variant);
+                co_return variant;
+            }
+        }
+
+        // Decoding a large thumbnail takes tens of milliseconds; the worker
+        // keeps serving position ticks and commands meanwhile.
+        co_await ScheduleOn(*image_executor_);
+        variant = art_transcoder_.Transcode(original, request);
+        co_await ScheduleOn(*art_executor_);
+
+        if (variant.empty())
+        {
+            co_return original;
+        }
+        art_cache_.Insert(key, variant);
+        co_return variant;
+    }
+
+    CoTask<bool> MediaSessionManager::ReadStreamAsync(IRandomAccessStream stream, uint32_t length,
+                                                      const Deadline &deadline, std::vector<uint8_t> &out)
+    {
+        Buffer buffer(length);
+        auto read_operation = stream.ReadAsync(buffer, length, InputStreamOptions::None);
+        if (co_await AwaitOperation(read_operation, art_executor_, TimeoutTimer(),
+                                    deadline.Remaining()) != CallResult::Success)
+        {
+            co_return false;
+        }
+
+        auto result_buffer = read_operation.GetResults();
+        size_t offset = out.size();
+        out.resize(offset + result_buffer.Length());
+        auto dataReader = DataReader::FromBuffer(result_buffer);
+        dataReader.ReadBytes(winrt::array_view<uint8_t>(out.data() + offset, out.data() + out.size()));
+        co_return true;
+    }
+
+    // event listeners
+    EventMultiplexer::Revoker MediaSessionManager::AttachEvent(const EventKey &key)
+    {
+        auto raise = [this, key](auto &&, auto &&)
+        {
+            events_.Raise(key);
+        };
 
         try
         {
-            auto session = media_manager_.GetCurrentSession();
-            if (session)
+            if (key.source.empty())
             {
-                if (media_properties_changed_token_)
+                auto manager = media_manager_;
+                if (!manager)
                 {
-                    session.MediaPropertiesChanged(media_properties_changed_token_);
-                    media_properties_changed_token_ = {};
+                    return nullptr;
                 }
-
-                if (playback_info_changed_token_)
+                switch (key.event)
                 {
-                    session.PlaybackInfoChanged(playback_info_changed_token_);
-                    playback_info_changed_token_ = {};
+                case SessionEvent::SessionsChanged:
+                {
+                    auto token = manager.SessionsChanged(raise);
+                    return Guarded([manager, token]()
+                                   { manager.SessionsChanged(token); });
+                }
+                case SessionEvent::CurrentSessionChanged:
+                {
+                    auto token = manager.CurrentSessionChanged(raise);
+                    return Guarded([manager, token]()
+                                   { manager.CurrentSessionChanged(token); });
+                }
+                default:
+                    return nullptr;
                 }
             }
+
+            auto session = FindSession(key.source);
+            if (!session)
+            {
+                return nullptr;
+            }
+            switch (key.event)
+            {
+            case SessionEvent::MediaPropertiesChanged:
+            {
+                auto token = session.MediaPropertiesChanged(raise);
+                return Guarded([session, token]()
+                               { session.MediaPropertiesChanged(token); });
+            }
+            case SessionEvent::PlaybackInfoChanged:
+            {
+                auto token = session.PlaybackInfoChanged(raise);
+                return Guarded([session, token]()
+                               { session.PlaybackInfoChanged(token); });
+            }
+            case SessionEvent::TimelinePropertiesChanged:
+            {
+                auto token = session.TimelinePropertiesChanged(raise);
+                return Guarded([session, token]()
+                               { session.TimelinePropertiesChanged(token); });
+            }
+            default:
+                return nullptr;
+            }
         }
         catch (...)
         {
+            return nullptr;
         }
     }
 
-    void MediaSessionManager::SetupPositionSessionSpecificListeners()
+    void MediaSessionManager::Unsubscribe(SubscriptionIds &subscriptions)
+    {
+        for (auto id : subscriptions)
+        {
+            events_.Unsubscribe(id);
+        }
+        subscriptions.clear();
+    }
+
+    void MediaSessionManager::SetupSessionSpecificListeners()
     {
-        auto session = GetCurrentSession();
-        if (!session)
+        std::string id = SessionIdOf(GetCurrentSession());
+        if (id.empty())
             return;
 
-        try
-        {
-            timeline_properties_changed_token_ = session.TimelinePropertiesChanged(
-                [this](auto &&, auto &&)
+        media_session_subscriptions_.push_back(events_.Subscribe(
+            {id, SessionEvent::MediaPropertiesChanged},
+            [this]()
+            {
+                snapshot_cache_.Invalidate();
+                if (on_media_changed_)
                 {
-                    if (on_position_changed_)
-                    {
-                        on_position_changed_();
-                    }
-                });
+                    on_media_changed_(true);
+                }
+            }));
 
-            playback_info_changed_token_for_position_ = session.PlaybackInfoChanged(
-                [this](auto &&, auto &&)
+        media_session_subscriptions_.push_back(events_.Subscribe(
+            {id, SessionEvent::PlaybackInfoChanged},
+            [this]()
+            {
+                snapshot_cache_.Invalidate();
+                if (on_media_changed_)
                 {
-                    if (on_position_changed_)
-                    {
-                        on_position_changed_();
-                    }
-                });
+                    on_media_changed_(false);
+                }
+            }));
+    }
 
-            media_properties_changed_token_for_position_ = session.MediaPropertiesChanged(
-                [this](auto &&, auto &&)
+    void MediaSessionManager::RemoveSessionSpecificListeners()
+    {
+        Unsubscribe(media_session_subscriptions_);
+    }
+
+    void MediaSessionManager::SetupPositionSessionSpecificListeners()
+    {
+        std::string id = SessionIdOf(GetCurrentSession());
+        if (id.empty())
+            return;
+
+        for (auto event : {SessionEvent::TimelinePropertiesChanged, SessionEvent::PlaybackInfoChanged,
+                           SessionEvent::MediaPropertiesChanged})
+        {
+            position_session_subscriptions_.push_back(events_.Subscribe(
+                {id, event},
+                [this]()
                 {
                     if (on_position_changed_)
                     {
                         on_position_changed_();
                     }
-                });
-        }
-        catch (...)
-        {
+                }));
         }
     }
 
     void MediaSessionManager::RemovePositionSessionSpecificListeners()
     {
+        Unsubscribe(position_session_subscriptions_);
+    }
+
+    void MediaSessionManager::SetupMediaEventListeners(MediaEventListenerCallback callback)
+    {
+        on_media_changed_ = callback;
+
         if (!media_manager_)
             return;
 
-        try
-        {
-            auto session = media_manager_.GetCurrentSession();
-            if (session)
+        media_subscriptions_.push_back(events_.Subscribe(
+            {"", SessionEvent::SessionsChanged},
+            [this]()
             {
-                if (timeline_properties_changed_token_)
-                {
-                    session.TimelinePropertiesChanged(timeline_properties_changed_token_);
-                    timeline_properties_changed_token_ = {};
-                }
+                callCallbacks();
+            }));
 
-                if (playback_info_changed_token_for_position_)
+        media_subscriptions_.push_back(events_.Subscribe(
+            {"", SessionEvent::CurrentSessionChanged},
+            [this]()
+            {
+                snapshot_cache_.Invalidate();
+                // Raised on a WinRT thread; subscriptions and the tracked
+                // sessions FindSession() reads belong to the worker. Control
+                // runs ahead of the refresh the callbacks queue.
+                command_executor_->Post([this]()
+                                        {
+                                            if (!on_media_changed_)
+                                            {
+                                                return;
+                                            }
+                                            RemoveSessionSpecificListeners();
+                                            SetupSessionSpecificListeners(); });
+                callCallbacks();
+            }));
+
+        SetupSessionSpecificListeners();
+        // From here on a change to the session cannot go unnoticed.
+        snapshot_cache_.SetEnabled(true);
+    }
+
+    void MediaSessionManager::RemoveMediaEventListeners()
+    {
+        snapshot_cache_.SetEnabled(false);
+        Unsubscribe(media_subscriptions_);
+        RemoveSessionSpecificListeners();
+        on_media_changed_ = nullptr;
+    }
+
+    void MediaSessionManager::SetupPositionEventListeners(EventListenerCallback callback)
+    {
+        on_position_changed_ = callback;
+
+        if (!media_manager_)
+            return;
+
+        position_subscriptions_.push_back(events_.Subscribe(
+            {"", SessionEvent::SessionsChanged},
+            [this]()
+            {
+                if (on_position_changed_)
                 {
-                    session.PlaybackInfoChanged(playback_info_changed_token_for_position_);
-                    playback_info_changed_token_for_position_ = {};
+                    on_position_changed_();
                 }
+            }));
 
-                if (media_properties_changed_token_for_position_)
+        position_subscriptions_.push_back(events_.Subscribe(
+            {"", SessionEvent::CurrentSessionChanged},
+            [this]()
+            {
+                // On the worker, like the media listeners' rebind above.
+                command_executor_->Post([this]()
+                                        {
+                                            if (!on_position_changed_)
+                                            {
+                                                return;
+                                            }
+                                            RemovePositionSessionSpecificListeners();
+                                            SetupPositionSessionSpecificListeners(); });
+                if (on_position_changed_)
                 {
-                    session.MediaPropertiesChanged(media_properties_changed_token_for_position_);
-                    media_properties_changed_token_for_position_ = {};
+                    on_position_changed_();
                 }
-            }
-        }
-        catch (...)
-        {
-        }
+            }));
+
+        SetupPositionSessionSpecificListeners();
     }
 
-    void MediaSessionManager::SetupMediaEventListeners(MediaEventListenerCallback callback)
+    void MediaSessionManager::RemovePositionEventListeners()
     {
-        on_media_changed_ = callback;
+        Unsubscribe(position_subscriptions_);
+        RemovePositionSessionSpecificListeners();
+        on_position_changed_ = nullptr;
+    }
+
+    void MediaSessionManager::SetupSessionsListeners(EventListenerCallback callback)
+    {
+        on_sessions_changed_ = callback;
 
         if (!media_manager_)
             return;
 
-        try
-        {
-            sessions_changed_token_ = media_manager_.SessionsChanged(
-                [this](auto &&, auto &&)
-                {
-                    callCallbacks();
-                });
-
-            current_session_changed_token_ = media_manager_.CurrentSessionChanged(
-                [this](auto &&, auto &&)
+        auto id = events_.Subscribe(
+            {"", SessionEvent::SessionsChanged},
+            [this]()
+            {
+                session_registry_.MarkListChanged();
+                if (on_sessions_changed_)
                 {
-                    RemoveSessionSpecificListeners();
-                    SetupSessionSpecificListeners();
-                    callCallbacks();
-                });
-
-            SetupSessionSpecificListeners();
+                    on_sessions_changed_();
+                }
+            });
+        if (id)
+        {
+            sessions_subscriptions_.push_back(id);
         }
-        catch (...)
+        // Whatever was listed before went unwatched in between.
+        session_registry_.MarkListChanged();
+    }
+
+    void MediaSessionManager::RemoveSessionsListeners()
+    {
+        Unsubscribe(sessions_subscriptions_);
+        while (!tracked_sessions_.empty())
         {
+            UntrackSession(tracked_sessions_.begin()->first);
         }
+        session_registry_.Clear();
+        on_sessions_changed_ = nullptr;
     }
 
-    void MediaSessionManager::RemoveMediaEventListeners()
+    CoTask<SessionRegistry::Changes> MediaSessionManager::RefreshSessionsAsync(std::chrono::milliseconds timeout)
     {
-        if (!media_manager_)
-            return;
+        if (sessions_subscriptions_.empty())
+        {
+            // Nothing would tell us the set changed.
+            session_registry_.MarkListChanged();
+        }
 
-        try
+        if (media_manager_ && session_registry_.TakeListChanged())
         {
-            auto session = media_manager_.GetCurrentSession();
-            if (session)
+            std::vector<std::string> ids;
+            std::unordered_map<std::string, GlobalSystemMediaTransportControlsSession> listed;
+            bool complete = true;
+            try
             {
-                if (media_properties_changed_token_)
+                for (auto const &session : media_manager_.GetSessions())
                 {
-                    session.MediaPropertiesChanged(media_properties_changed_token_);
-                    media_properties_changed_token_ = {};
+                    // Apps with several sessions are tracked by their first.
+                    auto id = winrt::to_string(session.SourceAppUserModelId());
+                    if (listed.emplace(id, session).second)
+                    {
+                        ids.push_back(std::move(id));
+                    }
                 }
+            }
+            catch (...)
+            {
+                complete = false;
+            }
 
-                if (playback_info_changed_token_)
+            if (complete)
+            {
+                auto diff = session_registry_.SyncIds(ids);
+                for (const auto &id : diff.removed)
+                {
+                    UntrackSession(id);
+                }
+                for (const auto &id : diff.added)
                 {
-                    session.PlaybackInfoChanged(playback_info_changed_token_);
-                    playback_info_changed_token_ = {};
+                    TrackSession(id, listed.at(id));
                 }
             }
+            else
+            {
+                session_registry_.MarkListChanged();
+            }
         }
-        catch (...)
+
+        // A media stream fetch is about to report the current session.
+        std::string supplied;
+        if (snapshot_fetches_in_flight_ > 0)
         {
+            supplied = SessionIdOf(GetCurrentSession());
         }
 
-        on_media_changed_ = nullptr;
+        for (auto &id : session_registry_.TakeStale(supplied))
+        {
+            auto tracked = tracked_sessions_.find(id);
+            if (tracked == tracked_sessions_.end())
+            {
+                continue;
+            }
+            // Held across the fetch; the session may be untracked meanwhile.
+            auto session = tracked->second.session;
+            auto state = co_await FetchSessionStateAsync(session, id, timeout);
+            if (state)
+            {
+                session_registry_.Update(std::move(*state));
+            }
+            else
+            {
+                // Tried again on the next refresh.
+                session_registry_.MarkStale(id);
+            }
+        }
+
+        co_return session_registry_.TakeChanges();
     }
 
-    void MediaSessionManager::SetupPositionEventListeners(EventListenerCallback callback)
+    void MediaSessionManager::TrackSession(const std::string &id, GlobalSystemMediaTransportControlsSession session)
     {
-        on_position_changed_ = callback;
-
-        if (!media_manager_)
-            return;
-
-        try
+        // In place first: attaching looks the session up here.
+        TrackedSession &tracked = tracked_sessions_[id];
+        tracked.session = session;
+        for (auto event : {SessionEvent::MediaPropertiesChanged, SessionEvent::PlaybackInfoChanged})
         {
-            current_session_changed_token_for_position_ = media_manager_.CurrentSessionChanged(
-                [this](auto &&, auto &&)
+            tracked.subscriptions.push_back(events_.Subscribe(
+                {id, event},
+                [this, id]()
                 {
-                    RemovePositionSessionSpecificListeners();
-                    SetupPositionSessionSpecificListeners();
-                    if (on_position_changed_)
+                    session_registry_.MarkStale(id);
+                    if (on_sessions_changed_)
                     {
-                        on_position_changed_();
+                        on_sessions_changed_();
                     }
-                });
-
-            SetupPositionSessionSpecificListeners();
-        }
-        catch (...)
-        {
+                }));
         }
     }
 
-    void MediaSessionManager::RemovePositionEventListeners()
+    void MediaSessionManager::UntrackSession(const std::string &id)
     {
-        if (!media_manager_)
+        auto tracked = tracked_sessions_.find(id);
+        if (tracked == tracked_sessions_.end())
+        {
             return;
+        }
+        Unsubscribe(tracked->second.subscriptions);
+        tracked_sessions_.erase(tracked);
+    }
 
+    CoTask<std::optional<SessionState>> MediaSessionManager::FetchSessionStateAsync(
+        GlobalSystemMediaTransportControlsSession session, std::string id, std::chrono::milliseconds timeout)
+    {
         try
         {
-            if (current_session_changed_token_for_position_)
+            auto operation = session.TryGetMediaPropertiesAsync();
+            if (co_await AwaitOperation(operation, fetch_executor_, TimeoutTimer(), timeout) != CallResult::Success)
             {
-                media_manager_.CurrentSessionChanged(current_session_changed_token_for_position_);
-                current_session_changed_token_for_position_ = {};
+                co_return std::nullopt;
             }
 
-            RemovePositionSessionSpecificListeners();
+            auto props = operation.GetResults();
+            auto status = session.GetPlaybackInfo().PlaybackStatus();
+
+            SessionState state;
+            state.id = std::move(id);
+            state.title = winrt::to_string(props.Title());
+            state.artist = winrt::to_string(props.Artist());
+            state.album = winrt::to_string(props.AlbumTitle());
+            state.playback_state = PlaybackStatusToString(status);
+            state.is_playing = status == GlobalSystemMediaTransportControlsSessionPlaybackStatus::Playing;
+            co_return state;
         }
         catch (...)
         {
+            co_return std::nullopt;
         }
-
-        on_position_changed_ = nullptr;
     }
 
 } // namespace media_notification_service
\ No newline at end of file
@@ -3,9 +3,25 @@
 
 #include <flutter/encodable_value.h>
 
+#include "album_art_cache.h"
+#include "album_art_transcoder.h"
+#include "event_multiplexer.h"
+#include "session_registry.h"
+#include "snapshot_cache.h"
+#include "thumbnail_change_detector.h"
+#include "co_task.h"
+#include "deadline.h"
+#include "executor.h"
+
 #include <winrt/Windows.Media.Control.h>
 #include <winrt/Windows.Foundation.h>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace media_notification_service
 {
@@ -15,17 +31,46 @@ namespace media_notification_service
         using MediaEventListenerCallback = std::function<void(bool song_changed)>;
         using EventListenerCallback = std::function<void()>;
 
-        MediaSessionManager();
+        // Async operations resume on the executor matching their kind: commands,
+        // metadata fetches and album art reads.
+        // |image_executor| decodes and resizes thumbnails, off the worker.
+        MediaSessionManager(std::shared_ptr<Executor> command_executor,
+                            std::shared_ptr<Executor> fetch_executor,
+                            std::shared_ptr<Executor> art_executor,
+                            std::shared_ptr<Executor> image_executor);
         ~MediaSessionManager();
 
         MediaSessionManager(const MediaSessionManager &) = delete;
         MediaSessionManager &operator=(const MediaSessionManager &) = delete;
 
+        // Blocks (up to a fixed deadline); run it before anything else.
         bool Initialize();
 
-        flutter::EncodableMap GetCurrentMediaInfo();
-        flutter::EncodableMap GetCurrentPositionInfo();
-
+        struct MediaInfoResult
+        {
+            CallResult result = CallResult::Success;
+            flutter::EncodableMap map;
+            // Changes whenever "albumArt" holds different bytes than the
+            // last time it was present; 0 without art.
+            uint64_t art_version = 0;
+        };
+
+        // |timeout| bounds the properties fetch, |art_timeout| the album art
+        // read. |result| is CallResult::Timeout if the properties fetch ran out
+        // of time; a slow art read only drops "albumArt". Art is read once per
+        // track and served from the cache after that; a new track's thumbnail
+        // is only read in full if a cheap check says it changed. Art shaped by
+        // |art_request| is made once per track and request, and cached too.
+        // While media event listeners are set up, the whole result is kept
+        // until the session reports a change and served without a fetch.
+        CoTask<MediaInfoResult> GetCurrentMediaInfoAsync(std::chrono::milliseconds timeout,
+                                                         std::chrono::milliseconds art_timeout,
+                                                         ArtRequest art_request = {});
+        // |is_advancing| is set when the session is Playing at a positive rate,
+        // i.e. when the position will have moved by the next read.
+        flutter::EncodableMap GetCurrentPositionInfo(bool *is_advancing = nullptr);
+
+        // Listener setup and removal, here and below, on the worker only.
         void SetupMediaEventListeners(MediaEventListenerCallback callback);
         void RemoveMediaEventListeners();
 
@@ -38,42 +83,170 @@ namespace media_notification_service
         void SetupPositionSessionSpecificListeners();
         void RemovePositionSessionSpecificListeners();
 
+        // Every session, not just the current one: |callback| runs whenever
+        // one of them or the set of them changed, on the thread WinRT raised
+        // the event on.
+        void SetupSessionsListeners(EventListenerCallback callback);
+        void RemoveSessionsListeners();
+
+        // Lists the sessions if the set may have changed, then fetches only
+        // those whose own events fired since the last refresh, each bounded
+        // by |timeout|. Returns what changed for the sessions stream.
+        // Without SetupSessionsListeners() the list is read every time;
+        // sessions once listed keep being watched for their events.
+        CoTask<SessionRegistry::Changes> RefreshSessionsAsync(std::chrono::milliseconds timeout);
+        // Worker thread only.
+        const SessionRegistry &Sessions() const { return session_registry_; }
+        const EventMultiplexer &Events() const { return events_; }
+
         bool IsPlaying();
 
+        // Worker thread only, like the fetches that fill it.
+        const AlbumArtCache &ArtCache() const { return art_cache_; }
+        const ThumbnailChangeDetector &ArtChangeDetector() const { return art_change_detector_; }
+        uint64_t SnapshotHitCount() const { return snapshot_cache_.HitCount(); }
+        uint64_t SnapshotMissCount() const { return snapshot_cache_.MissCount(); }
+        uint64_t SnapshotDiscardedCount() const { return snapshot_cache_.DiscardedCount(); }
+        // Image executor only, or once that has stopped.
+        const AlbumArtTranscoder &ArtTranscoder() const { return art_transcoder_; }
+
         void callCallbacks();
 
-        bool PlayPause();
-        bool SkipToNext();
-        bool SkipToPrevious();
-        bool Stop();
-        bool SeekTo(int64_t position_ms);
+        // Each command gives up on the underlying async operation, and cancels
+        // it, once |timeout| has passed. A |session_id| (SourceAppUserModelId)
+        // targets that session instead of the current one.
+        CoTask<CallResult> PlayPauseAsync(std::chrono::milliseconds timeout, std::string session_id = {});
+        CoTask<CallResult> SkipToNextAsync(std::chrono::milliseconds timeout, std::string session_id = {});
+        CoTask<CallResult> SkipToPreviousAsync(std::chrono::milliseconds timeout, std::string session_id = {});
+        CoTask<CallResult> StopAsync(std::chrono::milliseconds timeout, std::string session_id = {});
+        CoTask<CallResult> SeekToAsync(int64_t position_ms, std::chrono::milliseconds timeout,
+                                       std::string session_id = {});
 
     private:
-        winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSessionManager media_manager_{nullptr};
+        using CommandStarter = std::function<winrt::Windows::Foundation::IAsyncOperation<bool>(
+            winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSession const &)>;
+
+        // The worker's Control lane; event handlers also post subscription
+        // changes here.
+        std::shared_ptr<Executor> command_executor_;
+        std::shared_ptr<Executor> fetch_executor_;
+        std::shared_ptr<Executor> art_executor_;
+        std::shared_ptr<Executor> image_executor_;
 
-        // tokens for media change event
-        winrt::event_token sessions_changed_token_;
-        winrt::event_token current_session_changed_token_;
-        winrt::event_token media_properties_changed_token_;
-        winrt::event_token playback_info_changed_token_;
+        winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSessionManager media_manager_{nullptr};
 
-        // tokens for position change event
-        winrt::event_token current_session_changed_token_for_position_;
-        winrt::event_token playback_info_changed_token_for_position_;
-        winrt::event_token media_properties_changed_token_for_position_;
-        winrt::event_token timeline_properties_changed_token_;
+        // Everything one fetch of the current session produced, with the art
+        // as read, before any ArtRequest is applied.
+        struct MediaSnapshot
+        {
+            flutter::EncodableMap map;
+            std::vector<uint8_t> art;
+            AlbumArtKey art_key;
+            // An earlier track with the same thumbnail, for ArtVariantAsync.
+            std::optional<AlbumArtKey> same_art;
+            uint64_t art_version = 0;
+            // The same fetch as the sessions stream reports it.
+            SessionState session;
+        };
+
+        struct SnapshotFetch
+        {
+            CallResult result = CallResult::Success;
+            MediaSnapshot snapshot;
+            // Nothing was left out for lack of time; only then is it cached.
+            bool complete = false;
+        };
+
+        AlbumArtCache art_cache_;
+        // The thumbnail of the last track that had one: what a new track's
+        // thumbnail is compared against.
+        ThumbnailChangeDetector art_change_detector_;
+        AlbumArtKey last_art_key_;
+        uint64_t art_version_ = 0;
+        AlbumArtTranscoder art_transcoder_;
+        // Invalidated by the media event handlers, on whatever thread WinRT
+        // raises them.
+        SnapshotCache<MediaSnapshot> snapshot_cache_;
+
+        using SubscriptionIds = std::vector<EventMultiplexer::SubscriptionId>;
+
+        // subscriptions for media change event
+        SubscriptionIds media_subscriptions_;
+        SubscriptionIds media_session_subscriptions_;
+
+        // subscriptions for position change event
+        SubscriptionIds position_subscriptions_;
+        SubscriptionIds position_session_subscriptions_;
+
+        // Every listed session, for the sessions stream.
+        struct TrackedSession
+        {
+            winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSession session{nullptr};
+            SubscriptionIds subscriptions;
+        };
+        SessionRegistry session_registry_;
+        std::unordered_map<std::string, TrackedSession> tracked_sessions_;
+        SubscriptionIds sessions_subscriptions_;
+        // Current session fetches for the media stream under way; the sessions
+        // stream takes its state of that session from them.
+        int snapshot_fetches_in_flight_ = 0;
 
         // callbacks
         MediaEventListenerCallback on_media_changed_;
         EventListenerCallback on_position_changed_;
+        EventListenerCallback on_sessions_changed_;
+
+        // One WinRT registration per session and event, shared by the media,
+        // position and sessions listeners above. Declared last so it revokes
+        // them before anything they reach is gone.
+        EventMultiplexer events_;
 
         winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSession GetCurrentSession();
+        // Registers the WinRT handler behind |key|, for events_.
+        EventMultiplexer::Revoker AttachEvent(const EventKey &key);
+        void Unsubscribe(SubscriptionIds &subscriptions);
+        // The current session for an empty |session_id|.
+        winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSession FindSession(
+            const std::string &session_id);
+
+        void TrackSession(const std::string &id,
+                          winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSession session);
+        void UntrackSession(const std::string &id);
+        CoTask<std::optional<SessionState>> FetchSessionStateAsync(
+            winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSession session,
+            std::string id, std::chrono::milliseconds timeout);
 
         std::string PlaybackStatusToString(
             winrt::Windows::Media::Control::GlobalSystemMediaTransportControlsSessionPlaybackStatus status);
 
-        std::vector<uint8_t> IRandomAccessStreamReferenceToByteArray(
-            winrt::Windows::Storage::Streams::IRandomAccessStreamReference const &stream_ref);
+        // |require_true| also treats a false result from the session as a failure.
+        CoTask<CallResult> RunCommandAsync(CommandStarter start, std::chrono::milliseconds timeout,
+                                           bool require_true, std::string session_id);
+
+        CoTask<SnapshotFetch> FetchSnapshotAsync(std::chrono::milliseconds timeout,
+                                                 std::chrono::milliseconds art_timeout);
+
+        struct AlbumArtRead
+        {
+            std::vector<uint8_t> bytes;
+            // The thumbnail matched the previous one, whose bytes these are.
+            bool unchanged = false;
+        };
+
+        CoTask<AlbumArtRead> ReadAlbumArtAsync(
+            winrt::Windows::Storage::Streams::IRandomAccessStreamReference stream_ref,
+            std::chrono::milliseconds timeout);
+
+        // |original| as |request| wants it, from the cache or the image
+        // executor; |original| itself if it cannot be transcoded. |same_art|
+        // names an earlier track known to have the same thumbnail.
+        CoTask<std::vector<uint8_t>> ArtVariantAsync(AlbumArtKey key, std::optional<AlbumArtKey> same_art,
+                                                     std::vector<uint8_t> original, ArtRequest request);
+
+        // Appends up to |length| bytes from the stream's current position.
+        CoTask<bool> ReadStreamAsync(winrt::Windows::Storage::Streams::IRandomAccessStream stream,
+                                     uint32_t length, const Deadline &deadline,
+                                     std::vector<uint8_t> &out);
     };
 
 } // namespace media_notification_service
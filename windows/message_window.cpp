@@ -0,0 +1,64 @@
+#include "message_window.h"
+
+#include <utility>
+
+namespace media_notification_service
+{
+    static const UINT WM_DISPATCH = WM_USER + 1;
+    static const wchar_t kWindowClassName[] = L"MediaNotificationServiceMessageWindow";
+
+    MessageWindow::MessageWindow(std::function<void()> on_wake)
+        : on_wake_(std::move(on_wake)), window_(nullptr)
+    {
+        WNDCLASS wc = {};
+        wc.lpfnWndProc = MessageWindow::WndProc;
+        wc.hInstance = GetModuleHandle(nullptr);
+        wc.lpszClassName = kWindowClassName;
+        RegisterClass(&wc);
+
+        window_ = CreateWindowEx(
+            0, kWindowClassName, L"", 0,
+            0, 0, 0, 0, HWND_MESSAGE, nullptr, GetModuleHandle(nullptr), nullptr);
+
+        if (window_)
+        {
+            SetWindowLongPtr(window_, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+        }
+    }
+
+    MessageWindow::~MessageWindow()
+    {
+        Close();
+    }
+
+    bool MessageWindow::Wake()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return window_ && PostMessage(window_, WM_DISPATCH, 0, 0) != 0;
+    }
+
+    void MessageWindow::Close()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (window_)
+        {
+            DestroyWindow(window_);
+            window_ = nullptr;
+        }
+    }
+
+    LRESULT CALLBACK MessageWindow::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+    {
+        if (msg == WM_DISPATCH)
+        {
+            MessageWindow *self = reinterpret_cast<MessageWindow *>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
+            if (self && self->on_wake_)
+            {
+                self->on_wake_();
+            }
+            return 0;
+        }
+        return DefWindowProc(hwnd, msg, wParam, lParam);
+    }
+
+} // namespace media_notification_service
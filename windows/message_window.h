@@ -0,0 +1,42 @@
+#ifndef MESSAGE_WINDOW_H_
+#define MESSAGE_WINDOW_H_
+
+#include "wake_signal.h"
+
+#include <functional>
+#include <mutex>
+#include <windows.h>
+
+namespace media_notification_service
+{
+    // A message-only window on the platform thread. Wake posts it a message,
+    // and |on_wake| runs when the platform thread's message loop gets to it.
+    class MessageWindow : public WakeSignal
+    {
+    public:
+        // Must be created on the platform thread.
+        explicit MessageWindow(std::function<void()> on_wake);
+        ~MessageWindow();
+
+        MessageWindow(const MessageWindow &) = delete;
+        MessageWindow &operator=(const MessageWindow &) = delete;
+
+        // Any thread; fails once the window is closed.
+        bool Wake() override;
+
+        // Platform thread only: destroys the window early, for an owner that
+        // may outlive the platform thread's part in it.
+        void Close();
+
+    private:
+        static LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+        std::function<void()> on_wake_;
+        // Guards |window_| between Wake and Close.
+        std::mutex mutex_;
+        HWND window_;
+    };
+
+} // namespace media_notification_service
+
+#endif // MESSAGE_WINDOW_H_
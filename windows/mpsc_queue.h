@@ -0,0 +1,167 @@
+#ifndef MPSC_QUEUE_H_
+#define MPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace media_notification_service
+{
+    // Multi-producer, single-consumer queue. Producers claim slots of a fixed
+    // ring with a single CAS (Vyukov's bounded queue); only when the ring is
+    // full do they fall back to a mutex-guarded overflow list, which keeps the
+    // queue unbounded without putting a lock on the common path. Push may be
+    // called from any thread, TryPop/Empty only from the consumer.
+    template <typename T>
+    class MpscQueue
+    {
+    public:
+        explicit MpscQueue(size_t capacity = 1024)
+        {
+            size_t size = 2;
+            while (size < capacity)
+            {
+                size <<= 1;
+            }
+            mask_ = size - 1;
+            cells_ = std::make_unique<Cell[]>(size);
+            for (size_t i = 0; i < size; ++i)
+            {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        MpscQueue(const MpscQueue &) = delete;
+        MpscQueue &operator=(const MpscQueue &) = delete;
+
+        void Push(T value)
+        {
+            if (!overflowing_.load(std::memory_order_acquire) && TryPushRing(value))
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(overflow_mutex_);
+            overflow_.push_back(std::move(value));
+            overflow_size_.store(overflow_.size(), std::memory_order_relaxed);
+            overflowing_.store(true, std::memory_order_release);
+        }
+
+        bool TryPop(T &value)
+        {
+            if (TryPopRing(value))
+            {
+                return true;
+            }
+
+            if (!overflowing_.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock(overflow_mutex_);
+            if (overflow_.empty())
+            {
+                return false;
+            }
+            value = std::move(overflow_.front());
+            overflow_.pop_front();
+            overflow_size_.store(overflow_.size(), std::memory_order_relaxed);
+            if (overflow_.empty())
+            {
+                overflowing_.store(false, std::memory_order_release);
+            }
+            return true;
+        }
+
+        // A slot that has been claimed but not yet published reads as empty;
+        // its producer is still going to signal the consumer afterwards.
+        bool Empty() const
+        {
+            size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            const Cell &cell = cells_[pos & mask_];
+            return cell.sequence.load(std::memory_order_acquire) != pos + 1 &&
+                   !overflowing_.load(std::memory_order_acquire);
+        }
+
+        // Approximate when called concurrently with producers.
+        size_t Size() const
+        {
+            size_t head = dequeue_pos_.load(std::memory_order_relaxed);
+            size_t tail = enqueue_pos_.load(std::memory_order_relaxed);
+            size_t ring = tail > head ? tail - head : 0;
+            return ring + overflow_size_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence{0};
+            T value{};
+        };
+
+        bool TryPushRing(T &value)
+        {
+            size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+            Cell *cell;
+            while (true)
+            {
+                cell = &cells_[pos & mask_];
+                size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+                if (diff == 0)
+                {
+                    if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            cell->value = std::move(value);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool TryPopRing(T &value)
+        {
+            size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            Cell &cell = cells_[pos & mask_];
+            if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+            {
+                return false;
+            }
+
+            value = std::move(cell.value);
+            cell.value = T{};
+            cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+            dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        std::unique_ptr<Cell[]> cells_;
+        size_t mask_ = 0;
+
+        alignas(64) std::atomic<size_t> enqueue_pos_{0};
+        alignas(64) std::atomic<size_t> dequeue_pos_{0};
+
+        alignas(64) std::atomic<bool> overflowing_{false};
+        std::atomic<size_t> overflow_size_{0};
+        std::mutex overflow_mutex_;
+        std::deque<T> overflow_;
+    };
+
+} // namespace media_notification_service
+
+#endif // MPSC_QUEUE_H_
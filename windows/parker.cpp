@@ -0,0 +1,115 @@
+#include "parker.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include <thread>
+#endif
+
+namespace media_notification_service
+{
+    namespace
+    {
+        void WaitWhileEqual(std::atomic<uint32_t> &word, uint32_t expected)
+        {
+#if defined(_WIN32)
+            WaitOnAddress(&word, &expected, sizeof(expected), INFINITE);
+#elif defined(__linux__)
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE,
+                    expected, nullptr, nullptr, 0);
+#else
+            (void)expected;
+            std::this_thread::yield();
+#endif
+        }
+
+        void WaitWhileEqualFor(std::atomic<uint32_t> &word, uint32_t expected,
+                               std::chrono::nanoseconds timeout)
+        {
+#if defined(_WIN32)
+            auto millis = std::chrono::ceil<std::chrono::milliseconds>(timeout).count();
+            WaitOnAddress(&word, &expected, sizeof(expected), static_cast<DWORD>(millis));
+#elif defined(__linux__)
+            timespec relative;
+            relative.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+            relative.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE,
+                    expected, &relative, nullptr, 0);
+#else
+            (void)expected;
+            (void)timeout;
+            std::this_thread::yield();
+#endif
+        }
+
+        void WakeOne(std::atomic<uint32_t> &word)
+        {
+#if defined(_WIN32)
+            WakeByAddressSingle(&word);
+#elif defined(__linux__)
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE,
+                    1, nullptr, nullptr, 0);
+#else
+            (void)word;
+#endif
+        }
+    } // namespace
+
+    void Parker::PrepareToPark()
+    {
+        state_.store(kParked, std::memory_order_relaxed);
+        // Pairs with the fence in Unpark: either the consumer sees the
+        // producer's work when it re-checks, or the producer sees kParked.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void Parker::CancelPark()
+    {
+        state_.store(kRunning, std::memory_order_relaxed);
+    }
+
+    void Parker::Park()
+    {
+        while (state_.load(std::memory_order_acquire) == kParked)
+        {
+            WaitWhileEqual(state_, kParked);
+        }
+    }
+
+    bool Parker::ParkUntil(std::chrono::steady_clock::time_point deadline)
+    {
+        while (state_.load(std::memory_order_acquire) == kParked)
+        {
+            auto remaining = deadline - std::chrono::steady_clock::now();
+            if (remaining <= std::chrono::steady_clock::duration::zero())
+            {
+                // A producer racing with us may also flip this; either way
+                // the consumer re-checks its queue next.
+                return state_.exchange(kRunning, std::memory_order_acquire) != kParked;
+            }
+            WaitWhileEqualFor(state_, kParked, remaining);
+        }
+        return true;
+    }
+
+    bool Parker::Unpark()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (state_.load(std::memory_order_relaxed) == kRunning)
+        {
+            return false;
+        }
+        if (state_.exchange(kRunning, std::memory_order_release) != kParked)
+        {
+            return false;
+        }
+        WakeOne(state_);
+        return true;
+    }
+
+} // namespace media_notification_service
@@ -0,0 +1,45 @@
+#ifndef PARKER_H_
+#define PARKER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace media_notification_service
+{
+    // Lets a single consumer thread sleep on a futex (WaitOnAddress on
+    // Windows) and lets producers skip the wake-up syscall entirely while the
+    // consumer is running.
+    //
+    // Consumer side:
+    //   parker.PrepareToPark();
+    //   if (work is available) parker.CancelPark(); else parker.Park();
+    //
+    // Producer side: publish the work, then call Unpark().
+    class Parker
+    {
+    public:
+        Parker() = default;
+
+        Parker(const Parker &) = delete;
+        Parker &operator=(const Parker &) = delete;
+
+        void PrepareToPark();
+        void CancelPark();
+        void Park();
+        // Like Park() but gives up at |deadline|. Returns false on timeout.
+        bool ParkUntil(std::chrono::steady_clock::time_point deadline);
+
+        // Returns true if the consumer was parked and had to be woken.
+        bool Unpark();
+
+    private:
+        static constexpr uint32_t kRunning = 0;
+        static constexpr uint32_t kParked = 1;
+
+        std::atomic<uint32_t> state_{kRunning};
+    };
+
+} // namespace media_notification_service
+
+#endif // PARKER_H_
@@ -0,0 +1,50 @@
+#include "platform_dispatcher.h"
+
+#include <deque>
+#include <utility>
+
+namespace media_notification_service
+{
+    PlatformDispatcher::PlatformDispatcher(WakeSignal &wake) : scheduler_(wake) {}
+
+    void PlatformDispatcher::AddSource(DispatchSource &source)
+    {
+        sources_.push_back(&source);
+    }
+
+    void PlatformDispatcher::Post(InplaceTask task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(tasks_mutex_);
+            tasks_.Push(std::move(task));
+        }
+        scheduler_.Schedule();
+    }
+
+    void PlatformDispatcher::Schedule()
+    {
+        scheduler_.Schedule();
+    }
+
+    void PlatformDispatcher::Drain()
+    {
+        scheduler_.BeginDrain();
+        ++drain_count_;
+
+        std::deque<InplaceTask> tasks;
+        {
+            std::lock_guard<std::mutex> lock(tasks_mutex_);
+            tasks_.TakeAll(tasks);
+        }
+        for (auto &task : tasks)
+        {
+            task();
+        }
+
+        for (auto *source : sources_)
+        {
+            source->DrainPending();
+        }
+    }
+
+} // namespace media_notification_service
@@ -0,0 +1,67 @@
+#ifndef PLATFORM_DISPATCHER_H_
+#define PLATFORM_DISPATCHER_H_
+
+#include "drain_scheduler.h"
+#include "event_mailbox.h"
+#include "executor.h"
+#include "wake_signal.h"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace media_notification_service
+{
+    // Something with events waiting for the platform thread, e.g. a stream.
+    class DispatchSource
+    {
+    public:
+        virtual ~DispatchSource() = default;
+
+        // Platform thread only: deliver whatever is pending.
+        virtual void DrainPending() = 0;
+    };
+
+    // The plugin's single way onto the platform thread. Producers on any
+    // thread queue their work and call Schedule (or Post a task); one
+    // wake-up then drains all of it in a single pass: posted tasks (method
+    // results) first, then each source in the order it was added.
+    class PlatformDispatcher : public Executor
+    {
+    public:
+        explicit PlatformDispatcher(WakeSignal &wake);
+
+        PlatformDispatcher(const PlatformDispatcher &) = delete;
+        PlatformDispatcher &operator=(const PlatformDispatcher &) = delete;
+
+        // Before anything is scheduled; the source must outlive the
+        // dispatcher's last Drain.
+        void AddSource(DispatchSource &source);
+
+        // Any thread: runs |task| on the platform thread, ahead of events.
+        void Post(InplaceTask task) override;
+
+        // Any thread, after queuing an event with a source.
+        void Schedule();
+
+        // Platform thread, when the wake signal arrives.
+        void Drain();
+
+        uint64_t WakeCount() const { return scheduler_.WakeCount(); }
+        uint64_t SavedWakeCount() const { return scheduler_.SavedWakeCount(); }
+        uint64_t DrainCount() const { return drain_count_; }
+
+    private:
+        DrainScheduler scheduler_;
+        std::vector<DispatchSource *> sources_;
+
+        std::mutex tasks_mutex_;
+        EventMailbox<InplaceTask> tasks_;
+
+        // Platform thread only.
+        uint64_t drain_count_ = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // PLATFORM_DISPATCHER_H_
@@ -0,0 +1,56 @@
+#include "position_anchor.h"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace media_notification_service
+{
+    int64_t PositionAnchor::PositionAt(int64_t at_ms) const
+    {
+        if (!playing)
+        {
+            return position_ms;
+        }
+
+        int64_t position = position_ms + static_cast<int64_t>(std::llround(static_cast<double>(at_ms - timestamp_ms) * rate));
+        if (duration_ms > 0 && position > duration_ms)
+        {
+            position = duration_ms;
+        }
+        return position < 0 ? 0 : position;
+    }
+
+    AnchorFilter::AnchorFilter(std::chrono::milliseconds drift_threshold)
+        : drift_threshold_(drift_threshold) {}
+
+    bool AnchorFilter::Accept(const PositionAnchor &anchor)
+    {
+        bool changed = !last_ ||
+                       anchor.state != last_->state ||
+                       anchor.playing != last_->playing ||
+                       anchor.rate != last_->rate ||
+                       anchor.duration_ms != last_->duration_ms;
+
+        if (!changed)
+        {
+            int64_t expected = last_->PositionAt(anchor.timestamp_ms);
+            changed = std::llabs(anchor.position_ms - expected) > drift_threshold_.count();
+        }
+
+        if (!changed)
+        {
+            ++suppressed_;
+            return false;
+        }
+
+        last_ = anchor;
+        ++accepted_;
+        return true;
+    }
+
+    void AnchorFilter::Reset()
+    {
+        last_.reset();
+    }
+
+} // namespace media_notification_service
@@ -0,0 +1,53 @@
+#ifndef POSITION_ANCHOR_H_
+#define POSITION_ANCHOR_H_
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace media_notification_service
+{
+    // A position valid at |timestamp_ms| (Unix epoch), which a receiver can
+    // extrapolate on its own while |playing|.
+    struct PositionAnchor
+    {
+        int64_t position_ms = 0;
+        int64_t timestamp_ms = 0;
+        double rate = 1.0;
+        int64_t duration_ms = 0;
+        std::string state;
+        bool playing = false;
+
+        // Where this anchor puts playback at |at_ms|.
+        int64_t PositionAt(int64_t at_ms) const;
+    };
+
+    // Decides which position samples are worth sending to a receiver that
+    // extrapolates locally: only those that change state, rate or duration,
+    // or that have drifted from the last sent anchor by more than a threshold.
+    class AnchorFilter
+    {
+    public:
+        explicit AnchorFilter(std::chrono::milliseconds drift_threshold);
+
+        // Returns true, and remembers |anchor| as the last sent one, if the
+        // receiver needs it.
+        bool Accept(const PositionAnchor &anchor);
+
+        // The next sample is always accepted, e.g. for a new subscriber.
+        void Reset();
+
+        uint64_t AcceptedCount() const { return accepted_; }
+        uint64_t SuppressedCount() const { return suppressed_; }
+
+    private:
+        std::chrono::milliseconds drift_threshold_;
+        std::optional<PositionAnchor> last_;
+        uint64_t accepted_ = 0;
+        uint64_t suppressed_ = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // POSITION_ANCHOR_H_
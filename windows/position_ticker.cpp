@@ -0,0 +1,149 @@
+#include "position_ticker.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace media_notification_service
+{
+    namespace
+    {
+        // Aligned ticks land this far past the boundary so that a read
+        // rounding down still shows the new second.
+        constexpr std::chrono::milliseconds kAlignMargin{5};
+    } // namespace
+
+    PositionTicker::PositionTicker(WorkerThread &worker, std::chrono::milliseconds interval,
+                                   std::chrono::milliseconds slack)
+        : worker_(worker), slack_(slack)
+    {
+        options_.interval = interval;
+    }
+
+    void PositionTicker::Start(EmitFunction emit)
+    {
+        emit_ = std::move(emit);
+        Refresh();
+    }
+
+    void PositionTicker::Stop()
+    {
+        Disarm();
+        emit_ = nullptr;
+    }
+
+    void PositionTicker::SetOptions(PositionTickOptions options)
+    {
+        options_ = options;
+        if (timer_)
+        {
+            Disarm();
+            Refresh();
+        }
+    }
+
+    void PositionTicker::Refresh()
+    {
+        if (!emit_)
+        {
+            return;
+        }
+
+        events_.fetch_add(1, std::memory_order_relaxed);
+        PlaybackSample sample = emit_();
+        if (!sample.advancing)
+        {
+            Disarm();
+            return;
+        }
+
+        // A seek moves the next second boundary.
+        if (options_.align_to_second)
+        {
+            Disarm();
+        }
+        Arm(sample);
+    }
+
+    bool PositionTicker::IsTicking() const
+    {
+        return timer_.has_value();
+    }
+
+    uint64_t PositionTicker::TimerWakeCount() const
+    {
+        return timer_wakes_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t PositionTicker::EventCount() const
+    {
+        return events_.load(std::memory_order_relaxed);
+    }
+
+    std::chrono::milliseconds PositionTicker::DelayToNextSecond(const PlaybackSample &sample)
+    {
+        auto into_second = sample.position.count() % 1000;
+        if (into_second < 0)
+        {
+            into_second += 1000;
+        }
+        double rate = sample.rate > 0.0 ? sample.rate : 1.0;
+        auto wall = static_cast<int64_t>(std::ceil((1000 - into_second) / rate));
+        return std::chrono::milliseconds(wall) + kAlignMargin;
+    }
+
+    void PositionTicker::OnTimer()
+    {
+        if (!emit_)
+        {
+            return;
+        }
+
+        timer_wakes_.fetch_add(1, std::memory_order_relaxed);
+        PlaybackSample sample = emit_();
+        // The update that first sees playback stopped is the final one; after
+        // that only an event brings the ticker back.
+        if (!sample.advancing)
+        {
+            Disarm();
+            return;
+        }
+
+        if (options_.align_to_second)
+        {
+            // The one-shot that got us here has already fired.
+            timer_.reset();
+            Arm(sample);
+        }
+    }
+
+    void PositionTicker::Arm(const PlaybackSample &sample)
+    {
+        if (timer_)
+        {
+            return;
+        }
+
+        if (options_.align_to_second)
+        {
+            timer_ = worker_.EnqueueAfter(DelayToNextSecond(sample), [this]()
+                                          { OnTimer(); },
+                                          slack_, TaskPriority::Position);
+            return;
+        }
+
+        auto slack = std::min(slack_, options_.interval / 4);
+        timer_ = worker_.EnqueueEvery(options_.interval, [this]()
+                                      { OnTimer(); },
+                                      slack, TaskPriority::Position);
+    }
+
+    void PositionTicker::Disarm()
+    {
+        if (timer_)
+        {
+            worker_.CancelTimer(*timer_);
+            timer_.reset();
+        }
+    }
+
+} // namespace media_notification_service
@@ -0,0 +1,88 @@
+#ifndef POSITION_TICKER_H_
+#define POSITION_TICKER_H_
+
+#include "inplace_task.h"
+#include "worker_thread.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace media_notification_service
+{
+    struct PositionTickOptions
+    {
+        std::chrono::milliseconds interval{100};
+        // Tick when the extrapolated position crosses the next whole second
+        // (i.e. when an mm:ss display changes) instead of every |interval|.
+        bool align_to_second = false;
+    };
+
+    // What an update saw; enough to decide when the next one is useful.
+    struct PlaybackSample
+    {
+        // Playing at a positive rate.
+        bool advancing = false;
+        std::chrono::milliseconds position{0};
+        double rate = 1.0;
+    };
+
+    // Drives position updates from playback state: a worker timer runs only
+    // while something is advancing, and playback events wake it otherwise.
+    // Everything except the counters is worker-thread only. Stop the ticker
+    // on the worker before destroying it, unless the worker is already gone.
+    class PositionTicker
+    {
+    public:
+        // Sends one position update and reports what it saw.
+        using EmitFunction = InplaceFunction<PlaybackSample()>;
+
+        // |slack| is the most a tick may be delayed to share a wake-up; it is
+        // capped at a quarter of the interval.
+        PositionTicker(WorkerThread &worker, std::chrono::milliseconds interval,
+                       std::chrono::milliseconds slack);
+
+        PositionTicker(const PositionTicker &) = delete;
+        PositionTicker &operator=(const PositionTicker &) = delete;
+
+        void Start(EmitFunction emit);
+        void Stop();
+
+        // Takes effect immediately if the ticker is running.
+        void SetOptions(PositionTickOptions options);
+
+        // A playback, session or timeline event: emits right away, then keeps
+        // ticking or goes to sleep depending on what the emit saw.
+        void Refresh();
+
+        bool IsTicking() const;
+
+        // Updates sent because the tick timer fired. Stays flat while paused,
+        // stopped or without a session.
+        uint64_t TimerWakeCount() const;
+        // Updates sent because of an event.
+        uint64_t EventCount() const;
+
+        // Wall time until |sample|'s position reaches the next whole second.
+        static std::chrono::milliseconds DelayToNextSecond(const PlaybackSample &sample);
+
+    private:
+        void OnTimer();
+        void Arm(const PlaybackSample &sample);
+        void Disarm();
+
+        WorkerThread &worker_;
+        PositionTickOptions options_;
+        std::chrono::milliseconds slack_;
+
+        EmitFunction emit_;
+        std::optional<WorkerThread::TimerId> timer_;
+
+        std::atomic<uint64_t> timer_wakes_{0};
+        std::atomic<uint64_t> events_{0};
+    };
+
+} // namespace media_notification_service
+
+#endif // POSITION_TICKER_H_
@@ -0,0 +1,202 @@
+#include "session_registry.h"
+
+#include <utility>
+
+namespace media_notification_service
+{
+    void SessionRegistry::MarkStale(const std::string &id)
+    {
+        std::lock_guard<std::mutex> lock(stale_mutex_);
+        stale_[id] = ++marks_;
+    }
+
+    void SessionRegistry::MarkListChanged()
+    {
+        std::lock_guard<std::mutex> lock(stale_mutex_);
+        list_changed_ = true;
+    }
+
+    bool SessionRegistry::TakeListChanged()
+    {
+        std::lock_guard<std::mutex> lock(stale_mutex_);
+        return std::exchange(list_changed_, false);
+    }
+
+    SessionRegistry::ListDiff SessionRegistry::SyncIds(const std::vector<std::string> &ids)
+    {
+        ++list_syncs_;
+        ListDiff diff;
+        std::unordered_set<std::string> present;
+        present.reserve(ids.size());
+        for (const auto &id : ids)
+        {
+            if (!present.insert(id).second)
+            {
+                continue;
+            }
+            if (sessions_.find(id) == sessions_.end())
+            {
+                sessions_[id].state.id = id;
+                diff.added.push_back(id);
+            }
+        }
+
+        for (auto it = sessions_.begin(); it != sessions_.end();)
+        {
+            if (present.count(it->first))
+            {
+                ++it;
+                continue;
+            }
+            // Never reported, so there is nothing to take back.
+            if (it->second.fetched)
+            {
+                removed_.push_back(it->first);
+            }
+            diff.removed.push_back(it->first);
+            it = sessions_.erase(it);
+        }
+
+        if (!diff.added.empty())
+        {
+            std::lock_guard<std::mutex> lock(stale_mutex_);
+            ++marks_;
+            for (const auto &id : diff.added)
+            {
+                stale_[id] = marks_;
+            }
+        }
+        return diff;
+    }
+
+    std::vector<std::string> SessionRegistry::TakeStale(const std::string &keep)
+    {
+        std::unordered_map<std::string, uint64_t> stale;
+        {
+            std::lock_guard<std::mutex> lock(stale_mutex_);
+            stale.swap(stale_);
+            auto kept = stale.find(keep);
+            if (kept != stale.end())
+            {
+                stale_.insert(stale.extract(kept));
+            }
+        }
+
+        std::vector<std::string> known;
+        known.reserve(stale.size());
+        for (auto &entry : stale)
+        {
+            // A late event from a removed session. Should it be listed again,
+            // SyncIds() marks it stale anyway.
+            if (sessions_.count(entry.first))
+            {
+                known.push_back(entry.first);
+            }
+        }
+        return known;
+    }
+
+    uint64_t SessionRegistry::MarkCount()
+    {
+        std::lock_guard<std::mutex> lock(stale_mutex_);
+        return marks_;
+    }
+
+    bool SessionRegistry::Supply(SessionState state, uint64_t mark_count)
+    {
+        if (sessions_.find(state.id) == sessions_.end())
+        {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(stale_mutex_);
+            auto stale = stale_.find(state.id);
+            if (stale != stale_.end() && stale->second <= mark_count)
+            {
+                stale_.erase(stale);
+            }
+        }
+        ++supplied_;
+        return Update(std::move(state));
+    }
+
+    bool SessionRegistry::Update(SessionState state)
+    {
+        auto it = sessions_.find(state.id);
+        if (it == sessions_.end())
+        {
+            return false;
+        }
+        ++fetches_;
+
+        Entry &entry = it->second;
+        if (entry.fetched && entry.state == state)
+        {
+            ++unchanged_;
+            return false;
+        }
+        entry.state = std::move(state);
+        entry.fetched = true;
+        if (!entry.pending)
+        {
+            entry.pending = true;
+            changed_.push_back(it->first);
+        }
+        return true;
+    }
+
+    SessionRegistry::Changes SessionRegistry::TakeChanges()
+    {
+        Changes changes;
+        changes.removed = std::move(removed_);
+        removed_.clear();
+
+        changes.changed.reserve(changed_.size());
+        for (const auto &id : changed_)
+        {
+            // Removed since it changed.
+            auto it = sessions_.find(id);
+            if (it == sessions_.end() || !it->second.pending)
+            {
+                continue;
+            }
+            it->second.pending = false;
+            changes.changed.push_back(it->second.state);
+        }
+        changed_.clear();
+        return changes;
+    }
+
+    std::vector<SessionState> SessionRegistry::All() const
+    {
+        std::vector<SessionState> all;
+        all.reserve(sessions_.size());
+        for (const auto &[id, entry] : sessions_)
+        {
+            if (entry.fetched)
+            {
+                all.push_back(entry.state);
+            }
+        }
+        return all;
+    }
+
+    const SessionState *SessionRegistry::Find(const std::string &id) const
+    {
+        auto it = sessions_.find(id);
+        return it != sessions_.end() && it->second.fetched ? &it->second.state : nullptr;
+    }
+
+    void SessionRegistry::Clear()
+    {
+        {
+            std::lock_guard<std::mutex> lock(stale_mutex_);
+            stale_.clear();
+            list_changed_ = true;
+        }
+        sessions_.clear();
+        changed_.clear();
+        removed_.clear();
+    }
+
+} // namespace media_notification_service
@@ -0,0 +1,127 @@
+#ifndef SESSION_REGISTRY_H_
+#define SESSION_REGISTRY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace media_notification_service
+{
+    // What the sessions stream reports for one media session.
+    struct SessionState
+    {
+        // SourceAppUserModelId.
+        std::string id;
+        std::string title;
+        std::string artist;
+        std::string album;
+        std::string playback_state;
+        bool is_playing = false;
+
+        bool operator==(const SessionState &) const = default;
+    };
+
+    // The last fetched state of every media session, keyed by id. Each
+    // session's own events mark it stale and only stale sessions are fetched
+    // again, so a refresh costs as many fetches as sessions that changed. The
+    // list of ids is only compared when the set of sessions changed.
+    //
+    // MarkStale() and MarkListChanged() may be called from any thread, the
+    // rest only from the owner's.
+    class SessionRegistry
+    {
+    public:
+        void MarkStale(const std::string &id);
+        void MarkListChanged();
+
+        // Whether the set of sessions may have changed since the last call.
+        // True before the first call.
+        bool TakeListChanged();
+
+        struct ListDiff
+        {
+            std::vector<std::string> added;
+            std::vector<std::string> removed;
+        };
+
+        // Brings the known ids in line with |ids|, the sessions that exist
+        // now. Added sessions are stale until fetched; removed ones are
+        // reported by the next TakeChanges(). A repeated id is ignored.
+        ListDiff SyncIds(const std::vector<std::string> &ids);
+
+        // Known sessions marked stale since the last call, to fetch. Marks
+        // for unknown ids are dropped. |keep| stays marked, for a session
+        // whose state another fetch is about to Supply().
+        std::vector<std::string> TakeStale(const std::string &keep = {});
+
+        // Take before a fetch made for another reason, e.g. the media
+        // stream's, and hand to Supply() with its result.
+        uint64_t MarkCount();
+        // Update() with a state fetched elsewhere. Clears the session's stale
+        // mark unless it was marked again after |mark_count|.
+        bool Supply(SessionState state, uint64_t mark_count);
+
+        // Stores a fetched state. False, and nothing to report, if it matches
+        // the last one or |state.id| is not a known session.
+        bool Update(SessionState state);
+
+        struct Changes
+        {
+            std::vector<SessionState> changed;
+            std::vector<std::string> removed;
+
+            bool Empty() const { return changed.empty() && removed.empty(); }
+        };
+
+        // What changed since the last call. Sessions never fetched are left
+        // out until they are.
+        Changes TakeChanges();
+
+        // Every session fetched at least once.
+        std::vector<SessionState> All() const;
+        const SessionState *Find(const std::string &id) const;
+        size_t Size() const { return sessions_.size(); }
+
+        // Forgets everything, e.g. when no one listens any more; the next
+        // refresh lists and fetches every session again.
+        void Clear();
+
+        // Fetches, supplied ones included.
+        uint64_t FetchCount() const { return fetches_; }
+        uint64_t SuppliedCount() const { return supplied_; }
+        // Fetches that found nothing new.
+        uint64_t UnchangedCount() const { return unchanged_; }
+        uint64_t ListSyncCount() const { return list_syncs_; }
+
+    private:
+        struct Entry
+        {
+            SessionState state;
+            bool fetched = false;
+            // Listed in changed_.
+            bool pending = false;
+        };
+
+        std::mutex stale_mutex_;
+        // The MarkCount() each stale session was last marked at.
+        std::unordered_map<std::string, uint64_t> stale_;
+        uint64_t marks_ = 0;
+        bool list_changed_ = true;
+
+        std::unordered_map<std::string, Entry> sessions_;
+        std::vector<std::string> changed_;
+        std::vector<std::string> removed_;
+
+        uint64_t fetches_ = 0;
+        uint64_t supplied_ = 0;
+        uint64_t unchanged_ = 0;
+        uint64_t list_syncs_ = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // SESSION_REGISTRY_H_
@@ -0,0 +1,101 @@
+#include "settle_window.h"
+
+#include <algorithm>
+
+namespace media_notification_service
+{
+    SettleWindow::SettleWindow(SettleOptions options)
+    {
+        SetOptions(options);
+    }
+
+    void SettleWindow::SetOptions(SettleOptions options)
+    {
+        options.window = std::max(options.window, std::chrono::milliseconds::zero());
+        if (options.max_wait > std::chrono::milliseconds::zero())
+        {
+            // A timer armed for the settle deadline must never be late for
+            // the max_wait one.
+            options.max_wait = std::max(options.max_wait, options.window);
+        }
+        options_ = options;
+    }
+
+    bool SettleWindow::OnEvent(TimePoint now)
+    {
+        ++events_;
+        if (options_.window == std::chrono::milliseconds::zero())
+        {
+            Reset();
+            ++emits_;
+            return true;
+        }
+
+        last_event_ = now;
+        if (burst_start_)
+        {
+            pending_ = true;
+            return false;
+        }
+
+        burst_start_ = now;
+        if (options_.leading)
+        {
+            ++emits_;
+            pending_ = false;
+            return true;
+        }
+        pending_ = true;
+        return false;
+    }
+
+    std::optional<SettleWindow::TimePoint> SettleWindow::Deadline() const
+    {
+        if (!burst_start_)
+        {
+            return std::nullopt;
+        }
+        TimePoint settled = last_event_ + options_.window;
+        if (pending_ && options_.max_wait > std::chrono::milliseconds::zero())
+        {
+            return std::min(settled, *burst_start_ + options_.max_wait);
+        }
+        return settled;
+    }
+
+    bool SettleWindow::OnTimer(TimePoint now)
+    {
+        auto deadline = Deadline();
+        if (!deadline || now < *deadline)
+        {
+            return false;
+        }
+
+        bool settled = now >= last_event_ + options_.window;
+        // Reaching max_wait emits whatever the trailing setting; that is
+        // what it is for.
+        bool emit = pending_ && (options_.trailing || !settled);
+        if (emit)
+        {
+            ++emits_;
+            pending_ = false;
+        }
+
+        if (settled)
+        {
+            Reset();
+        }
+        else
+        {
+            burst_start_ = now;
+        }
+        return emit;
+    }
+
+    void SettleWindow::Reset()
+    {
+        burst_start_.reset();
+        pending_ = false;
+    }
+
+} // namespace media_notification_service
@@ -0,0 +1,70 @@
+#ifndef SETTLE_WINDOW_H_
+#define SETTLE_WINDOW_H_
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace media_notification_service
+{
+    struct SettleOptions
+    {
+        // Quiet time after the last event before a burst counts as settled.
+        // Zero passes every event straight through.
+        std::chrono::milliseconds window{250};
+        // Emit on the first event of a burst.
+        bool leading = false;
+        // Emit once the burst settles, if anything arrived since the last
+        // emit.
+        bool trailing = true;
+        // Longest an event may wait for an emit while events keep coming;
+        // zero for no limit. Never shorter than |window|.
+        std::chrono::milliseconds max_wait{1000};
+    };
+
+    // Folds a burst of events into as few emits as the options allow, so the
+    // work they trigger reads the state once it has settled. Time is passed
+    // in: the owner calls OnTimer() at Deadline(), from whatever clock and
+    // timer it has. Not thread-safe.
+    class SettleWindow
+    {
+    public:
+        using TimePoint = std::chrono::steady_clock::time_point;
+
+        explicit SettleWindow(SettleOptions options = {});
+
+        // Takes effect at once; a burst in progress is not dropped.
+        void SetOptions(SettleOptions options);
+
+        // An event at |now|. True if it should be emitted right away.
+        bool OnEvent(TimePoint now);
+
+        // When OnTimer() is next due, while a burst is open.
+        std::optional<TimePoint> Deadline() const;
+        // True if an emit is due at |now|. Early calls return false, so a
+        // timer armed for an earlier deadline may just fire and re-arm.
+        bool OnTimer(TimePoint now);
+
+        bool InBurst() const { return burst_start_.has_value(); }
+
+        // Closes any open burst without emitting.
+        void Reset();
+
+        uint64_t EventCount() const { return events_; }
+        uint64_t EmitCount() const { return emits_; }
+
+    private:
+        SettleOptions options_;
+        // Start of the open burst, or of its current max_wait period.
+        std::optional<TimePoint> burst_start_;
+        TimePoint last_event_{};
+        // An event arrived since the last emit.
+        bool pending_ = false;
+
+        uint64_t events_ = 0;
+        uint64_t emits_ = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // SETTLE_WINDOW_H_
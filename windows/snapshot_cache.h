@@ -0,0 +1,93 @@
+#ifndef SNAPSHOT_CACHE_H_
+#define SNAPSHOT_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace media_notification_service
+{
+    // The last fetch of something that is slow to read but announces every
+    // change with an event. Events bump a version; the snapshot is served
+    // only while the version it was fetched at is current. A fetch that an
+    // event overtook is not kept, as it may have read the old state.
+    //
+    // Off until enabled: without event subscriptions nothing would ever
+    // invalidate it. Invalidate() may be called from any thread, the rest
+    // only from the owner's.
+    template <typename Snapshot>
+    class SnapshotCache
+    {
+    public:
+        void Invalidate()
+        {
+            version_.fetch_add(1, std::memory_order_acq_rel);
+            invalidations_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Either way the current snapshot is dropped; events missed while
+        // disabled could have changed anything.
+        void SetEnabled(bool enabled)
+        {
+            enabled_ = enabled;
+            snapshot_.reset();
+        }
+
+        bool IsEnabled() const { return enabled_; }
+
+        // Copies the snapshot into |out| if it is still current.
+        bool Lookup(Snapshot &out)
+        {
+            if (!enabled_ || !snapshot_ || snapshot_version_ != version_.load(std::memory_order_acquire))
+            {
+                ++misses_;
+                return false;
+            }
+            ++hits_;
+            out = *snapshot_;
+            return true;
+        }
+
+        // Take before starting a fetch and hand to Store() with its result.
+        uint64_t BeginFetch() const { return version_.load(std::memory_order_acquire); }
+
+        // False, and nothing kept, if an event arrived since BeginFetch().
+        bool Store(uint64_t version, Snapshot snapshot)
+        {
+            if (!enabled_)
+            {
+                return false;
+            }
+            if (version != version_.load(std::memory_order_acquire))
+            {
+                ++discarded_;
+                return false;
+            }
+            snapshot_ = std::move(snapshot);
+            snapshot_version_ = version;
+            return true;
+        }
+
+        uint64_t HitCount() const { return hits_; }
+        uint64_t MissCount() const { return misses_; }
+        uint64_t InvalidationCount() const { return invalidations_.load(std::memory_order_relaxed); }
+        // Fetches overtaken by an event.
+        uint64_t DiscardedCount() const { return discarded_; }
+
+    private:
+        std::atomic<uint64_t> version_{0};
+        std::atomic<uint64_t> invalidations_{0};
+
+        bool enabled_ = false;
+        std::optional<Snapshot> snapshot_;
+        uint64_t snapshot_version_ = 0;
+
+        uint64_t hits_ = 0;
+        uint64_t misses_ = 0;
+        uint64_t discarded_ = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // SNAPSHOT_CACHE_H_
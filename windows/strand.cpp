@@ -0,0 +1,47 @@
+#include "strand.h"
+
+namespace media_notification_service
+{
+    Strand::Strand(ThreadPool &pool) : pool_(pool), queue_(256) {}
+
+    void Strand::Post(Task task)
+    {
+        queue_.Push(std::move(task));
+        if (!scheduled_.exchange(true))
+        {
+            Schedule();
+        }
+    }
+
+    void Strand::Schedule()
+    {
+        pool_.Post([this]()
+                   { Drain(); });
+    }
+
+    void Strand::Drain()
+    {
+        // Only one Drain is ever queued or running for a strand, which makes
+        // this thread the queue's single consumer for the duration.
+        Task task;
+        for (size_t i = 0; i < kMaxTasksPerTurn && queue_.TryPop(task); ++i)
+        {
+            task();
+            task = nullptr;
+        }
+
+        if (!queue_.Empty())
+        {
+            Schedule();
+            return;
+        }
+
+        scheduled_.store(false);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!queue_.Empty() && !scheduled_.exchange(true))
+        {
+            Schedule();
+        }
+    }
+
+} // namespace media_notification_service
@@ -0,0 +1,45 @@
+#ifndef STRAND_H_
+#define STRAND_H_
+
+#include "executor.h"
+#include "inplace_task.h"
+#include "mpsc_queue.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <cstddef>
+
+namespace media_notification_service
+{
+    // Serial queue on top of a ThreadPool: tasks posted to one strand run one
+    // at a time and in order, while different strands run in parallel on the
+    // pool's threads. A strand must outlive every task posted to it, i.e. stop
+    // the pool before destroying its strands.
+    class Strand : public Executor
+    {
+    public:
+        using Task = InplaceTask;
+
+        explicit Strand(ThreadPool &pool);
+
+        Strand(const Strand &) = delete;
+        Strand &operator=(const Strand &) = delete;
+
+        void Post(Task task) override;
+
+    private:
+        // Upper bound on tasks run per turn before yielding the pool thread to
+        // other strands.
+        static constexpr size_t kMaxTasksPerTurn = 16;
+
+        void Schedule();
+        void Drain();
+
+        ThreadPool &pool_;
+        MpscQueue<Task> queue_;
+        std::atomic<bool> scheduled_{false};
+    };
+
+} // namespace media_notification_service
+
+#endif // STRAND_H_
@@ -4,43 +4,37 @@
 #include <flutter/plugin_registrar_windows.h>
 #include <flutter/standard_method_codec.h>
 
+#include <deque>
+#include <utility>
+
 namespace media_notification_service
 {
-    static const UINT WM_STREAM_EVENT = WM_USER + 1;
-
-    StreamController::StreamController()
-        : message_window_(nullptr) {}
-
-    StreamController::~StreamController()
+    StreamController::StreamController(PlatformDispatcher &dispatcher, DeliveryPolicy policy)
+        : dispatcher_(dispatcher), pending_events_(policy)
     {
-        if (message_window_)
-        {
-            DestroyWindow(message_window_);
-            message_window_ = nullptr;
-        }
+        dispatcher_.AddSource(*this);
     }
 
-    LRESULT CALLBACK StreamController::WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+    StreamController::~StreamController() = default;
+
+    void StreamController::DrainPending()
     {
-        if (msg == WM_STREAM_EVENT)
+        // Take the whole batch and encode it with the queue unlocked, so
+        // senders never wait behind the codec.
+        std::deque<flutter::EncodableValue> events;
         {
-            StreamController *self = reinterpret_cast<StreamController *>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
-            if (self)
-            {
-                self->ProcessPendingEvents();
-            }
-            return 0;
+            std::lock_guard<std::mutex> lock(events_mutex_);
+            pending_events_.TakeAll(events);
         }
-        return DefWindowProc(hwnd, msg, wParam, lParam);
-    }
 
-    void StreamController::ProcessPendingEvents()
-    {
         std::lock_guard<std::mutex> lock(sink_mutex_);
-        while (!pending_events_.empty() && event_sink_)
+        if (!event_sink_)
+        {
+            return;
+        }
+        for (const auto &event : events)
         {
-            event_sink_->Success(pending_events_.front());
-            pending_events_.pop();
+            event_sink_->Success(event);
         }
     }
 
@@ -53,19 +47,6 @@ namespace media_notification_service
         on_listen_callback_ = on_listen;
         on_cancel_callback_ = on_cancel;
 
-        // Create a message-only window for thread marshalling
-        WNDCLASS wc = {};
-        wc.lpfnWndProc = StreamController::WndProc;
-        wc.hInstance = GetModuleHandle(nullptr);
-        wc.lpszClassName = L"StreamControllerMessageWindow";
-        RegisterClass(&wc);
-
-        message_window_ = CreateWindowEx(
-            0, L"StreamControllerMessageWindow", L"", 0,
-            0, 0, 0, 0, HWND_MESSAGE, nullptr, GetModuleHandle(nullptr), nullptr);
-
-        SetWindowLongPtr(message_window_, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
-
         event_channel_ = std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
             registrar->messenger(),
             channel_name,
@@ -86,15 +67,23 @@ namespace media_notification_service
     }
 
     void StreamController::Send(const flutter::EncodableValue &value)
+    {
+        Send(flutter::EncodableValue(value));
+    }
+
+    void StreamController::Send(flutter::EncodableValue &&value)
     {
         {
-            std::lock_guard<std::mutex> lock(sink_mutex_);
-            pending_events_.push(value);
-        }
-        if (message_window_)
-        {
-            PostMessage(message_window_, WM_STREAM_EVENT, 0, 0);
+            std::lock_guard<std::mutex> lock(events_mutex_);
+            pending_events_.Push(std::move(value));
         }
+        dispatcher_.Schedule();
+    }
+
+    uint64_t StreamController::DroppedEventCount()
+    {
+        std::lock_guard<std::mutex> lock(events_mutex_);
+        return pending_events_.DroppedCount();
     }
 
     void StreamController::SendError(const std::string &error_code, const std::string &error_message)
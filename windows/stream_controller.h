@@ -3,11 +3,13 @@
 
 #include <flutter/event_channel.h>
 #include <flutter/encodable_value.h>
+
+#include "event_mailbox.h"
+#include "platform_dispatcher.h"
+
 #include <mutex>
 #include <memory>
 #include <functional>
-#include <queue>
-#include <windows.h>
 #include <string>
 
 namespace flutter
@@ -17,13 +19,16 @@ namespace flutter
 
 namespace media_notification_service
 {
-    class StreamController
+    class StreamController : public DispatchSource
     {
     public:
         using OnListenCallback = std::function<void(const flutter::EncodableValue *arguments)>;
         using OnCancelCallback = std::function<void(const flutter::EncodableValue *arguments)>;
 
-        StreamController();
+        // Events reach the platform thread through |dispatcher|, which must
+        // outlive the controller.
+        explicit StreamController(PlatformDispatcher &dispatcher,
+                                  DeliveryPolicy policy = DeliveryPolicy::Queue());
         ~StreamController();
 
         StreamController(const StreamController &) = delete;
@@ -35,9 +40,18 @@ namespace media_notification_service
             OnListenCallback on_listen = nullptr,
             OnCancelCallback on_cancel = nullptr);
 
+        // Callable from any thread. Prefer the rvalue overload; the other one
+        // copies, album art included.
+        void Send(flutter::EncodableValue &&value);
         void Send(const flutter::EncodableValue &value);
         void SendError(const std::string &error_code, const std::string &error_message);
 
+        // Events the delivery policy discarded before the platform thread got
+        // to them.
+        uint64_t DroppedEventCount();
+
+        void DrainPending() override;
+
     private:
         std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> OnListen(
             const flutter::EncodableValue *arguments,
@@ -46,15 +60,14 @@ namespace media_notification_service
         std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> OnCancel(
             const flutter::EncodableValue *arguments);
 
-        static LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
-        void ProcessPendingEvents();
+        PlatformDispatcher &dispatcher_;
 
         std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>> event_channel_;
         std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> event_sink_;
         std::mutex sink_mutex_;
-        std::queue<flutter::EncodableValue> pending_events_;
-
-        HWND message_window_;
+        // Producers only ever wait on this one, never on event delivery.
+        std::mutex events_mutex_;
+        EventMailbox<flutter::EncodableValue> pending_events_;
 
         OnListenCallback on_listen_callback_;
         OnCancelCallback on_cancel_callback_;
@@ -62,4 +75,4 @@ namespace media_notification_service
 
 } // namespace media_notification_service
 
-#endif // STREAM_CONTROLLER_H_
\ No newline at end of file
+#endif // STREAM_CONTROLLER_H_
@@ -0,0 +1,66 @@
+#include "task_queue.h"
+
+namespace media_notification_service
+{
+    void TaskQueue::Push(Task task, TaskPriority priority)
+    {
+        lanes_[static_cast<size_t>(priority)].Push(std::move(task));
+    }
+
+    bool TaskQueue::TryPop(Task &task)
+    {
+        for (auto &lane : lanes_)
+        {
+            if (lane.TryPop(task))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool TaskQueue::TryPop(Task &task, TaskPriority priority)
+    {
+        return lanes_[static_cast<size_t>(priority)].TryPop(task);
+    }
+
+    size_t TaskQueue::Clear(TaskPriority priority)
+    {
+        size_t dropped = 0;
+        Task task;
+        while (lanes_[static_cast<size_t>(priority)].TryPop(task))
+        {
+            task = nullptr;
+            ++dropped;
+        }
+        return dropped;
+    }
+
+    bool TaskQueue::Empty() const
+    {
+        for (const auto &lane : lanes_)
+        {
+            if (!lane.Empty())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t TaskQueue::Size() const
+    {
+        size_t size = 0;
+        for (const auto &lane : lanes_)
+        {
+            size += lane.Size();
+        }
+        return size;
+    }
+
+    size_t TaskQueue::Size(TaskPriority priority) const
+    {
+        return lanes_[static_cast<size_t>(priority)].Size();
+    }
+
+} // namespace media_notification_service
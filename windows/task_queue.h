@@ -0,0 +1,49 @@
+#ifndef TASK_QUEUE_H_
+#define TASK_QUEUE_H_
+
+#include "inplace_task.h"
+#include "mpsc_queue.h"
+
+#include <array>
+#include <cstddef>
+
+namespace media_notification_service
+{
+    using Task = InplaceTask;
+
+    // Lanes are drained strictly in declaration order, so a Control task
+    // always runs before anything waiting in a lower lane.
+    enum class TaskPriority
+    {
+        Control,    // transport commands, listener setup and teardown
+        Position,   // position ticks
+        Metadata,   // media property refreshes
+        Background, // slow work that must not delay the lanes above
+    };
+
+    constexpr size_t kTaskPriorityCount = 4;
+
+    // Push is safe from any thread; TryPop and Empty belong to the single
+    // consumer.
+    class TaskQueue
+    {
+    public:
+        void Push(Task task, TaskPriority priority);
+        bool TryPop(Task &task);
+        bool TryPop(Task &task, TaskPriority priority);
+
+        // Discards everything queued in |priority|; returns how many tasks
+        // were dropped.
+        size_t Clear(TaskPriority priority);
+
+        bool Empty() const;
+        size_t Size() const;
+        size_t Size(TaskPriority priority) const;
+
+    private:
+        std::array<MpscQueue<Task>, kTaskPriorityCount> lanes_;
+    };
+
+} // namespace media_notification_service
+
+#endif // TASK_QUEUE_H_
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "album_art_cache.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      AlbumArtKey Track(const std::string &title, const std::string &app = "Spotify.exe")
+      {
+        return AlbumArtKey{app, title, "Artist", "Album", ""};
+      }
+
+      std::vector<uint8_t> Art(size_t size, uint8_t fill)
+      {
+        return std::vector<uint8_t>(size, fill);
+      }
+
+    } // namespace
+
+    TEST(AlbumArtCache, HitReturnsTheArtAndCountsBytesSaved)
+    {
+      AlbumArtCache cache(1024);
+      std::vector<uint8_t> bytes;
+
+      EXPECT_FALSE(cache.Lookup(Track("One"), bytes));
+      cache.Insert(Track("One"), Art(100, 1));
+
+      // Play/pause and getCurrentMedia on the same track.
+      EXPECT_TRUE(cache.Lookup(Track("One"), bytes));
+      EXPECT_TRUE(cache.Lookup(Track("One"), bytes));
+      EXPECT_EQ(bytes, Art(100, 1));
+
+      EXPECT_EQ(cache.HitCount(), 2u);
+      EXPECT_EQ(cache.MissCount(), 1u);
+      EXPECT_EQ(cache.BytesSaved(), 200u);
+    }
+
+    TEST(AlbumArtCache, KeyCoversAppAndTrack)
+    {
+      AlbumArtCache cache(1024);
+      std::vector<uint8_t> bytes;
+      cache.Insert(Track("One"), Art(10, 1));
+
+      EXPECT_FALSE(cache.Lookup(Track("Two"), bytes));
+      EXPECT_FALSE(cache.Lookup(Track("One", "Chrome"), bytes));
+      EXPECT_FALSE(cache.Lookup(AlbumArtKey{"Spotify.exe", "OneArtist", "", "Album", ""}, bytes));
+    }
+
+    TEST(AlbumArtCache, VariantsAreCachedBesideTheOriginal)
+    {
+      AlbumArtCache cache(1024);
+      std::vector<uint8_t> bytes;
+      AlbumArtKey small = Track("One");
+      small.variant = "256/jpeg";
+
+      cache.Insert(Track("One"), Art(100, 1));
+      EXPECT_FALSE(cache.Lookup(small, bytes));
+
+      cache.Insert(small, Art(10, 2));
+      EXPECT_TRUE(cache.Lookup(small, bytes));
+      EXPECT_EQ(bytes, Art(10, 2));
+      EXPECT_TRUE(cache.Lookup(Track("One"), bytes));
+      EXPECT_EQ(bytes, Art(100, 1));
+    }
+
+    TEST(AlbumArtCache, EvictsLeastRecentlyUsedPastBudget)
+    {
+      AlbumArtCache cache(300);
+      std::vector<uint8_t> bytes;
+      cache.Insert(Track("One"), Art(100, 1));
+      cache.Insert(Track("Two"), Art(100, 2));
+      cache.Insert(Track("Three"), Art(100, 3));
+
+      // Touch One so Two is now the oldest.
+      EXPECT_TRUE(cache.Lookup(Track("One"), bytes));
+      cache.Insert(Track("Four"), Art(100, 4));
+
+      EXPECT_FALSE(cache.Lookup(Track("Two"), bytes));
+      EXPECT_TRUE(cache.Lookup(Track("One"), bytes));
+      EXPECT_TRUE(cache.Lookup(Track("Three"), bytes));
+      EXPECT_TRUE(cache.Lookup(Track("Four"), bytes));
+      EXPECT_EQ(cache.SizeBytes(), 300u);
+      EXPECT_EQ(cache.EvictionCount(), 1u);
+    }
+
+    TEST(AlbumArtCache, ReinsertReplacesAndOversizedIsSkipped)
+    {
+      AlbumArtCache cache(300);
+      std::vector<uint8_t> bytes;
+      cache.Insert(Track("One"), Art(100, 1));
+      cache.Insert(Track("One"), Art(50, 9));
+
+      EXPECT_TRUE(cache.Lookup(Track("One"), bytes));
+      EXPECT_EQ(bytes, Art(50, 9));
+      EXPECT_EQ(cache.SizeBytes(), 50u);
+
+      cache.Insert(Track("Huge"), Art(301, 1));
+      EXPECT_FALSE(cache.Lookup(Track("Huge"), bytes));
+      EXPECT_EQ(cache.EntryCount(), 1u);
+    }
+
+  } // namespace test
+} // namespace media_notification_service
@@ -0,0 +1,183 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "art_file_store.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      namespace fs = std::filesystem;
+
+      // A fresh root per test, removed afterwards.
+      class ArtFileStoreTest : public ::testing::Test
+      {
+      protected:
+        void SetUp() override
+        {
+          const auto *info = ::testing::UnitTest::GetInstance()->current_test_info();
+          root_ = fs::temp_directory_path() / (std::string("art_file_store_test_") + info->name());
+          fs::remove_all(root_);
+        }
+
+        void TearDown() override { fs::remove_all(root_); }
+
+        ArtFileStore::Options Small(size_t segment_bytes = 1024, size_t max_segments = 2)
+        {
+          return ArtFileStore::Options{root_, segment_bytes, max_segments};
+        }
+
+        fs::path root_;
+      };
+
+      fs::path FromUtf8(const std::string &path)
+      {
+        return fs::path(std::u8string(path.begin(), path.end()));
+      }
+
+      std::vector<uint8_t> Image(size_t size, uint8_t seed)
+      {
+        std::vector<uint8_t> bytes(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+          bytes[i] = static_cast<uint8_t>(seed + i * 31);
+        }
+        return bytes;
+      }
+
+      // What the Dart side does with a ref.
+      std::vector<uint8_t> ReadRef(const ArtFileRef &ref)
+      {
+        std::ifstream file(FromUtf8(ref.path), std::ios::binary);
+        if (!file)
+        {
+          return {};
+        }
+        std::vector<uint8_t> bytes(ref.length);
+        file.seekg(static_cast<std::streamoff>(ref.offset));
+        file.read(reinterpret_cast<char *>(bytes.data()), ref.length);
+        return file ? bytes : std::vector<uint8_t>{};
+      }
+
+    } // namespace
+
+    TEST_F(ArtFileStoreTest, RefReadsBackTheBytes)
+    {
+      ArtFileStore store(Small());
+      ASSERT_TRUE(store.Open());
+
+      auto first = store.Put(Image(300, 1));
+      auto second = store.Put(Image(200, 2));
+      ASSERT_TRUE(first && second);
+
+      // Packed into one segment.
+      EXPECT_EQ(first->path, second->path);
+      EXPECT_EQ(second->offset, 300u);
+      EXPECT_EQ(ReadRef(*first), Image(300, 1));
+      EXPECT_EQ(ReadRef(*second), Image(200, 2));
+      EXPECT_EQ(first->hash, ArtFileStore::Hash(Image(300, 1).data(), 300));
+    }
+
+    TEST_F(ArtFileStoreTest, SameImageIsWrittenOnce)
+    {
+      ArtFileStore store(Small());
+      ASSERT_TRUE(store.Open());
+
+      auto first = store.Put(Image(300, 1));
+      auto again = store.Put(Image(300, 1));
+      ASSERT_TRUE(first && again);
+
+      EXPECT_EQ(*first, *again);
+      EXPECT_EQ(store.PutCount(), 2u);
+      EXPECT_EQ(store.DedupCount(), 1u);
+      EXPECT_EQ(store.BytesWritten(), 300u);
+    }
+
+    TEST_F(ArtFileStoreTest, EvictsTheOldestSegment)
+    {
+      ArtFileStore store(Small(1024, 2));
+      ASSERT_TRUE(store.Open());
+
+      auto one = store.Put(Image(1000, 1));
+      auto two = store.Put(Image(1000, 2));
+      auto three = store.Put(Image(1000, 3));
+      ASSERT_TRUE(one && two && three);
+
+      EXPECT_EQ(store.EvictedSegmentCount(), 1u);
+      EXPECT_FALSE(fs::exists(FromUtf8(one->path)));
+      EXPECT_EQ(ReadRef(*two), Image(1000, 2));
+      EXPECT_EQ(ReadRef(*three), Image(1000, 3));
+
+      // Gone from the index too: written again, to a new file.
+      auto one_again = store.Put(Image(1000, 1));
+      ASSERT_TRUE(one_again);
+      EXPECT_NE(one_again->path, one->path);
+      EXPECT_EQ(ReadRef(*one_again), Image(1000, 1));
+      EXPECT_EQ(store.DedupCount(), 0u);
+    }
+
+    TEST_F(ArtFileStoreTest, OversizedImageGetsItsOwnSegment)
+    {
+      ArtFileStore store(Small(1024, 2));
+      ASSERT_TRUE(store.Open());
+
+      auto large = store.Put(Image(5000, 1));
+      ASSERT_TRUE(large);
+      EXPECT_EQ(large->offset, 0u);
+      EXPECT_EQ(ReadRef(*large), Image(5000, 1));
+    }
+
+    TEST_F(ArtFileStoreTest, CleansUpAfterACrashedInstance)
+    {
+      // What a crashed process leaves behind: segments and an unheld lock.
+      fs::path crashed = root_ / "art-999999-0";
+      fs::create_directories(crashed);
+      std::ofstream(crashed / "0.seg") << "stale";
+      std::ofstream(crashed / "lock");
+
+      ArtFileStore live(Small());
+      ASSERT_TRUE(live.Open());
+      ASSERT_TRUE(live.Put(Image(100, 1)));
+
+      ArtFileStore store(Small());
+      ASSERT_TRUE(store.Open());
+
+      EXPECT_FALSE(fs::exists(crashed));
+      EXPECT_EQ(live.StaleDirectoryCount(), 1u);
+      // A live instance's directory is left alone.
+      EXPECT_EQ(store.StaleDirectoryCount(), 0u);
+      EXPECT_TRUE(fs::exists(live.Directory()));
+    }
+
+    TEST_F(ArtFileStoreTest, RemovesItsDirectoryWhenDestroyed)
+    {
+      fs::path directory;
+      {
+        ArtFileStore store(Small());
+        ASSERT_TRUE(store.Open());
+        ASSERT_TRUE(store.Put(Image(100, 1)));
+        directory = store.Directory();
+        EXPECT_TRUE(fs::exists(directory));
+      }
+      EXPECT_FALSE(fs::exists(directory));
+    }
+
+    TEST(ArtFileStore, PutFailsWhenNotOpen)
+    {
+      ArtFileStore store(ArtFileStore::Options{});
+      EXPECT_FALSE(store.IsOpen());
+      EXPECT_FALSE(store.Put(std::vector<uint8_t>(10, 1)));
+    }
+
+  } // namespace test
+} // namespace media_notification_service
@@ -0,0 +1,388 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "co_task.h"
+#include "worker_thread.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      using namespace std::chrono_literals;
+
+      enum class FakeStatus
+      {
+        Started,
+        Completed,
+        Canceled,
+        Error,
+      };
+
+      // Mimics the Status/Completed/Cancel surface of a WinRT async
+      // operation. Copies share state, like WinRT projections do.
+      class FakeOperation
+      {
+      public:
+        using Handler = std::function<void(const FakeOperation &, FakeStatus)>;
+
+        FakeOperation() : state_(std::make_shared<State>()) {}
+
+        FakeStatus Status() const
+        {
+          std::lock_guard<std::mutex> lock(state_->mutex);
+          return state_->status;
+        }
+
+        void Completed(Handler handler) const
+        {
+          FakeStatus status;
+          {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            status = state_->status;
+            if (status == FakeStatus::Started)
+            {
+              state_->handler = std::move(handler);
+              return;
+            }
+          }
+          handler(*this, status);
+        }
+
+        void Cancel() const
+        {
+          Finish(FakeStatus::Canceled);
+        }
+
+        void Complete(int result) const
+        {
+          state_->result = result;
+          Finish(FakeStatus::Completed);
+        }
+
+        int GetResults() const
+        {
+          return state_->result;
+        }
+
+        bool WasCancelled() const
+        {
+          return Status() == FakeStatus::Canceled;
+        }
+
+      private:
+        struct State
+        {
+          std::mutex mutex;
+          FakeStatus status = FakeStatus::Started;
+          Handler handler;
+          int result = 0;
+        };
+
+        void Finish(FakeStatus status) const
+        {
+          Handler handler;
+          {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            if (state_->status != FakeStatus::Started)
+            {
+              return;
+            }
+            state_->status = status;
+            handler = std::move(state_->handler);
+          }
+          if (handler)
+          {
+            handler(*this, status);
+          }
+        }
+
+        std::shared_ptr<State> state_;
+      };
+
+      // Queues tasks until the test runs them.
+      class ManualExecutor : public Executor
+      {
+      public:
+        void Post(InplaceTask task) override
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          tasks_.push_back(std::move(task));
+        }
+
+        size_t RunAll()
+        {
+          size_t ran = 0;
+          for (;;)
+          {
+            InplaceTask task;
+            {
+              std::lock_guard<std::mutex> lock(mutex_);
+              if (tasks_.empty())
+              {
+                return ran;
+              }
+              task = std::move(tasks_.front());
+              tasks_.pop_front();
+            }
+            task();
+            ++ran;
+          }
+        }
+
+      private:
+        std::mutex mutex_;
+        std::deque<InplaceTask> tasks_;
+      };
+
+      // Holds armed timeouts until the test fires them.
+      class ManualTimer : public Timer
+      {
+      public:
+        void PostAfter(std::chrono::milliseconds delay, InplaceTask task) override
+        {
+          delays.push_back(delay);
+          tasks_.push_back(std::move(task));
+        }
+
+        void FireAll()
+        {
+          for (auto &task : tasks_)
+          {
+            task();
+          }
+          tasks_.clear();
+        }
+
+        std::vector<std::chrono::milliseconds> delays;
+
+      private:
+        std::vector<InplaceTask> tasks_;
+      };
+
+      CoTask<int> Add(int a, int b)
+      {
+        co_return a + b;
+      }
+
+      CoTask<int> SumOfSums(int *steps)
+      {
+        int first = co_await Add(1, 2);
+        ++*steps;
+        int second = co_await Add(3, 4);
+        ++*steps;
+        co_return first + second;
+      }
+
+      CoTask<CallResult> Await(FakeOperation operation, std::shared_ptr<Executor> executor, Timer &timer,
+                               std::chrono::milliseconds timeout)
+      {
+        co_return co_await AwaitOperation(operation, executor, timer, timeout);
+      }
+
+      CoTask<std::thread::id> ThreadAfterHop(Executor &executor)
+      {
+        co_await ScheduleOn(executor);
+        co_return std::this_thread::get_id();
+      }
+
+    } // namespace
+
+    TEST(CoTask, IsLazyAndChainsResults)
+    {
+      int steps = 0;
+      int result = 0;
+      auto task = SumOfSums(&steps);
+      EXPECT_EQ(steps, 0);
+
+      Spawn(std::move(task), [&result](int value)
+            { result = value; });
+
+      EXPECT_EQ(steps, 2);
+      EXPECT_EQ(result, 10);
+    }
+
+    TEST(CoTask, DestroyingAnUnstartedTaskDoesNotRunIt)
+    {
+      int steps = 0;
+      {
+        auto task = SumOfSums(&steps);
+      }
+      EXPECT_EQ(steps, 0);
+    }
+
+    TEST(CoTask, ScheduleOnResumesOnTheExecutor)
+    {
+      WorkerThread worker;
+      std::promise<std::thread::id> worker_id;
+      worker.EnqueueTask([&worker_id]
+                         { worker_id.set_value(std::this_thread::get_id()); });
+
+      std::promise<std::thread::id> resumed_on;
+      Spawn(ThreadAfterHop(*worker.LaneExecutor(TaskPriority::Metadata)),
+            [&resumed_on](std::thread::id id)
+            { resumed_on.set_value(id); });
+
+      EXPECT_EQ(resumed_on.get_future().get(), worker_id.get_future().get());
+      worker.Stop();
+    }
+
+    TEST(CoTask, CompletedOperationDoesNotSuspendOrArmATimeout)
+    {
+      auto executor = std::make_shared<ManualExecutor>();
+      ManualTimer timer;
+      FakeOperation operation;
+      operation.Complete(7);
+
+      std::optional<CallResult> result;
+      Spawn(Await(operation, executor, timer, 100ms), [&result](CallResult value)
+            { result = value; });
+
+      ASSERT_TRUE(result.has_value());
+      EXPECT_EQ(*result, CallResult::Success);
+      EXPECT_TRUE(timer.delays.empty());
+      EXPECT_EQ(executor->RunAll(), 0u);
+    }
+
+    TEST(CoTask, OperationResumesOnExecutorAfterCompletion)
+    {
+      auto executor = std::make_shared<ManualExecutor>();
+      ManualTimer timer;
+      FakeOperation operation;
+
+      std::optional<CallResult> result;
+      Spawn(Await(operation, executor, timer, 250ms), [&result](CallResult value)
+            { result = value; });
+
+      ASSERT_EQ(timer.delays.size(), 1u);
+      EXPECT_EQ(timer.delays[0], 250ms);
+      EXPECT_FALSE(result.has_value());
+
+      operation.Complete(7);
+      // Completion only posts the resumption; nothing runs inline.
+      EXPECT_FALSE(result.has_value());
+
+      EXPECT_EQ(executor->RunAll(), 1u);
+      ASSERT_TRUE(result.has_value());
+      EXPECT_EQ(*result, CallResult::Success);
+
+      // A late timeout must not cancel or re-resume a finished operation.
+      timer.FireAll();
+      EXPECT_FALSE(operation.WasCancelled());
+      EXPECT_EQ(executor->RunAll(), 0u);
+    }
+
+    TEST(CoTask, HungOperationIsCancelledWhenTheTimeoutFires)
+    {
+      auto executor = std::make_shared<ManualExecutor>();
+      ManualTimer timer;
+      FakeOperation operation;
+
+      std::optional<CallResult> result;
+      Spawn(Await(operation, executor, timer, 50ms), [&result](CallResult value)
+            { result = value; });
+
+      timer.FireAll();
+      EXPECT_TRUE(operation.WasCancelled());
+
+      EXPECT_EQ(executor->RunAll(), 1u);
+      ASSERT_TRUE(result.has_value());
+      EXPECT_EQ(*result, CallResult::Timeout);
+    }
+
+    TEST(CoTask, CancelledOperationWithoutTimeoutIsAFailure)
+    {
+      auto executor = std::make_shared<ManualExecutor>();
+      ManualTimer timer;
+      FakeOperation operation;
+
+      std::optional<CallResult> result;
+      Spawn(Await(operation, executor, timer, 50ms), [&result](CallResult value)
+            { result = value; });
+
+      operation.Cancel();
+      executor->RunAll();
+      ASSERT_TRUE(result.has_value());
+      EXPECT_EQ(*result, CallResult::Failure);
+    }
+
+    // A seek issued while a property fetch is outstanding completes first, on
+    // the same worker thread, without waiting for the fetch.
+    TEST(CoTask, OperationsOverlapOnTheWorker)
+    {
+      ManualTimer timer;
+      FakeOperation fetch;
+      FakeOperation seek;
+      std::promise<void> seek_done;
+      std::promise<void> fetch_done;
+      std::vector<std::string> order;
+      std::thread::id fetch_thread;
+      std::thread::id seek_thread;
+
+      WorkerThread worker;
+      auto metadata = worker.LaneExecutor(TaskPriority::Metadata);
+      auto control = worker.LaneExecutor(TaskPriority::Control);
+
+      worker.EnqueueTask([&]
+                         { Spawn(Await(fetch, metadata, timer, 3000ms), [&](CallResult)
+                                 {
+                                   fetch_thread = std::this_thread::get_id();
+                                   order.push_back("fetch");
+                                   fetch_done.set_value(); }); });
+      worker.EnqueueTask([&]
+                         { Spawn(Await(seek, control, timer, 3000ms), [&](CallResult)
+                                 {
+                                   seek_thread = std::this_thread::get_id();
+                                   order.push_back("seek");
+                                   seek_done.set_value(); }); },
+                         TaskPriority::Control);
+
+      seek.Complete(1);
+      seek_done.get_future().wait();
+      fetch.Complete(2);
+      fetch_done.get_future().wait();
+
+      worker.Stop();
+      ASSERT_EQ(order.size(), 2u);
+      EXPECT_EQ(order[0], "seek");
+      EXPECT_EQ(order[1], "fetch");
+      EXPECT_EQ(fetch_thread, seek_thread);
+      EXPECT_NE(fetch_thread, std::this_thread::get_id());
+      EXPECT_FALSE(fetch.WasCancelled());
+    }
+
+    TEST(CoTask, CompletionAfterTheWorkerIsGoneIsHarmless)
+    {
+      ManualTimer timer;
+      FakeOperation operation;
+      bool resumed = false;
+      {
+        WorkerThread worker;
+        Spawn(Await(operation, worker.LaneExecutor(TaskPriority::Metadata), timer, 50ms),
+              [&resumed](CallResult)
+              { resumed = true; });
+        worker.Stop();
+      }
+
+      // The frame is never resumed (and so leaks), but posting into the
+      // stopped worker must not touch freed memory.
+      operation.Complete(1);
+      EXPECT_FALSE(resumed);
+    }
+
+  } // namespace test
+} // namespace media_notification_service
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "deadline.h"
+#include "worker_thread.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      using namespace std::chrono_literals;
+
+      enum class FakeStatus
+      {
+        Started,
+        Completed,
+        Canceled,
+        Error,
+      };
+
+      // Mimics the wait_for/Cancel surface of a WinRT async operation.
+      class FakeOperation
+      {
+      public:
+        explicit FakeOperation(bool completes) : completes_(completes) {}
+
+        template <typename Duration>
+        FakeStatus wait_for(Duration timeout) const
+        {
+          ++waits;
+          if (completes_)
+          {
+            return FakeStatus::Completed;
+          }
+          std::this_thread::sleep_for(timeout);
+          return canceled ? FakeStatus::Canceled : FakeStatus::Started;
+        }
+
+        void Cancel() const
+        {
+          canceled = true;
+        }
+
+        mutable std::atomic<int> waits{0};
+        mutable std::atomic<bool> canceled{false};
+
+      private:
+        bool completes_;
+      };
+
+    } // namespace
+
+    TEST(Deadline, CompletedOperationIsNotCancelled)
+    {
+      FakeOperation operation(true);
+      EXPECT_TRUE(WaitForOperation(operation, Deadline(100ms)));
+      EXPECT_FALSE(operation.canceled);
+    }
+
+    TEST(Deadline, HungOperationTimesOutAndIsCancelled)
+    {
+      FakeOperation operation(false);
+
+      auto start = std::chrono::steady_clock::now();
+      EXPECT_FALSE(WaitForOperation(operation, Deadline(50ms)));
+      auto elapsed = std::chrono::steady_clock::now() - start;
+
+      EXPECT_TRUE(operation.canceled);
+      EXPECT_GE(elapsed, 50ms);
+      EXPECT_LT(elapsed, 1s);
+    }
+
+    TEST(Deadline, SharedDeadlineCoversSuccessiveSteps)
+    {
+      // The art read opens the stream and then reads it under one deadline.
+      Deadline deadline(60ms);
+      FakeOperation open(false);
+      EXPECT_FALSE(WaitForOperation(open, deadline));
+      EXPECT_TRUE(deadline.Expired());
+      EXPECT_EQ(deadline.Remaining(), 0ms);
+
+      FakeOperation read(false);
+      auto start = std::chrono::steady_clock::now();
+      EXPECT_FALSE(WaitForOperation(read, deadline));
+      EXPECT_LT(std::chrono::steady_clock::now() - start, 50ms);
+    }
+
+    TEST(Deadline, TableFallsBackToDefault)
+    {
+      DeadlineTable table(3000ms);
+      table.Set("seekTo", 250ms);
+
+      EXPECT_EQ(table.Get("seekTo"), 250ms);
+      EXPECT_EQ(table.Get("playPause"), 3000ms);
+    }
+
+    TEST(Deadline, HungCallDoesNotWedgeTheWorker)
+    {
+      WorkerThread worker;
+      FakeOperation hung(false);
+      std::promise<CallResult> first;
+      std::promise<CallResult> second;
+
+      worker.EnqueueTask([&]()
+                         { first.set_value(WaitForOperation(hung, Deadline(50ms)) ? CallResult::Success : CallResult::Timeout); },
+                         TaskPriority::Control);
+      worker.EnqueueTask([&]()
+                         { second.set_value(CallResult::Success); },
+                         TaskPriority::Control);
+
+      auto second_future = second.get_future();
+      ASSERT_EQ(second_future.wait_for(2s), std::future_status::ready);
+      EXPECT_EQ(first.get_future().get(), CallResult::Timeout);
+      EXPECT_EQ(second_future.get(), CallResult::Success);
+      EXPECT_TRUE(hung.canceled);
+    }
+
+  } // namespace test
+} // namespace media_notification_service
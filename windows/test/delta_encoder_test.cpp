@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "delta_encoder.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      // The shape of the media map, without Flutter.
+      using Value = std::variant<bool, std::string, std::vector<uint8_t>>;
+      using MediaMap = std::map<std::string, Value>;
+      using Encoder = DeltaEncoder<MediaMap>;
+
+      MediaMap Track(const std::string &title, bool playing)
+      {
+        return {
+            {"title", title},
+            {"artist", std::string("Artist")},
+            {"album", std::string("Album")},
+            {"state", std::string(playing ? "playing" : "paused")},
+            {"isPlaying", playing},
+            {"albumArt", std::vector<uint8_t>(40 * 1024, 0x42)},
+            {"songChanged", false},
+        };
+      }
+
+      // Roughly what the standard codec writes: key, type tag, payload.
+      size_t EncodedSize(const Encoder::Delta &delta)
+      {
+        size_t size = 16;
+        for (const auto &[key, value] : delta.set)
+        {
+          size += key.size() + 2;
+          if (const auto *text = std::get_if<std::string>(&value))
+          {
+            size += text->size() + 1;
+          }
+          else if (const auto *bytes = std::get_if<std::vector<uint8_t>>(&value))
+          {
+            size += bytes->size() + 4;
+          }
+        }
+        for (const auto &key : delta.removed)
+        {
+          size += key.size() + 2;
+        }
+        return size;
+      }
+
+    } // namespace
+
+    TEST(DeltaEncoder, FirstEventIsAKeyframe)
+    {
+      Encoder encoder(20, {"songChanged"});
+      auto delta = encoder.Encode(Track("One", true));
+
+      EXPECT_EQ(delta.sequence, 1u);
+      EXPECT_TRUE(delta.keyframe);
+      EXPECT_EQ(delta.set.size(), 7u);
+    }
+
+    TEST(DeltaEncoder, PlayPauseSendsTensOfBytes)
+    {
+      Encoder encoder(20, {"songChanged"});
+      auto keyframe = encoder.Encode(Track("One", true));
+      auto toggle = encoder.Encode(Track("One", false));
+
+      EXPECT_FALSE(toggle.keyframe);
+      EXPECT_EQ(toggle.sequence, 2u);
+      // The transient flag rides along with what actually changed.
+      EXPECT_EQ(toggle.set, (MediaMap{{"state", std::string("paused")}, {"isPlaying", false}, {"songChanged", false}}));
+      EXPECT_TRUE(toggle.removed.empty());
+
+      EXPECT_GT(EncodedSize(keyframe), 40u * 1024);
+      EXPECT_LT(EncodedSize(toggle), 100u);
+    }
+
+    TEST(DeltaEncoder, RemovedKeysAreListed)
+    {
+      Encoder encoder(20, {"songChanged"});
+      encoder.Encode(Track("One", true));
+
+      auto no_art = Track("Two", true);
+      no_art.erase("albumArt");
+      auto delta = encoder.Encode(no_art);
+
+      EXPECT_EQ(delta.set.count("title"), 1u);
+      EXPECT_EQ(delta.removed, (std::vector<std::string>{"albumArt"}));
+    }
+
+    TEST(DeltaEncoder, KeyframesRecurAndCanBeRequested)
+    {
+      Encoder encoder(4, {"songChanged"});
+      std::vector<uint64_t> keyframes;
+      for (int i = 0; i < 9; ++i)
+      {
+        if (encoder.Encode(Track("One", i % 2 == 0)).keyframe)
+        {
+          keyframes.push_back(static_cast<uint64_t>(i + 1));
+        }
+      }
+      EXPECT_EQ(keyframes, (std::vector<uint64_t>{1, 5, 9}));
+
+      encoder.RequestKeyframe();
+      EXPECT_TRUE(encoder.Encode(Track("One", true)).keyframe);
+      EXPECT_FALSE(encoder.Encode(Track("One", true)).keyframe);
+      EXPECT_EQ(encoder.KeyframeCount(), 4u);
+    }
+
+    TEST(DeltaEncoder, ReceiverRebuildsTheFullMap)
+    {
+      Encoder encoder(20, {"songChanged"});
+      MediaMap received;
+
+      std::vector<MediaMap> sent = {Track("One", true), Track("One", false), Track("Two", true)};
+      sent[2].erase("album");
+      for (const auto &map : sent)
+      {
+        auto delta = encoder.Encode(map);
+        if (delta.keyframe)
+        {
+          received.clear();
+        }
+        for (const auto &[key, value] : delta.set)
+        {
+          received[key] = value;
+        }
+        for (const auto &key : delta.removed)
+        {
+          received.erase(key);
+        }
+        EXPECT_EQ(received, map);
+      }
+    }
+
+  } // namespace test
+} // namespace media_notification_service
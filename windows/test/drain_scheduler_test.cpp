@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "drain_scheduler.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      // Counts wake-ups; stands in for PostMessage.
+      class CountingWake : public WakeSignal
+      {
+      public:
+        bool Wake() override
+        {
+          ++wakes;
+          return deliver;
+        }
+
+        std::atomic<int> wakes{0};
+        std::atomic<bool> deliver{true};
+      };
+
+      // A consumer thread that drains a shared queue whenever it is woken,
+      // the way the message window drains a StreamController.
+      class FakeMessageLoop : public WakeSignal
+      {
+      public:
+        FakeMessageLoop() : thread_([this]()
+                                    { Run(); }) {}
+
+        ~FakeMessageLoop()
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            quit_ = true;
+          }
+          cv_.notify_one();
+          thread_.join();
+        }
+
+        void Attach(DrainScheduler *scheduler) { scheduler_ = scheduler; }
+
+        bool Wake() override
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++posted_;
+          }
+          cv_.notify_one();
+          return true;
+        }
+
+        void Push(int value)
+        {
+          std::lock_guard<std::mutex> lock(queue_mutex_);
+          queue_.push_back(value);
+        }
+
+        std::vector<int> Delivered()
+        {
+          std::lock_guard<std::mutex> lock(queue_mutex_);
+          return delivered_;
+        }
+
+      private:
+        void Run()
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          while (true)
+          {
+            cv_.wait(lock, [this]()
+                     { return posted_ > 0 || quit_; });
+            if (posted_ == 0)
+            {
+              return;
+            }
+            --posted_;
+            lock.unlock();
+
+            scheduler_.load()->BeginDrain();
+            {
+              std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+              while (!queue_.empty())
+              {
+                delivered_.push_back(queue_.front());
+                queue_.pop_front();
+              }
+            }
+
+            lock.lock();
+          }
+        }
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        int posted_ = 0;
+        bool quit_ = false;
+        std::atomic<DrainScheduler *> scheduler_{nullptr};
+
+        std::mutex queue_mutex_;
+        std::deque<int> queue_;
+        std::vector<int> delivered_;
+
+        std::thread thread_;
+      };
+
+    } // namespace
+
+    TEST(DrainScheduler, BurstPostsOneWake)
+    {
+      CountingWake wake;
+      DrainScheduler scheduler(wake);
+
+      EXPECT_TRUE(scheduler.Schedule());
+      for (int i = 0; i < 99; ++i)
+      {
+        EXPECT_FALSE(scheduler.Schedule());
+      }
+
+      EXPECT_EQ(wake.wakes, 1);
+      EXPECT_EQ(scheduler.WakeCount(), 1u);
+      EXPECT_EQ(scheduler.SavedWakeCount(), 99u);
+    }
+
+    TEST(DrainScheduler, NextItemAfterDrainWakesAgain)
+    {
+      CountingWake wake;
+      DrainScheduler scheduler(wake);
+
+      scheduler.Schedule();
+      scheduler.BeginDrain();
+      EXPECT_TRUE(scheduler.Schedule());
+      EXPECT_EQ(wake.wakes, 2);
+    }
+
+    TEST(DrainScheduler, FailedWakeIsRetried)
+    {
+      CountingWake wake;
+      DrainScheduler scheduler(wake);
+
+      wake.deliver = false;
+      EXPECT_FALSE(scheduler.Schedule());
+      wake.deliver = true;
+      EXPECT_TRUE(scheduler.Schedule());
+
+      EXPECT_EQ(wake.wakes, 2);
+      EXPECT_EQ(scheduler.WakeCount(), 1u);
+      EXPECT_EQ(scheduler.SavedWakeCount(), 0u);
+    }
+
+    TEST(DrainScheduler, ConcurrentProducersLoseNothing)
+    {
+      constexpr int kProducers = 4;
+      constexpr int kPerProducer = 5000;
+
+      FakeMessageLoop loop;
+      DrainScheduler scheduler(loop);
+      loop.Attach(&scheduler);
+
+      std::vector<std::thread> producers;
+      for (int p = 0; p < kProducers; ++p)
+      {
+        producers.emplace_back([&, p]()
+                               {
+                                 for (int i = 0; i < kPerProducer; ++i)
+                                 {
+                                   loop.Push(p * kPerProducer + i);
+                                   scheduler.Schedule();
+                                 } });
+      }
+      for (auto &producer : producers)
+      {
+        producer.join();
+      }
+
+      // Every item is behind some wake-up, so the loop gets to all of them.
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+      while (loop.Delivered().size() < kProducers * kPerProducer &&
+             std::chrono::steady_clock::now() < deadline)
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+
+      EXPECT_EQ(loop.Delivered().size(), static_cast<size_t>(kProducers * kPerProducer));
+      EXPECT_EQ(scheduler.WakeCount() + scheduler.SavedWakeCount(),
+                static_cast<uint64_t>(kProducers * kPerProducer));
+      EXPECT_LT(scheduler.WakeCount(), static_cast<uint64_t>(kProducers * kPerProducer));
+    }
+
+  } // namespace test
+} // namespace media_notification_service
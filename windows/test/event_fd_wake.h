@@ -0,0 +1,53 @@
+#ifndef TEST_EVENT_FD_WAKE_H_
+#define TEST_EVENT_FD_WAKE_H_
+
+#if defined(__linux__)
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cstdint>
+
+#include "wake_signal.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    // The Linux stand-in for the plugin's message window: Wake bumps an
+    // eventfd that a fake platform thread polls.
+    class EventFdWake : public WakeSignal
+    {
+    public:
+      EventFdWake() : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+      ~EventFdWake() { close(fd_); }
+
+      EventFdWake(const EventFdWake &) = delete;
+      EventFdWake &operator=(const EventFdWake &) = delete;
+
+      bool Wake() override
+      {
+        uint64_t one = 1;
+        return write(fd_, &one, sizeof(one)) == static_cast<ssize_t>(sizeof(one));
+      }
+
+      // Clears the eventfd; returns how many wake-ups it had collected.
+      uint64_t Consume()
+      {
+        uint64_t count = 0;
+        return read(fd_, &count, sizeof(count)) == static_cast<ssize_t>(sizeof(count)) ? count : 0;
+      }
+
+      int fd() const { return fd_; }
+
+    private:
+      int fd_;
+    };
+
+  } // namespace test
+} // namespace media_notification_service
+
+#endif // defined(__linux__)
+
+#endif // TEST_EVENT_FD_WAKE_H_
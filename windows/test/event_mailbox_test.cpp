@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "event_mailbox.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      using namespace std::chrono_literals;
+
+      // An event carrying a payload, counting how many are alive so a test can
+      // see what the mailbox holds on to.
+      class TrackedEvent
+      {
+      public:
+        TrackedEvent() = default;
+        explicit TrackedEvent(int id) : id_(id), payload_(4096)
+        {
+          ++live;
+        }
+        // Moves hand the payload over, so they leave the count alone.
+        TrackedEvent(TrackedEvent &&other) noexcept
+            : id_(other.id_), payload_(std::move(other.payload_))
+        {
+          other.payload_.clear();
+        }
+        TrackedEvent &operator=(TrackedEvent &&other) noexcept
+        {
+          if (!payload_.empty())
+          {
+            --live;
+          }
+          id_ = other.id_;
+          payload_ = std::move(other.payload_);
+          other.payload_.clear();
+          return *this;
+        }
+        ~TrackedEvent()
+        {
+          if (!payload_.empty())
+          {
+            --live;
+          }
+        }
+
+        int id() const { return id_; }
+
+        static std::atomic<int> live;
+
+      private:
+        int id_ = -1;
+        std::vector<char> payload_;
+      };
+
+      std::atomic<int> TrackedEvent::live{0};
+
+      std::vector<int> DrainIds(EventMailbox<int> &mailbox)
+      {
+        std::vector<int> ids;
+        int id;
+        while (mailbox.TryPop(id))
+        {
+          ids.push_back(id);
+        }
+        return ids;
+      }
+
+    } // namespace
+
+    TEST(EventMailbox, QueueKeepsEverything)
+    {
+      EventMailbox<int> mailbox;
+      for (int i = 0; i < 5; ++i)
+      {
+        EXPECT_TRUE(mailbox.Push(i));
+      }
+      EXPECT_EQ(DrainIds(mailbox), (std::vector<int>{0, 1, 2, 3, 4}));
+      EXPECT_EQ(mailbox.DroppedCount(), 0u);
+    }
+
+    TEST(EventMailbox, LatestOnlyOverwrites)
+    {
+      EventMailbox<int> mailbox(DeliveryPolicy::LatestOnly());
+      EXPECT_TRUE(mailbox.Push(1));
+      EXPECT_FALSE(mailbox.Push(2));
+      EXPECT_FALSE(mailbox.Push(3));
+
+      EXPECT_EQ(DrainIds(mailbox), (std::vector<int>{3}));
+      EXPECT_EQ(mailbox.DroppedCount(), 2u);
+
+      // A drained slot takes the next event without dropping anything.
+      EXPECT_TRUE(mailbox.Push(4));
+      EXPECT_EQ(mailbox.DroppedCount(), 2u);
+    }
+
+    TEST(EventMailbox, BoundedDropsOldest)
+    {
+      EventMailbox<int> mailbox(DeliveryPolicy::Bounded(3));
+      for (int i = 0; i < 6; ++i)
+      {
+        mailbox.Push(i);
+      }
+      EXPECT_EQ(DrainIds(mailbox), (std::vector<int>{3, 4, 5}));
+      EXPECT_EQ(mailbox.DroppedCount(), 3u);
+    }
+
+    TEST(EventMailbox, TighterPolicyTrimsPendingEvents)
+    {
+      EventMailbox<int> mailbox;
+      for (int i = 0; i < 4; ++i)
+      {
+        mailbox.Push(i);
+      }
+      mailbox.SetPolicy(DeliveryPolicy::LatestOnly());
+      EXPECT_EQ(DrainIds(mailbox), (std::vector<int>{3}));
+      EXPECT_EQ(mailbox.DroppedCount(), 3u);
+    }
+
+    TEST(EventMailbox, MemoryStaysFlatWhileConsumerIsStalled)
+    {
+      // A producer sending at ~1 kHz while the consumer is stuck, as during a
+      // window drag; the mutex plays the StreamController's sink lock.
+      struct Case
+      {
+        DeliveryPolicy policy;
+        int max_live;
+      };
+      const Case cases[] = {
+          {DeliveryPolicy::LatestOnly(), 1},
+          {DeliveryPolicy::Bounded(8), 8},
+      };
+
+      for (const auto &c : cases)
+      {
+        EventMailbox<TrackedEvent> mailbox(c.policy);
+        std::mutex mutex;
+        std::atomic<bool> done{false};
+        int peak_live = 0;
+
+        std::thread producer([&]()
+                             {
+                               for (int i = 0; i < 200; ++i)
+                               {
+                                 {
+                                   std::lock_guard<std::mutex> lock(mutex);
+                                   mailbox.Push(TrackedEvent(i));
+                                 }
+                                 std::this_thread::sleep_for(1ms);
+                               }
+                               done = true; });
+
+        while (!done)
+        {
+          peak_live = std::max(peak_live, TrackedEvent::live.load());
+          std::this_thread::sleep_for(1ms);
+        }
+        producer.join();
+        peak_live = std::max(peak_live, TrackedEvent::live.load());
+
+        EXPECT_LE(peak_live, c.max_live + 1);
+        EXPECT_EQ(mailbox.Size(), static_cast<size_t>(c.max_live));
+        EXPECT_EQ(mailbox.DroppedCount(), static_cast<uint64_t>(200 - c.max_live));
+
+        // The consumer wakes up and gets only the newest events.
+        TrackedEvent event;
+        ASSERT_TRUE(mailbox.TryPop(event));
+        EXPECT_EQ(event.id(), 200 - c.max_live);
+      }
+      EXPECT_EQ(TrackedEvent::live, 0);
+    }
+
+    TEST(EventMailbox, QueueGrowsWhileConsumerIsStalled)
+    {
+      EventMailbox<TrackedEvent> mailbox;
+      for (int i = 0; i < 200; ++i)
+      {
+        mailbox.Push(TrackedEvent(i));
+      }
+      EXPECT_EQ(TrackedEvent::live, 200);
+      EXPECT_EQ(mailbox.DroppedCount(), 0u);
+    }
+
+  } // namespace test
+} // namespace media_notification_service
@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_multiplexer.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      EventKey Key(const std::string &source, SessionEvent event)
+      {
+        return EventKey{source, event};
+      }
+
+      // Stands in for WinRT: counts live registrations per key.
+      struct FakePlatform
+      {
+        EventMultiplexer::Attach Attacher()
+        {
+          return [this](const EventKey &key) -> EventMultiplexer::Revoker
+          {
+            if (fail)
+            {
+              return nullptr;
+            }
+            ++registrations[key.source + "/" + std::to_string(static_cast<int>(key.event))];
+            ++attaches;
+            return [this, key]()
+            {
+              --registrations[key.source + "/" + std::to_string(static_cast<int>(key.event))];
+              ++revokes;
+            };
+          };
+        }
+
+        int Registered(const EventKey &key)
+        {
+          return registrations[key.source + "/" + std::to_string(static_cast<int>(key.event))];
+        }
+
+        std::map<std::string, int> registrations;
+        int attaches = 0;
+        int revokes = 0;
+        bool fail = false;
+      };
+
+    } // namespace
+
+    TEST(EventMultiplexer, ConsumersOfOneEventShareOneRegistration)
+    {
+      FakePlatform platform;
+      EventMultiplexer multiplexer(platform.Attacher());
+      auto properties = Key("Spotify.exe", SessionEvent::MediaPropertiesChanged);
+
+      int media = 0;
+      int position = 0;
+      auto media_id = multiplexer.Subscribe(properties, [&]()
+                                            { ++media; });
+      auto position_id = multiplexer.Subscribe(properties, [&]()
+                                               { ++position; });
+      EXPECT_EQ(platform.Registered(properties), 1);
+      EXPECT_EQ(multiplexer.SubscriberCount(properties), 2u);
+
+      multiplexer.Raise(properties);
+      EXPECT_EQ(media, 1);
+      EXPECT_EQ(position, 1);
+      EXPECT_EQ(multiplexer.RaiseCount(), 1u);
+      EXPECT_EQ(multiplexer.DeliveryCount(), 2u);
+
+      multiplexer.Unsubscribe(media_id);
+      EXPECT_EQ(platform.Registered(properties), 1);
+      multiplexer.Raise(properties);
+      EXPECT_EQ(media, 1);
+      EXPECT_EQ(position, 2);
+
+      multiplexer.Unsubscribe(position_id);
+      EXPECT_EQ(platform.Registered(properties), 0);
+      EXPECT_FALSE(multiplexer.IsAttached(properties));
+      multiplexer.Raise(properties);
+      EXPECT_EQ(position, 2);
+      EXPECT_EQ(platform.attaches, 1);
+      EXPECT_EQ(platform.revokes, 1);
+    }
+
+    TEST(EventMultiplexer, KeysAreSeparateBySourceAndEvent)
+    {
+      FakePlatform platform;
+      EventMultiplexer multiplexer(platform.Attacher());
+
+      std::vector<std::string> seen;
+      multiplexer.Subscribe(Key("a", SessionEvent::PlaybackInfoChanged), [&]()
+                            { seen.push_back("a/playback"); });
+      multiplexer.Subscribe(Key("b", SessionEvent::PlaybackInfoChanged), [&]()
+                            { seen.push_back("b/playback"); });
+      multiplexer.Subscribe(Key("a", SessionEvent::MediaPropertiesChanged), [&]()
+                            { seen.push_back("a/properties"); });
+      EXPECT_EQ(multiplexer.AttachedCount(), 3u);
+
+      multiplexer.Raise(Key("a", SessionEvent::PlaybackInfoChanged));
+      multiplexer.Raise(Key("b", SessionEvent::TimelinePropertiesChanged));
+      EXPECT_EQ(seen, (std::vector<std::string>{"a/playback"}));
+    }
+
+    TEST(EventMultiplexer, FailedAttachSubscribesNothing)
+    {
+      FakePlatform platform;
+      EventMultiplexer multiplexer(platform.Attacher());
+      auto sessions = Key("", SessionEvent::SessionsChanged);
+
+      platform.fail = true;
+      EXPECT_EQ(multiplexer.Subscribe(sessions, []() {}), 0u);
+      EXPECT_FALSE(multiplexer.IsAttached(sessions));
+      multiplexer.Unsubscribe(0);
+
+      platform.fail = false;
+      EXPECT_NE(multiplexer.Subscribe(sessions, []() {}), 0u);
+      EXPECT_EQ(platform.Registered(sessions), 1);
+    }
+
+    TEST(EventMultiplexer, CallbackCanMoveItsSubscriptionWhileRaised)
+    {
+      // What CurrentSessionChanged does: drop the old session's events and
+      // take the new one's, from inside the callback.
+      FakePlatform platform;
+      EventMultiplexer multiplexer(platform.Attacher());
+      auto current = Key("", SessionEvent::CurrentSessionChanged);
+      auto old_session = Key("old", SessionEvent::MediaPropertiesChanged);
+      auto new_session = Key("new", SessionEvent::MediaPropertiesChanged);
+
+      EventMultiplexer::SubscriptionId session_id = multiplexer.Subscribe(old_session, []() {});
+      multiplexer.Subscribe(current, [&]()
+                            {
+                              multiplexer.Unsubscribe(session_id);
+                              session_id = multiplexer.Subscribe(new_session, []() {}); });
+
+      multiplexer.Raise(current);
+      EXPECT_EQ(platform.Registered(old_session), 0);
+      EXPECT_EQ(platform.Registered(new_session), 1);
+    }
+
+    TEST(EventMultiplexer, DestructionRevokesEverything)
+    {
+      FakePlatform platform;
+      {
+        EventMultiplexer multiplexer(platform.Attacher());
+        multiplexer.Subscribe(Key("a", SessionEvent::PlaybackInfoChanged), []() {});
+        multiplexer.Subscribe(Key("a", SessionEvent::PlaybackInfoChanged), []() {});
+        multiplexer.Subscribe(Key("", SessionEvent::SessionsChanged), []() {});
+      }
+      EXPECT_EQ(platform.attaches, 2);
+      EXPECT_EQ(platform.revokes, 2);
+    }
+
+    TEST(EventMultiplexer, RaisesFromEventThreadsRaceSubscriptionChanges)
+    {
+      // No FakePlatform: its map is not thread-safe.
+      std::atomic<int> attached{0};
+      EventMultiplexer multiplexer([&](const EventKey &) -> EventMultiplexer::Revoker
+                                   {
+                                     ++attached;
+                                     return [&]()
+                                     { --attached; }; });
+      auto key = Key("a", SessionEvent::PlaybackInfoChanged);
+      std::atomic<int> delivered{0};
+      std::atomic<bool> done{false};
+
+      auto steady = multiplexer.Subscribe(key, [&]()
+                                          { ++delivered; });
+      std::vector<std::thread> raisers;
+      for (int t = 0; t < 3; ++t)
+      {
+        raisers.emplace_back([&]()
+                             {
+                               while (!done.load())
+                               {
+                                 multiplexer.Raise(key);
+                               } });
+      }
+      for (int i = 0; i < 2000; ++i)
+      {
+        auto id = multiplexer.Subscribe(key, [&]()
+                                        { ++delivered; });
+        multiplexer.Unsubscribe(id);
+      }
+      done.store(true);
+      for (auto &raiser : raisers)
+      {
+        raiser.join();
+      }
+
+      EXPECT_EQ(attached.load(), 1);
+      EXPECT_EQ(multiplexer.SubscriberCount(key), 1u);
+      EXPECT_GE(static_cast<uint64_t>(delivered.load()), multiplexer.RaiseCount());
+      multiplexer.Unsubscribe(steady);
+      EXPECT_EQ(attached.load(), 0);
+    }
+
+  } // namespace test
+} // namespace media_notification_service
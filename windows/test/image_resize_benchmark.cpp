@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "image_resize.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      using Clock = std::chrono::steady_clock;
+
+      constexpr int kIterations = 5;
+
+      // Stands in for cover art: smooth gradients with a little grain, the
+      // way a photo looks to a box filter.
+      Bitmap SampleArt(uint32_t size)
+      {
+        std::mt19937 random(size);
+        Bitmap bitmap{size, size, std::vector<uint8_t>(static_cast<size_t>(size) * size * 4)};
+        uint8_t *p = bitmap.pixels.data();
+        for (uint32_t y = 0; y < size; ++y)
+        {
+          for (uint32_t x = 0; x < size; ++x)
+          {
+            double u = static_cast<double>(x) / size;
+            double v = static_cast<double>(y) / size;
+            int grain = static_cast<int>(random() % 16);
+            *p++ = static_cast<uint8_t>(255 * u * v * 0.9 + grain);
+            *p++ = static_cast<uint8_t>(127 + 100 * std::sin(6.0 * u) + grain);
+            *p++ = static_cast<uint8_t>(255 * (1 - v) * 0.9 + grain);
+            *p++ = 255;
+          }
+        }
+        return bitmap;
+      }
+
+      double MillisecondsPerResize(const Bitmap &source, ImageSize target, ResizeKernel kernel)
+      {
+        auto start = Clock::now();
+        for (int i = 0; i < kIterations; ++i)
+        {
+          Bitmap result = ResizeArea(source.View(), target, kernel);
+          EXPECT_EQ(result.width, target.width);
+        }
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / kIterations;
+      }
+
+    } // namespace
+
+    // What the art pipeline spends per thumbnail, from the sizes players hand
+    // over to the presets apps ask for.
+    TEST(ImageResizeBenchmark, SampleArtToPresets)
+    {
+      for (uint32_t source_size : {640u, 1500u})
+      {
+        Bitmap source = SampleArt(source_size);
+        for (uint32_t preset : {96u, 256u, 512u})
+        {
+          ImageSize target = FitWithin({source_size, source_size}, preset);
+          double scalar = MillisecondsPerResize(source, target, ResizeKernel::Scalar);
+          double simd = MillisecondsPerResize(source, target, ResizeKernel::Auto);
+          printf("[ resize ] %4u -> %3u: scalar %7.2f ms, %s %7.2f ms (%.1fx)\n",
+                 source_size, target.width, scalar, HasSse2Kernel() ? "sse2" : "auto", simd,
+                 simd > 0 ? scalar / simd : 0.0);
+        }
+      }
+    }
+
+  } // namespace test
+} // namespace media_notification_service
@@ -0,0 +1,113 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "image_resize.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      Bitmap Solid(uint32_t width, uint32_t height, uint8_t b, uint8_t g, uint8_t r, uint8_t a)
+      {
+        Bitmap bitmap{width, height, {}};
+        for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i)
+        {
+          bitmap.pixels.insert(bitmap.pixels.end(), {b, g, r, a});
+        }
+        return bitmap;
+      }
+
+      Bitmap Noise(uint32_t width, uint32_t height, uint32_t seed)
+      {
+        std::mt19937 random(seed);
+        Bitmap bitmap{width, height, std::vector<uint8_t>(static_cast<size_t>(width) * height * 4)};
+        for (auto &byte : bitmap.pixels)
+        {
+          byte = static_cast<uint8_t>(random());
+        }
+        return bitmap;
+      }
+
+    } // namespace
+
+    TEST(ImageResize, FitWithinKeepsAspectAndNeverEnlarges)
+    {
+      EXPECT_EQ(FitWithin({1500, 1500}, 64), (ImageSize{64, 64}));
+      EXPECT_EQ(FitWithin({1600, 900}, 256), (ImageSize{256, 144}));
+      EXPECT_EQ(FitWithin({900, 1600}, 256), (ImageSize{144, 256}));
+      EXPECT_EQ(FitWithin({300, 200}, 512), (ImageSize{300, 200}));
+      EXPECT_EQ(FitWithin({300, 200}, 0), (ImageSize{300, 200}));
+      // A sliver still keeps one pixel.
+      EXPECT_EQ(FitWithin({5000, 10}, 64), (ImageSize{64, 1}));
+    }
+
+    TEST(ImageResize, AveragesTheCoveredPixels)
+    {
+      // 2x2 to 1x1: the mean of all four.
+      Bitmap square{2, 2, {0, 0, 0, 0, 100, 100, 100, 100, 200, 200, 200, 200, 60, 60, 60, 60}};
+      Bitmap one = ResizeArea(square.View(), {1, 1});
+      EXPECT_EQ(one.pixels, (std::vector<uint8_t>{90, 90, 90, 90}));
+
+      // 3 to 2: each output covers one and a half source pixels.
+      Bitmap row{3, 1, {0, 0, 0, 0, 90, 90, 90, 90, 180, 180, 180, 180}};
+      Bitmap two = ResizeArea(row.View(), {2, 1});
+      EXPECT_EQ(two.pixels, (std::vector<uint8_t>{30, 30, 30, 30, 150, 150, 150, 150}));
+    }
+
+    TEST(ImageResize, SolidColourSurvivesLargeDownscale)
+    {
+      Bitmap source = Solid(1500, 1000, 12, 130, 250, 255);
+      ImageSize target = FitWithin({source.width, source.height}, 64);
+      Bitmap result = ResizeArea(source.View(), target);
+
+      ASSERT_EQ(result.width, 64u);
+      ASSERT_EQ(result.height, 43u);
+      EXPECT_EQ(result.pixels, Solid(64, 43, 12, 130, 250, 255).pixels);
+    }
+
+    TEST(ImageResize, ReadsRowsThroughTheStride)
+    {
+      // The left half of each padded row is the image; the rest is garbage.
+      Bitmap padded = Noise(8, 4, 1);
+      for (uint32_t y = 0; y < 4; ++y)
+      {
+        for (uint32_t x = 0; x < 4; ++x)
+        {
+          for (int c = 0; c < 4; ++c)
+          {
+            padded.pixels[(y * 8 + x) * 4 + c] = 77;
+          }
+        }
+      }
+
+      BitmapView left{padded.pixels.data(), 4, 4, 8 * 4};
+      Bitmap result = ResizeArea(left, {2, 2});
+      EXPECT_EQ(result.pixels, std::vector<uint8_t>(2 * 2 * 4, 77));
+    }
+
+    TEST(ImageResize, Sse2MatchesScalarByteForByte)
+    {
+      if (!HasSse2Kernel())
+      {
+        GTEST_SKIP() << "no SSE2 kernel in this build";
+      }
+
+      // Odd sizes exercise the single-tap and scalar-tail paths.
+      Bitmap source = Noise(397, 211, 7);
+      for (ImageSize target : {ImageSize{64, 34}, ImageSize{133, 71}, ImageSize{396, 210}, ImageSize{397, 211}})
+      {
+        Bitmap scalar = ResizeArea(source.View(), target, ResizeKernel::Scalar);
+        Bitmap sse2 = ResizeArea(source.View(), target, ResizeKernel::Sse2);
+        EXPECT_EQ(scalar.pixels, sse2.pixels) << target.width << "x" << target.height;
+      }
+    }
+
+  } // namespace test
+} // namespace media_notification_service
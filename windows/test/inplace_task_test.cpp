@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+
+#include "inplace_task.h"
+#include "worker_thread.h"
+
+namespace
+{
+  std::atomic<size_t> g_allocations{0};
+}
+
+void *operator new(std::size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1))
+  {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      // Same shape as the method-call lambdas in the plugin.
+      struct FakeResult
+      {
+        std::atomic<int64_t> value{0};
+      };
+
+      struct TooBig
+      {
+        char bytes[InplaceTask::kCapacity + 1];
+        void operator()() {}
+      };
+
+    } // namespace
+
+    static_assert(InplaceTask::Fits<std::shared_ptr<FakeResult>>, "shared_ptr capture must fit");
+    static_assert(!InplaceTask::Fits<TooBig>, "oversized captures must be rejected");
+    static_assert(!std::is_copy_constructible_v<InplaceTask>, "InplaceTask is move-only");
+
+    TEST(InplaceTask, InvokesAndMovesCaptures)
+    {
+      auto counter = std::make_shared<int>(0);
+      InplaceTask task([counter]()
+                       { ++*counter; });
+      EXPECT_TRUE(task);
+      EXPECT_EQ(counter.use_count(), 2);
+
+      InplaceTask moved = std::move(task);
+      EXPECT_FALSE(task);
+      EXPECT_EQ(counter.use_count(), 2);
+
+      moved();
+      moved();
+      EXPECT_EQ(*counter, 2);
+
+      moved = nullptr;
+      EXPECT_FALSE(moved);
+      EXPECT_EQ(counter.use_count(), 1);
+    }
+
+    TEST(InplaceTask, SupportsMutableAndMoveOnlyCaptures)
+    {
+      auto owned = std::make_unique<int>(41);
+      int seen = 0;
+      InplaceTask task([owned = std::move(owned), &seen]() mutable
+                       { seen = ++*owned; });
+      task();
+      EXPECT_EQ(seen, 42);
+    }
+
+    TEST(InplaceTask, EnqueueDoesNotAllocateInSteadyState)
+    {
+      WorkerThread worker;
+      auto result = std::make_shared<FakeResult>();
+      std::atomic<int> completed{0};
+
+      auto run_batch = [&](int count)
+      {
+        int target = completed.load() + count;
+        for (int i = 0; i < count; ++i)
+        {
+          int64_t position_ms = i;
+          worker.EnqueueTask([result, position_ms, &completed]()
+                             {
+            result->value.store(position_ms, std::memory_order_relaxed);
+            completed.fetch_add(1, std::memory_order_release); },
+                             TaskPriority::Position);
+        }
+        while (completed.load(std::memory_order_acquire) < target)
+        {
+          std::this_thread::yield();
+        }
+      };
+
+      // Batches stay below the ring size so the overflow list is never used.
+      run_batch(256);
+
+      size_t before = g_allocations.load();
+      for (int batch = 0; batch < 40; ++batch)
+      {
+        run_batch(256);
+      }
+      size_t allocations = g_allocations.load() - before;
+
+      size_t function_before = g_allocations.load();
+      {
+        int64_t position_ms = 1;
+        std::function<void()> function([result, position_ms, &completed]()
+                                       { result->value.store(position_ms + completed.load()); });
+        function();
+      }
+      size_t function_allocations = g_allocations.load() - function_before;
+
+      std::printf("allocations for 10240 enqueues: %zu (std::function for the same capture: %zu)\n",
+                  allocations, function_allocations);
+      EXPECT_EQ(allocations, 0u);
+    }
+
+  } // namespace test
+} // namespace media_notification_service
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_mailbox.h"
+#include "platform_dispatcher.h"
+#include "test/event_fd_wake.h"
+
+#if defined(__linux__)
+#include <poll.h>
+#endif
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      using namespace std::chrono_literals;
+
+      class CountingWake : public WakeSignal
+      {
+      public:
+        bool Wake() override
+        {
+          ++wakes;
+          return true;
+        }
+
+        std::atomic<int> wakes{0};
+      };
+
+      // A stream without Flutter: queues strings and appends them to a shared
+      // log when drained.
+      class FakeStream : public DispatchSource
+      {
+      public:
+        FakeStream(PlatformDispatcher &dispatcher, std::vector<std::string> &log)
+            : dispatcher_(dispatcher), log_(log)
+        {
+          dispatcher_.AddSource(*this);
+        }
+
+        void Send(std::string event)
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.Push(std::move(event));
+          }
+          dispatcher_.Schedule();
+        }
+
+        void DrainPending() override
+        {
+          std::deque<std::string> events;
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.TakeAll(events);
+          }
+          for (auto &event : events)
+          {
+            log_.push_back(std::move(event));
+          }
+        }
+
+      private:
+        PlatformDispatcher &dispatcher_;
+        std::vector<std::string> &log_;
+        std::mutex mutex_;
+        EventMailbox<std::string> pending_;
+      };
+
+    } // namespace
+
+    TEST(PlatformDispatcher, DrainsResultsThenSourcesInOrder)
+    {
+      CountingWake wake;
+      PlatformDispatcher dispatcher(wake);
+      std::vector<std::string> log;
+      FakeStream media(dispatcher, log);
+      FakeStream position(dispatcher, log);
+
+      // Queued in the opposite order from how they must come out.
+      position.Send("position 1");
+      media.Send("media 1");
+      dispatcher.Post([&]()
+                      { log.push_back("result 1"); });
+      position.Send("position 2");
+      dispatcher.Post([&]()
+                      { log.push_back("result 2"); });
+
+      EXPECT_EQ(wake.wakes, 1);
+      dispatcher.Drain();
+
+      EXPECT_EQ(log, (std::vector<std::string>{"result 1", "result 2", "media 1", "position 1", "position 2"}));
+      EXPECT_EQ(dispatcher.WakeCount(), 1u);
+      EXPECT_EQ(dispatcher.SavedWakeCount(), 4u);
+      EXPECT_EQ(dispatcher.DrainCount(), 1u);
+    }
+
+    TEST(PlatformDispatcher, WorkAfterDrainWakesAgain)
+    {
+      CountingWake wake;
+      PlatformDispatcher dispatcher(wake);
+      std::vector<std::string> log;
+      FakeStream media(dispatcher, log);
+
+      media.Send("a");
+      dispatcher.Drain();
+      media.Send("b");
+      EXPECT_EQ(wake.wakes, 2);
+
+      dispatcher.Drain();
+      EXPECT_EQ(log, (std::vector<std::string>{"a", "b"}));
+    }
+
+#if defined(__linux__)
+    TEST(PlatformDispatcher, EventFdPlatformThreadDeliversEverything)
+    {
+      constexpr int kPerProducer = 2000;
+
+      EventFdWake wake;
+      PlatformDispatcher dispatcher(wake);
+      std::vector<std::string> log;
+      FakeStream media(dispatcher, log);
+      FakeStream position(dispatcher, log);
+      std::atomic<int> results{0};
+      std::atomic<bool> quit{false};
+
+      std::thread platform([&]()
+                           {
+                             pollfd fd{wake.fd(), POLLIN, 0};
+                             while (!quit)
+                             {
+                               if (poll(&fd, 1, 10) > 0 && wake.Consume() > 0)
+                               {
+                                 dispatcher.Drain();
+                               }
+                             } });
+
+      std::thread media_producer([&]()
+                                 {
+                                   for (int i = 0; i < kPerProducer; ++i)
+                                   {
+                                     media.Send("m");
+                                   } });
+      std::thread position_producer([&]()
+                                    {
+                                      for (int i = 0; i < kPerProducer; ++i)
+                                      {
+                                        position.Send("p");
+                                      } });
+      std::thread result_producer([&]()
+                                  {
+                                    for (int i = 0; i < kPerProducer; ++i)
+                                    {
+                                      dispatcher.Post([&]()
+                                                      { ++results; });
+                                    } });
+      media_producer.join();
+      position_producer.join();
+      result_producer.join();
+
+      // Hand the check to the platform thread so |log| is only touched there.
+      std::atomic<size_t> delivered{0};
+      auto deadline = std::chrono::steady_clock::now() + 5s;
+      while (delivered < 2 * kPerProducer && std::chrono::steady_clock::now() < deadline)
+      {
+        dispatcher.Post([&]()
+                        { delivered = log.size(); });
+        std::this_thread::sleep_for(5ms);
+      }
+      quit = true;
+      platform.join();
+
+      EXPECT_EQ(log.size(), static_cast<size_t>(2 * kPerProducer));
+      EXPECT_EQ(results, kPerProducer);
+      EXPECT_LT(dispatcher.WakeCount(), static_cast<uint64_t>(3 * kPerProducer));
+    }
+#endif
+
+  } // namespace test
+} // namespace media_notification_service
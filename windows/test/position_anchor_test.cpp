@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+
+#include "position_anchor.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      using namespace std::chrono_literals;
+
+      constexpr int64_t kStart = 1700000000000;
+
+      PositionAnchor Playing(int64_t position_ms, int64_t at_ms, double rate = 1.0)
+      {
+        PositionAnchor anchor;
+        anchor.position_ms = position_ms;
+        anchor.timestamp_ms = at_ms;
+        anchor.rate = rate;
+        anchor.duration_ms = 240000;
+        anchor.state = "playing";
+        anchor.playing = true;
+        return anchor;
+      }
+
+      PositionAnchor Paused(int64_t position_ms, int64_t at_ms)
+      {
+        PositionAnchor anchor = Playing(position_ms, at_ms);
+        anchor.state = "paused";
+        anchor.playing = false;
+        return anchor;
+      }
+
+    } // namespace
+
+    TEST(PositionAnchor, ExtrapolatesOnlyWhilePlaying)
+    {
+      EXPECT_EQ(Playing(1000, kStart).PositionAt(kStart + 500), 1500);
+      EXPECT_EQ(Playing(1000, kStart, 2.0).PositionAt(kStart + 500), 2000);
+      EXPECT_EQ(Paused(1000, kStart).PositionAt(kStart + 500), 1000);
+      EXPECT_EQ(Playing(239900, kStart).PositionAt(kStart + 5000), 240000);
+    }
+
+    TEST(PositionAnchor, SteadyPlaybackSendsOneAnchorPerMinute)
+    {
+      AnchorFilter filter(250ms);
+
+      // A minute of 10 Hz samples from a player whose clock matches ours,
+      // give or take a little jitter.
+      for (int i = 0; i < 600; ++i)
+      {
+        int64_t now = kStart + i * 100;
+        int64_t jitter = (i % 3) * 20 - 20;
+        filter.Accept(Playing(5000 + i * 100 + jitter, now));
+      }
+
+      EXPECT_EQ(filter.AcceptedCount(), 1u);
+      EXPECT_EQ(filter.SuppressedCount(), 599u);
+    }
+
+    TEST(PositionAnchor, StateRateAndSeekProduceAnchors)
+    {
+      AnchorFilter filter(250ms);
+      EXPECT_TRUE(filter.Accept(Playing(0, kStart)));
+      EXPECT_FALSE(filter.Accept(Playing(1000, kStart + 1000)));
+
+      // Pausing stops the receiver's clock, however close the position is.
+      EXPECT_TRUE(filter.Accept(Paused(2000, kStart + 2000)));
+      EXPECT_FALSE(filter.Accept(Paused(2000, kStart + 9000)));
+
+      EXPECT_TRUE(filter.Accept(Playing(2000, kStart + 10000)));
+      EXPECT_TRUE(filter.Accept(Playing(3000, kStart + 11000, 1.5)));
+
+      // A seek shows up as a jump away from the extrapolated position.
+      EXPECT_TRUE(filter.Accept(Playing(60000, kStart + 12000, 1.5)));
+      EXPECT_EQ(filter.AcceptedCount(), 5u);
+    }
+
+    TEST(PositionAnchor, SlowDriftIsCorrectedPastThreshold)
+    {
+      AnchorFilter filter(250ms);
+
+      // The player runs 1% slow against our clock: 10 ms of drift a second,
+      // so a fresh anchor is due roughly every 25 seconds.
+      int accepted_at_seconds[4] = {};
+      int accepted = 0;
+      for (int i = 0; i <= 600 && accepted < 4; ++i)
+      {
+        int64_t elapsed = i * 100;
+        int64_t position = static_cast<int64_t>(std::llround(static_cast<double>(elapsed) * 0.99));
+        if (filter.Accept(Playing(position, kStart + elapsed)))
+        {
+          accepted_at_seconds[accepted++] = static_cast<int>(elapsed / 1000);
+        }
+      }
+
+      ASSERT_GE(accepted, 3);
+      EXPECT_EQ(accepted_at_seconds[0], 0);
+      EXPECT_NEAR(accepted_at_seconds[1], 25, 1);
+      EXPECT_NEAR(accepted_at_seconds[2], 50, 1);
+    }
+
+    TEST(PositionAnchor, ResetResendsTheCurrentAnchor)
+    {
+      AnchorFilter filter(250ms);
+      EXPECT_TRUE(filter.Accept(Playing(0, kStart)));
+      EXPECT_FALSE(filter.Accept(Playing(100, kStart + 100)));
+
+      filter.Reset();
+      EXPECT_TRUE(filter.Accept(Playing(200, kStart + 200)));
+    }
+
+  } // namespace test
+} // namespace media_notification_service
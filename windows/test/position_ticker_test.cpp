@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "position_ticker.h"
+#include "worker_thread.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      constexpr auto kInterval = std::chrono::milliseconds(10);
+
+      template <typename F>
+      void RunOnWorker(WorkerThread &worker, F f)
+      {
+        std::promise<void> done;
+        worker.EnqueueTask([&]()
+                           {
+          f();
+          done.set_value(); },
+                           TaskPriority::Control);
+        done.get_future().wait();
+      }
+
+      using Clock = std::chrono::steady_clock;
+
+      // Stands in for the session: what the next position read will see.
+      // While playing the position advances with real time at |rate|.
+      struct FakePlayback
+      {
+        std::atomic<bool> playing{false};
+        std::atomic<int> updates{0};
+        double rate = 1.0;
+        std::chrono::milliseconds start_position{0};
+        Clock::time_point started_at = Clock::now();
+
+        std::mutex mutex;
+        std::vector<int64_t> positions;
+
+        PlaybackSample Read()
+        {
+          ++updates;
+          PlaybackSample sample;
+          sample.advancing = playing;
+          sample.rate = rate;
+          auto elapsed = std::chrono::duration<double, std::milli>(Clock::now() - started_at);
+          sample.position = start_position +
+                            std::chrono::milliseconds(static_cast<int64_t>(elapsed.count() * rate));
+          std::lock_guard<std::mutex> lock(mutex);
+          positions.push_back(sample.position.count());
+          return sample;
+        }
+      };
+
+      class PositionTickerTest : public ::testing::Test
+      {
+      protected:
+        void StartTicker()
+        {
+          RunOnWorker(worker_, [this]()
+                      { ticker_.Start([this]()
+                                      { return playback_.Read(); }); });
+        }
+
+        void TearDown() override
+        {
+          RunOnWorker(worker_, [this]()
+                      { ticker_.Stop(); });
+          worker_.Stop();
+        }
+
+        WorkerThread worker_;
+        PositionTicker ticker_{worker_, kInterval, std::chrono::milliseconds(0)};
+        FakePlayback playback_;
+      };
+
+    } // namespace
+
+    TEST_F(PositionTickerTest, StaysAsleepWithNothingPlaying)
+    {
+      StartTicker();
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+      // Only the initial update on listen; no timer wake-ups at all.
+      EXPECT_EQ(playback_.updates, 1);
+      EXPECT_EQ(ticker_.TimerWakeCount(), 0u);
+      EXPECT_EQ(worker_.TimerWakeCount(), 0u);
+    }
+
+    TEST_F(PositionTickerTest, PauseEventSendsOneFinalUpdateAndStopsTicking)
+    {
+      playback_.playing = true;
+      StartTicker();
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      EXPECT_GE(ticker_.TimerWakeCount(), 3u);
+
+      bool ticking = true;
+      RunOnWorker(worker_, [&]()
+                  {
+        playback_.playing = false;
+        ticker_.Refresh();
+        ticking = ticker_.IsTicking(); });
+      EXPECT_FALSE(ticking);
+
+      int updates_after_pause = playback_.updates;
+      uint64_t wakes_after_pause = ticker_.TimerWakeCount();
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      EXPECT_EQ(playback_.updates, updates_after_pause);
+      EXPECT_EQ(ticker_.TimerWakeCount(), wakes_after_pause);
+    }
+
+    TEST_F(PositionTickerTest, TickThatSeesPlaybackStoppedIsTheLastOne)
+    {
+      playback_.playing = true;
+      StartTicker();
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+      // No event arrives; the next tick notices on its own.
+      playback_.playing = false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      int updates = playback_.updates;
+      uint64_t wakes = ticker_.TimerWakeCount();
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      EXPECT_EQ(playback_.updates, updates);
+      EXPECT_EQ(ticker_.TimerWakeCount(), wakes);
+    }
+
+    TEST_F(PositionTickerTest, PlayEventWakesTheTicker)
+    {
+      StartTicker();
+
+      bool ticking = false;
+      RunOnWorker(worker_, [&]()
+                  {
+        playback_.playing = true;
+        ticker_.Refresh();
+        ticking = ticker_.IsTicking(); });
+      EXPECT_TRUE(ticking);
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      EXPECT_GE(ticker_.TimerWakeCount(), 3u);
+      EXPECT_EQ(ticker_.EventCount(), 2u);
+    }
+
+    TEST(PositionTicker, DelayToNextSecondFollowsRate)
+    {
+      PlaybackSample sample;
+      sample.position = std::chrono::milliseconds(61250);
+      EXPECT_EQ(PositionTicker::DelayToNextSecond(sample), std::chrono::milliseconds(755));
+
+      sample.rate = 2.0;
+      EXPECT_EQ(PositionTicker::DelayToNextSecond(sample), std::chrono::milliseconds(380));
+
+      sample.position = std::chrono::milliseconds(0);
+      sample.rate = 1.0;
+      EXPECT_EQ(PositionTicker::DelayToNextSecond(sample), std::chrono::milliseconds(1005));
+    }
+
+    TEST_F(PositionTickerTest, AlignedTicksLandJustPastEachSecond)
+    {
+      // Four seconds of media per second of wall time keeps the test short.
+      playback_.playing = true;
+      playback_.rate = 4.0;
+      playback_.start_position = std::chrono::milliseconds(300);
+      playback_.started_at = Clock::now();
+
+      PositionTickOptions options;
+      options.align_to_second = true;
+      RunOnWorker(worker_, [&]()
+                  { ticker_.SetOptions(options); });
+      StartTicker();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+      RunOnWorker(worker_, [this]()
+                  { ticker_.Stop(); });
+
+      // Fixed 10 ms ticks would have sent ~110 updates here.
+      EXPECT_GE(ticker_.TimerWakeCount(), 3u);
+      EXPECT_LE(ticker_.TimerWakeCount(), 5u);
+
+      std::lock_guard<std::mutex> lock(playback_.mutex);
+      ASSERT_GE(playback_.positions.size(), 2u);
+      for (size_t i = 1; i < playback_.positions.size(); ++i)
+      {
+        EXPECT_LT(playback_.positions[i] % 1000, 200) << "tick " << i;
+        EXPECT_EQ(playback_.positions[i] / 1000, playback_.positions[i - 1] / 1000 + 1) << "tick " << i;
+      }
+    }
+
+  } // namespace test
+} // namespace media_notification_service
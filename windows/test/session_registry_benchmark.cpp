@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "session_registry.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      using Clock = std::chrono::steady_clock;
+
+      constexpr size_t kSessions = 200;
+      constexpr int kRounds = 200;
+      // Sessions that come and go per round, on top of those that change.
+      constexpr int kChurn = 2;
+      // A TryGetMediaPropertiesAsync round trip to another process, kept
+      // small so the benchmark stays quick.
+      constexpr auto kFetchCost = std::chrono::microseconds(20);
+
+      // 200 players, each with a track counter standing in for whatever
+      // its next MediaPropertiesChanged carries.
+      class SimulatedSessions
+      {
+      public:
+        SimulatedSessions()
+        {
+          for (size_t i = 0; i < kSessions; ++i)
+          {
+            ids_.push_back(NewId());
+            tracks_.push_back(0);
+            index_[ids_.back()] = i;
+          }
+        }
+
+        // What TryGetMediaPropertiesAsync would return, after spinning for
+        // as long as it would take.
+        SessionState Fetch(size_t index)
+        {
+          ++fetches_;
+          auto until = Clock::now() + kFetchCost;
+          while (Clock::now() < until)
+          {
+          }
+          std::string track = std::to_string(tracks_[index]);
+          return SessionState{ids_[index], "Title " + track, "Artist " + track, "Album " + track, "STATE_PLAYING", true};
+        }
+
+        size_t IndexOf(const std::string &id) const { return index_.at(id); }
+
+        size_t Change(std::mt19937 &random)
+        {
+          size_t index = random() % ids_.size();
+          ++tracks_[index];
+          return index;
+        }
+
+        // One app closes and another opens.
+        void Replace(std::mt19937 &random)
+        {
+          size_t index = random() % ids_.size();
+          index_.erase(ids_[index]);
+          ids_[index] = NewId();
+          index_[ids_[index]] = index;
+          tracks_[index] = 0;
+        }
+
+        const std::vector<std::string> &Ids() const { return ids_; }
+        uint64_t Fetches() const { return fetches_; }
+
+      private:
+        std::string NewId() { return "App" + std::to_string(next_id_++) + "!Player"; }
+
+        std::vector<std::string> ids_;
+        std::vector<uint64_t> tracks_;
+        std::unordered_map<std::string, size_t> index_;
+        uint64_t next_id_ = 0;
+        uint64_t fetches_ = 0;
+      };
+
+      struct RoundCost
+      {
+        double us_per_round = 0;
+        double fetches_per_round = 0;
+        double reported_per_round = 0;
+      };
+
+      // What MediaSessionManager does per refresh: list only if the set
+      // changed, fetch only what is stale.
+      RoundCost RunRegistry(int changes_per_round)
+      {
+        SimulatedSessions sessions;
+        SessionRegistry registry;
+        std::mt19937 random(7);
+        auto refresh = [&]()
+        {
+          size_t reported = 0;
+          if (registry.TakeListChanged())
+          {
+            registry.SyncIds(sessions.Ids());
+          }
+          for (const auto &id : registry.TakeStale())
+          {
+            registry.Update(sessions.Fetch(sessions.IndexOf(id)));
+          }
+          auto changes = registry.TakeChanges();
+          reported += changes.changed.size() + changes.removed.size();
+          return reported;
+        };
+        refresh();
+
+        uint64_t fetches_before = sessions.Fetches();
+        size_t reported = 0;
+        auto start = Clock::now();
+        for (int round = 0; round < kRounds; ++round)
+        {
+          for (int c = 0; c < changes_per_round; ++c)
+          {
+            registry.MarkStale(sessions.Ids()[sessions.Change(random)]);
+          }
+          for (int c = 0; c < kChurn; ++c)
+          {
+            sessions.Replace(random);
+          }
+          registry.MarkListChanged();
+          reported += refresh();
+        }
+        auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        return {elapsed / kRounds, static_cast<double>(sessions.Fetches() - fetches_before) / kRounds,
+                static_cast<double>(reported) / kRounds};
+      }
+
+      // The alternative: poll every session each round and diff.
+      RoundCost RunPolling(int changes_per_round)
+      {
+        SimulatedSessions sessions;
+        std::mt19937 random(7);
+        std::vector<SessionState> previous(kSessions);
+
+        uint64_t fetches_before = sessions.Fetches();
+        size_t reported = 0;
+        auto start = Clock::now();
+        for (int round = 0; round < kRounds; ++round)
+        {
+          for (int c = 0; c < changes_per_round; ++c)
+          {
+            sessions.Change(random);
+          }
+          for (int c = 0; c < kChurn; ++c)
+          {
+            sessions.Replace(random);
+          }
+          for (size_t i = 0; i < sessions.Ids().size(); ++i)
+          {
+            SessionState state = sessions.Fetch(i);
+            if (!(state == previous[i]))
+            {
+              previous[i] = std::move(state);
+              ++reported;
+            }
+          }
+        }
+        auto elapsed = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        return {elapsed / kRounds, static_cast<double>(sessions.Fetches() - fetches_before) / kRounds,
+                static_cast<double>(reported) / kRounds};
+      }
+
+    } // namespace
+
+    // Cost per refresh with 200 sessions, 2 of them replaced per round, as
+    // the number of sessions that changed grows. Each fetch is a
+    // cross-process call in the plugin.
+    TEST(SessionRegistryBenchmark, CostScalesWithChangedSessions)
+    {
+      double previous_fetches = 0;
+      for (int changes : {1, 5, 20, 100})
+      {
+        RoundCost registry = RunRegistry(changes);
+        RoundCost polling = RunPolling(changes);
+        printf("[ sessions ] %3d of %zu changed: registry %6.1f us, %5.1f fetches, %5.1f reported | "
+               "polling %6.1f us, %5.1f fetches\n",
+               changes, kSessions, registry.us_per_round, registry.fetches_per_round,
+               registry.reported_per_round, polling.us_per_round, polling.fetches_per_round);
+
+        // Changed plus added sessions at most; repeats of one session fold.
+        EXPECT_LE(registry.fetches_per_round, changes + kChurn);
+        EXPECT_GE(registry.fetches_per_round, previous_fetches);
+        EXPECT_EQ(polling.fetches_per_round, static_cast<double>(kSessions));
+        EXPECT_LT(registry.us_per_round, polling.us_per_round);
+        previous_fetches = registry.fetches_per_round;
+      }
+    }
+
+  } // namespace test
+} // namespace media_notification_service
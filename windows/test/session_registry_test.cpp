@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "session_registry.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      SessionState State(const std::string &id, const std::string &title, bool playing = true)
+      {
+        return SessionState{id, title, "Artist", "Album", playing ? "STATE_PLAYING" : "STATE_PAUSED", playing};
+      }
+
+      std::vector<std::string> Sorted(std::vector<std::string> ids)
+      {
+        std::sort(ids.begin(), ids.end());
+        return ids;
+      }
+
+    } // namespace
+
+    TEST(SessionRegistry, NewSessionsAreStaleUntilFetched)
+    {
+      SessionRegistry registry;
+      EXPECT_TRUE(registry.TakeListChanged());
+      EXPECT_FALSE(registry.TakeListChanged());
+
+      auto diff = registry.SyncIds({"Spotify.exe", "Chrome", "Spotify.exe"});
+      EXPECT_EQ(Sorted(diff.added), (std::vector<std::string>{"Chrome", "Spotify.exe"}));
+      EXPECT_EQ(Sorted(registry.TakeStale()), (std::vector<std::string>{"Chrome", "Spotify.exe"}));
+      EXPECT_TRUE(registry.TakeStale().empty());
+
+      // Listed but not fetched: nothing to report yet.
+      EXPECT_TRUE(registry.TakeChanges().Empty());
+      EXPECT_TRUE(registry.All().empty());
+      EXPECT_EQ(registry.Find("Chrome"), nullptr);
+
+      EXPECT_TRUE(registry.Update(State("Chrome", "Video")));
+      auto changes = registry.TakeChanges();
+      ASSERT_EQ(changes.changed.size(), 1u);
+      EXPECT_EQ(changes.changed[0], State("Chrome", "Video"));
+      ASSERT_NE(registry.Find("Chrome"), nullptr);
+      EXPECT_EQ(registry.Find("Chrome")->title, "Video");
+    }
+
+    TEST(SessionRegistry, OnlyChangedSessionsAreReported)
+    {
+      SessionRegistry registry;
+      registry.SyncIds({"a", "b", "c"});
+      registry.TakeStale();
+      for (const char *id : {"a", "b", "c"})
+      {
+        registry.Update(State(id, "One"));
+      }
+      EXPECT_EQ(registry.TakeChanges().changed.size(), 3u);
+
+      registry.MarkStale("b");
+      registry.MarkStale("c");
+      EXPECT_EQ(Sorted(registry.TakeStale()), (std::vector<std::string>{"b", "c"}));
+      // A PlaybackInfoChanged that changed nothing we report.
+      EXPECT_FALSE(registry.Update(State("b", "One")));
+      EXPECT_TRUE(registry.Update(State("c", "Two")));
+      // Two updates before anyone looked: reported once, as the latest.
+      EXPECT_TRUE(registry.Update(State("c", "Three")));
+
+      auto changes = registry.TakeChanges();
+      ASSERT_EQ(changes.changed.size(), 1u);
+      EXPECT_EQ(changes.changed[0].title, "Three");
+      EXPECT_EQ(registry.FetchCount(), 6u);
+      EXPECT_EQ(registry.UnchangedCount(), 1u);
+    }
+
+    TEST(SessionRegistry, RemovedSessionsAreReportedOnceFetched)
+    {
+      SessionRegistry registry;
+      registry.SyncIds({"a", "b"});
+      registry.TakeStale();
+      registry.Update(State("a", "One"));
+      registry.TakeChanges();
+
+      // "b" never made it into a report, so its removal is not one either.
+      auto diff = registry.SyncIds({});
+      EXPECT_EQ(Sorted(diff.removed), (std::vector<std::string>{"a", "b"}));
+      auto changes = registry.TakeChanges();
+      EXPECT_EQ(changes.removed, (std::vector<std::string>{"a"}));
+      EXPECT_TRUE(changes.changed.empty());
+
+      // Late events for a removed session fetch nothing.
+      registry.MarkStale("a");
+      EXPECT_TRUE(registry.TakeStale().empty());
+      EXPECT_FALSE(registry.Update(State("a", "One")));
+    }
+
+    TEST(SessionRegistry, ChangeThenRemovalReportsOnlyTheRemoval)
+    {
+      SessionRegistry registry;
+      registry.SyncIds({"a"});
+      registry.TakeStale();
+      registry.Update(State("a", "One"));
+      registry.TakeChanges();
+
+      registry.Update(State("a", "Two"));
+      registry.SyncIds({});
+      auto changes = registry.TakeChanges();
+      EXPECT_TRUE(changes.changed.empty());
+      EXPECT_EQ(changes.removed, (std::vector<std::string>{"a"}));
+    }
+
+    TEST(SessionRegistry, SuppliedStateSavesTheSessionsOwnFetch)
+    {
+      SessionRegistry registry;
+      registry.SyncIds({"current", "other"});
+      registry.TakeStale();
+      registry.Update(State("current", "One"));
+      registry.Update(State("other", "One"));
+      registry.TakeChanges();
+
+      // One event; the media stream fetches the current session for it.
+      registry.MarkStale("current");
+      registry.MarkStale("other");
+      uint64_t mark = registry.MarkCount();
+      EXPECT_EQ(registry.TakeStale("current"), (std::vector<std::string>{"other"}));
+      EXPECT_TRUE(registry.Supply(State("current", "Two"), mark));
+
+      EXPECT_TRUE(registry.TakeStale().empty());
+      auto changes = registry.TakeChanges();
+      ASSERT_EQ(changes.changed.size(), 1u);
+      EXPECT_EQ(changes.changed[0].title, "Two");
+      EXPECT_EQ(registry.SuppliedCount(), 1u);
+    }
+
+    TEST(SessionRegistry, SupplyOvertakenByAnEventLeavesTheSessionStale)
+    {
+      SessionRegistry registry;
+      registry.SyncIds({"current"});
+      registry.TakeStale();
+
+      uint64_t mark = registry.MarkCount();
+      // Changed again while the supplying fetch was in flight.
+      registry.MarkStale("current");
+      registry.Supply(State("current", "One"), mark);
+      EXPECT_EQ(registry.TakeStale(), (std::vector<std::string>{"current"}));
+    }
+
+    TEST(SessionRegistry, MarksFromEventThreadsAreAllSeen)
+    {
+      SessionRegistry registry;
+      std::vector<std::string> ids;
+      for (int i = 0; i < 64; ++i)
+      {
+        ids.push_back("app" + std::to_string(i));
+      }
+      registry.SyncIds(ids);
+      registry.TakeStale();
+
+      std::vector<std::thread> threads;
+      for (int t = 0; t < 4; ++t)
+      {
+        threads.emplace_back([&, t]()
+                             {
+                               for (int i = t; i < 64; i += 4)
+                               {
+                                 registry.MarkStale(ids[i]);
+                                 registry.MarkListChanged();
+                               } });
+      }
+      for (auto &thread : threads)
+      {
+        thread.join();
+      }
+      EXPECT_EQ(registry.TakeStale().size(), 64u);
+      EXPECT_TRUE(registry.TakeListChanged());
+    }
+
+    TEST(SessionRegistry, ClearStartsOver)
+    {
+      SessionRegistry registry;
+      registry.TakeListChanged();
+      registry.SyncIds({"a"});
+      registry.TakeStale();
+      registry.Update(State("a", "One"));
+
+      registry.Clear();
+      EXPECT_TRUE(registry.TakeListChanged());
+      EXPECT_TRUE(registry.TakeChanges().Empty());
+      EXPECT_EQ(registry.SyncIds({"a"}).added, (std::vector<std::string>{"a"}));
+    }
+
+  } // namespace test
+} // namespace media_notification_service
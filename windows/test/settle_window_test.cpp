@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <vector>
+
+#include "settle_window.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      using namespace std::chrono_literals;
+
+      const SettleWindow::TimePoint kStart{std::chrono::hours(1)};
+
+      int64_t Offset(SettleWindow::TimePoint at)
+      {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(at - kStart).count();
+      }
+
+      // Plays |events| (ms from kStart) against a virtual clock, firing the
+      // timer at each deadline as a worker timer would, and returns when
+      // emits happened.
+      std::vector<int64_t> Replay(SettleWindow &settle, const std::vector<int64_t> &events)
+      {
+        std::vector<int64_t> emits;
+        auto run_timers_until = [&](SettleWindow::TimePoint until)
+        {
+          while (auto deadline = settle.Deadline())
+          {
+            if (*deadline > until)
+            {
+              break;
+            }
+            if (settle.OnTimer(*deadline))
+            {
+              emits.push_back(Offset(*deadline));
+            }
+          }
+        };
+
+        for (int64_t event : events)
+        {
+          auto now = kStart + std::chrono::milliseconds(event);
+          run_timers_until(now);
+          if (settle.OnEvent(now))
+          {
+            emits.push_back(event);
+          }
+        }
+        run_timers_until(SettleWindow::TimePoint::max());
+        return emits;
+      }
+
+      // Shaped after a browser's track change: title, artist and album
+      // within a few ms, the thumbnail once it has loaded.
+      const std::vector<int64_t> kBrowserTrackChange = {0, 3, 7, 190};
+      // A native player publishing everything at once.
+      const std::vector<int64_t> kPlayerTrackChange = {0, 1};
+      // A player republishing its properties every 100 ms for 3 s, e.g.
+      // while a live stream updates its title.
+      std::vector<int64_t> Storm()
+      {
+        std::vector<int64_t> events;
+        for (int64_t t = 0; t < 3000; t += 100)
+        {
+          events.push_back(t);
+        }
+        return events;
+      }
+
+    } // namespace
+
+    TEST(SettleWindow, BurstEmitsOnceAfterItSettles)
+    {
+      SettleWindow settle;
+
+      EXPECT_EQ(Replay(settle, kBrowserTrackChange), (std::vector<int64_t>{440}));
+      EXPECT_FALSE(settle.InBurst());
+      EXPECT_EQ(Replay(settle, kPlayerTrackChange), (std::vector<int64_t>{251}));
+      EXPECT_EQ(settle.EventCount(), 6u);
+      EXPECT_EQ(settle.EmitCount(), 2u);
+    }
+
+    TEST(SettleWindow, LeadingEmitComesFirstAndTrailingOnlyIfMoreArrived)
+    {
+      SettleWindow settle({250ms, true, true, 1000ms});
+
+      EXPECT_EQ(Replay(settle, kBrowserTrackChange), (std::vector<int64_t>{0, 440}));
+      // A lone event, e.g. play/pause, is fully covered by the leading emit.
+      EXPECT_EQ(Replay(settle, {5000}), (std::vector<int64_t>{5000}));
+    }
+
+    TEST(SettleWindow, LeadingOnlyDropsTheRestOfTheBurst)
+    {
+      SettleWindow settle({250ms, true, false, 1000ms});
+
+      EXPECT_EQ(Replay(settle, kBrowserTrackChange), (std::vector<int64_t>{0}));
+      EXPECT_EQ(Replay(settle, {5000, 5010}), (std::vector<int64_t>{5000}));
+    }
+
+    TEST(SettleWindow, MaxWaitBoundsAStorm)
+    {
+      SettleWindow settle;
+
+      // Without max_wait the storm would hold every update back until 3150.
+      EXPECT_EQ(Replay(settle, Storm()), (std::vector<int64_t>{1000, 2000, 3000}));
+      EXPECT_EQ(settle.EventCount(), 30u);
+
+      SettleWindow unbounded({250ms, false, true, 0ms});
+      EXPECT_EQ(Replay(unbounded, Storm()), (std::vector<int64_t>{3150}));
+    }
+
+    TEST(SettleWindow, SeparateBurstsEmitSeparately)
+    {
+      SettleWindow settle;
+      std::vector<int64_t> events = kBrowserTrackChange;
+      for (int64_t t : kBrowserTrackChange)
+      {
+        events.push_back(t + 2000);
+      }
+
+      EXPECT_EQ(Replay(settle, events), (std::vector<int64_t>{440, 2440}));
+    }
+
+    TEST(SettleWindow, EarlyTimerRearmsForTheLaterDeadline)
+    {
+      SettleWindow settle;
+
+      EXPECT_FALSE(settle.OnEvent(kStart));
+      auto first = *settle.Deadline();
+      EXPECT_FALSE(settle.OnEvent(kStart + 100ms));
+      // Armed for the first deadline, which the second event pushed back.
+      EXPECT_FALSE(settle.OnTimer(first));
+      EXPECT_EQ(*settle.Deadline(), kStart + 350ms);
+      EXPECT_TRUE(settle.OnTimer(kStart + 350ms));
+      EXPECT_FALSE(settle.Deadline());
+    }
+
+    TEST(SettleWindow, ZeroWindowPassesEverythingThrough)
+    {
+      SettleWindow settle({0ms, false, true, 1000ms});
+
+      EXPECT_EQ(Replay(settle, kBrowserTrackChange), kBrowserTrackChange);
+      EXPECT_FALSE(settle.InBurst());
+    }
+
+    TEST(SettleWindow, ResetDropsTheOpenBurst)
+    {
+      SettleWindow settle;
+
+      EXPECT_FALSE(settle.OnEvent(kStart));
+      settle.Reset();
+      EXPECT_FALSE(settle.Deadline());
+      EXPECT_EQ(settle.EmitCount(), 0u);
+    }
+
+  } // namespace test
+} // namespace media_notification_service
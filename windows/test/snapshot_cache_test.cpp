@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "snapshot_cache.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      using Clock = std::chrono::steady_clock;
+      using namespace std::chrono_literals;
+
+      // Stands in for a session: properties change, then the event fires.
+      class SimulatedSession
+      {
+      public:
+        explicit SimulatedSession(SnapshotCache<int64_t> &cache) : cache_(cache) {}
+
+        void Change()
+        {
+          int64_t next = state_.load() + 1;
+          state_.store(next);
+          cache_.Invalidate();
+          announced_.store(next);
+        }
+
+        // What TryGetMediaPropertiesAsync would return, slowly.
+        int64_t Fetch(std::chrono::microseconds cost) const
+        {
+          std::this_thread::sleep_for(cost);
+          return state_.load();
+        }
+
+        // The newest change whose event has already fired.
+        int64_t Announced() const { return announced_.load(); }
+
+      private:
+        SnapshotCache<int64_t> &cache_;
+        std::atomic<int64_t> state_{0};
+        std::atomic<int64_t> announced_{0};
+      };
+
+      // What MediaSessionManager does per getCurrentMedia.
+      int64_t Get(SnapshotCache<int64_t> &cache, const SimulatedSession &session, std::chrono::microseconds cost)
+      {
+        int64_t value = 0;
+        if (cache.Lookup(value))
+        {
+          return value;
+        }
+        uint64_t version = cache.BeginFetch();
+        value = session.Fetch(cost);
+        cache.Store(version, value);
+        return value;
+      }
+
+    } // namespace
+
+    TEST(SnapshotCache, ServesUntilInvalidated)
+    {
+      SnapshotCache<int64_t> cache;
+      cache.SetEnabled(true);
+      int64_t value = 0;
+
+      EXPECT_FALSE(cache.Lookup(value));
+      EXPECT_TRUE(cache.Store(cache.BeginFetch(), 7));
+      EXPECT_TRUE(cache.Lookup(value));
+      EXPECT_EQ(value, 7);
+
+      cache.Invalidate();
+      EXPECT_FALSE(cache.Lookup(value));
+      EXPECT_EQ(cache.HitCount(), 1u);
+      EXPECT_EQ(cache.MissCount(), 2u);
+    }
+
+    TEST(SnapshotCache, FetchOvertakenByAnEventIsNotKept)
+    {
+      SnapshotCache<int64_t> cache;
+      cache.SetEnabled(true);
+      int64_t value = 0;
+
+      uint64_t version = cache.BeginFetch();
+      // The event lands while the fetch is in flight.
+      cache.Invalidate();
+      EXPECT_FALSE(cache.Store(version, 1));
+      EXPECT_FALSE(cache.Lookup(value));
+      EXPECT_EQ(cache.DiscardedCount(), 1u);
+
+      EXPECT_TRUE(cache.Store(cache.BeginFetch(), 2));
+      EXPECT_TRUE(cache.Lookup(value));
+      EXPECT_EQ(value, 2);
+    }
+
+    TEST(SnapshotCache, DisabledNeverServes)
+    {
+      SnapshotCache<int64_t> cache;
+      int64_t value = 0;
+
+      EXPECT_FALSE(cache.Store(cache.BeginFetch(), 1));
+      EXPECT_FALSE(cache.Lookup(value));
+
+      cache.SetEnabled(true);
+      ASSERT_TRUE(cache.Store(cache.BeginFetch(), 1));
+      // Unsubscribed: changes would go unnoticed from here.
+      cache.SetEnabled(false);
+      EXPECT_FALSE(cache.Lookup(value));
+      // Subscribed again: nothing from before is trusted.
+      cache.SetEnabled(true);
+      EXPECT_FALSE(cache.Lookup(value));
+    }
+
+    // getCurrentMedia polled every millisecond while the session changes
+    // every 5 to 40 ms. Every answer must include every change announced
+    // before the call; the cache should answer most calls without a fetch.
+    TEST(SnapshotCache, SimulatedEventSourceHitRateAndLatency)
+    {
+      constexpr int kCalls = 400;
+      constexpr auto kFetchCost = 2000us;
+
+      SnapshotCache<int64_t> cache;
+      cache.SetEnabled(true);
+      SimulatedSession session(cache);
+
+      std::atomic<bool> done{false};
+      std::thread events([&]()
+                         {
+                           std::mt19937 random(3);
+                           std::uniform_int_distribution<int> gap_ms(5, 40);
+                           while (!done.load())
+                           {
+                             std::this_thread::sleep_for(std::chrono::milliseconds(gap_ms(random)));
+                             session.Change();
+                           } });
+
+      std::vector<double> latencies_us;
+      latencies_us.reserve(kCalls);
+      int stale = 0;
+      for (int i = 0; i < kCalls; ++i)
+      {
+        int64_t announced = session.Announced();
+        auto start = Clock::now();
+        int64_t value = Get(cache, session, kFetchCost);
+        latencies_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        if (value < announced)
+        {
+          ++stale;
+        }
+        std::this_thread::sleep_for(1ms);
+      }
+      done.store(true);
+      events.join();
+
+      std::sort(latencies_us.begin(), latencies_us.end());
+      double mean = 0;
+      for (double latency : latencies_us)
+      {
+        mean += latency;
+      }
+      mean /= static_cast<double>(latencies_us.size());
+      double hit_rate = static_cast<double>(cache.HitCount()) /
+                        static_cast<double>(cache.HitCount() + cache.MissCount());
+      printf("[ snapshot ] %d calls, %llu events: hit rate %.1f%%, latency mean %.0f us, p50 %.0f us, p99 %.0f us "
+             "(every call fetches: ~%lld us), %llu fetches overtaken\n",
+             kCalls, static_cast<unsigned long long>(cache.InvalidationCount()), hit_rate * 100, mean,
+             latencies_us[latencies_us.size() / 2], latencies_us[latencies_us.size() * 99 / 100],
+             static_cast<long long>(kFetchCost.count()),
+             static_cast<unsigned long long>(cache.DiscardedCount()));
+
+      EXPECT_EQ(stale, 0);
+      EXPECT_GT(hit_rate, 0.5);
+    }
+
+  } // namespace test
+} // namespace media_notification_service
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "strand.h"
+#include "thread_pool.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      struct StrandProbe
+      {
+        std::atomic<int> in_flight{0};
+        std::atomic<bool> overlapped{false};
+        std::vector<int> order;
+      };
+
+    } // namespace
+
+    TEST(ThreadPool, RunsPostedTasksBeforeStopping)
+    {
+      std::atomic<int> ran{0};
+      ThreadPool pool(3);
+      EXPECT_EQ(pool.ThreadCount(), 3u);
+
+      for (int i = 0; i < 1000; ++i)
+      {
+        pool.Post([&]()
+                  { ++ran; });
+      }
+      pool.Stop();
+
+      EXPECT_EQ(ran, 1000);
+    }
+
+    TEST(Strand, KeepsOrderAndExclusionUnderStress)
+    {
+      constexpr int kStrands = 8;
+      constexpr int kProducersPerStrand = 3;
+      constexpr int kTasksPerProducer = 2000;
+
+      ThreadPool pool(4);
+      std::vector<std::unique_ptr<Strand>> strands;
+      std::vector<StrandProbe> probes(kStrands);
+      for (int s = 0; s < kStrands; ++s)
+      {
+        strands.push_back(std::make_unique<Strand>(pool));
+      }
+
+      std::vector<std::thread> producers;
+      for (int s = 0; s < kStrands; ++s)
+      {
+        for (int p = 0; p < kProducersPerStrand; ++p)
+        {
+          producers.emplace_back([&, s, p]()
+                                 {
+            for (int i = 0; i < kTasksPerProducer; ++i)
+            {
+              StrandProbe *probe = &probes[s];
+              int value = p * kTasksPerProducer + i;
+              strands[s]->Post([probe, value]()
+                               {
+                if (probe->in_flight.fetch_add(1) != 0)
+                {
+                  probe->overlapped = true;
+                }
+                probe->order.push_back(value);
+                probe->in_flight.fetch_sub(1); });
+            } });
+        }
+      }
+
+      for (auto &producer : producers)
+      {
+        producer.join();
+      }
+      pool.Stop();
+
+      for (auto &probe : probes)
+      {
+        EXPECT_FALSE(probe.overlapped);
+        ASSERT_EQ(probe.order.size(), static_cast<size_t>(kProducersPerStrand * kTasksPerProducer));
+
+        // Each producer's tasks must come out in the order it posted them.
+        std::vector<int> last(kProducersPerStrand, -1);
+        for (int value : probe.order)
+        {
+          int producer = value / kTasksPerProducer;
+          EXPECT_GT(value % kTasksPerProducer, last[producer]);
+          last[producer] = value % kTasksPerProducer;
+        }
+      }
+    }
+
+    TEST(Strand, IndependentStrandsRunConcurrently)
+    {
+      constexpr int kStrands = 4;
+      ThreadPool pool(kStrands);
+      std::vector<std::unique_ptr<Strand>> strands;
+      for (int s = 0; s < kStrands; ++s)
+      {
+        strands.push_back(std::make_unique<Strand>(pool));
+      }
+
+      std::atomic<int> running{0};
+      std::atomic<int> peak{0};
+      for (int i = 0; i < 5; ++i)
+      {
+        for (auto &strand : strands)
+        {
+          strand->Post([&]()
+                       {
+            int now = ++running;
+            int seen = peak.load();
+            while (now > seen && !peak.compare_exchange_weak(seen, now))
+            {
+            }
+            // Stands in for a blocking thumbnail read.
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            --running; });
+        }
+      }
+      pool.Stop();
+
+      EXPECT_GT(peak, 1);
+    }
+
+  } // namespace test
+} // namespace media_notification_service
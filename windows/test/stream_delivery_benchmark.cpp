@@ -0,0 +1,466 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "drain_scheduler.h"
+#include "event_mailbox.h"
+#include "platform_dispatcher.h"
+#include "test/event_fd_wake.h"
+
+#if defined(__linux__)
+#include <poll.h>
+#endif
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      using Clock = std::chrono::steady_clock;
+      using namespace std::chrono_literals;
+
+      constexpr int kEvents = 500;
+      constexpr auto kSendPeriod = 1ms;
+      // About a small album art thumbnail.
+      constexpr size_t kPayloadBytes = 64 * 1024;
+      // What the codec spends on one event on the platform thread.
+      constexpr auto kEncodeTime = 300us;
+
+      using Event = std::vector<uint8_t>;
+
+      // Stands in for the message window: wakes the consumer thread.
+      class ConditionWake : public WakeSignal
+      {
+      public:
+        bool Wake() override
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++posted;
+          }
+          cv.notify_one();
+          return true;
+        }
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        int posted = 0;
+        bool quit = false;
+      };
+
+      // A StreamController without Flutter: a mailbox, the sink lock and a
+      // platform thread that drains it whenever woken.
+      class FakeStream
+      {
+      public:
+        // |swap_out|: take the batch under the lock and encode outside it.
+        // Otherwise encode each event under the lock, as StreamController
+        // used to.
+        explicit FakeStream(bool swap_out)
+            : swap_out_(swap_out), scheduler_(wake_), thread_([this]()
+                                                              { Run(); }) {}
+
+        ~FakeStream()
+        {
+          {
+            std::lock_guard<std::mutex> lock(wake_.mutex);
+            wake_.quit = true;
+          }
+          wake_.cv.notify_one();
+          thread_.join();
+        }
+
+        void Send(const Event &event)
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            mailbox_.Push(event);
+          }
+          scheduler_.Schedule();
+        }
+
+        void Send(Event &&event)
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            mailbox_.Push(std::move(event));
+          }
+          scheduler_.Schedule();
+        }
+
+        int Delivered() const { return delivered_; }
+
+      private:
+        void Run()
+        {
+          std::unique_lock<std::mutex> wake_lock(wake_.mutex);
+          while (true)
+          {
+            wake_.cv.wait(wake_lock, [this]()
+                          { return wake_.posted > 0 || wake_.quit; });
+            if (wake_.posted == 0)
+            {
+              return;
+            }
+            --wake_.posted;
+            wake_lock.unlock();
+
+            scheduler_.BeginDrain();
+            if (swap_out_)
+            {
+              std::deque<Event> batch;
+              {
+                std::lock_guard<std::mutex> lock(mutex_);
+                mailbox_.TakeAll(batch);
+              }
+              for (const auto &event : batch)
+              {
+                Encode(event);
+              }
+            }
+            else
+            {
+              std::lock_guard<std::mutex> lock(mutex_);
+              Event event;
+              while (mailbox_.TryPop(event))
+              {
+                Encode(event);
+              }
+            }
+
+            wake_lock.lock();
+          }
+        }
+
+        void Encode(const Event &event)
+        {
+          encoded_.assign(event.begin(), event.end());
+          auto until = Clock::now() + kEncodeTime;
+          while (Clock::now() < until)
+          {
+          }
+          ++delivered_;
+        }
+
+        bool swap_out_;
+        std::mutex mutex_;
+        EventMailbox<Event> mailbox_;
+        ConditionWake wake_;
+        DrainScheduler scheduler_;
+        Event encoded_;
+        std::atomic<int> delivered_{0};
+        std::thread thread_;
+      };
+
+      struct StallResult
+      {
+        std::chrono::microseconds median{0};
+        std::chrono::microseconds p99{0};
+        std::chrono::microseconds max{0};
+        std::chrono::microseconds total{0};
+      };
+
+      // Sends kEvents at 1 kHz and times each Send call on the producer.
+      StallResult MeasureProducerStall(bool swap_out, bool move)
+      {
+        FakeStream stream(swap_out);
+        const Event source(kPayloadBytes, 0x5a);
+        std::vector<std::chrono::microseconds> stalls;
+        stalls.reserve(kEvents);
+
+        auto next = Clock::now();
+        for (int i = 0; i < kEvents; ++i)
+        {
+          // The producer builds a fresh event either way; only handing it
+          // over is timed.
+          Event event = source;
+          auto start = Clock::now();
+          if (move)
+          {
+            stream.Send(std::move(event));
+          }
+          else
+          {
+            stream.Send(event);
+          }
+          stalls.push_back(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start));
+
+          next += kSendPeriod;
+          std::this_thread::sleep_until(next);
+        }
+
+        auto deadline = Clock::now() + 5s;
+        while (stream.Delivered() < kEvents && Clock::now() < deadline)
+        {
+          std::this_thread::sleep_for(1ms);
+        }
+        EXPECT_EQ(stream.Delivered(), kEvents);
+
+        StallResult result;
+        for (auto stall : stalls)
+        {
+          result.total += stall;
+        }
+        std::sort(stalls.begin(), stalls.end());
+        result.median = stalls[stalls.size() / 2];
+        result.p99 = stalls[stalls.size() * 99 / 100];
+        result.max = stalls.back();
+        return result;
+      }
+
+      void Print(const char *name, const StallResult &result)
+      {
+        std::printf("%s: send stall median %lldus, p99 %lldus, max %lldus, total %lldus\n",
+                    name,
+                    static_cast<long long>(result.median.count()),
+                    static_cast<long long>(result.p99.count()),
+                    static_cast<long long>(result.max.count()),
+                    static_cast<long long>(result.total.count()));
+      }
+
+#if defined(__linux__)
+      // A stream reduced to a counter of pending events.
+      class CountingSource : public DispatchSource
+      {
+      public:
+        explicit CountingSource(PlatformDispatcher &dispatcher) : dispatcher_(dispatcher)
+        {
+          dispatcher_.AddSource(*this);
+        }
+
+        void Send()
+        {
+          pending_.fetch_add(1, std::memory_order_relaxed);
+          dispatcher_.Schedule();
+        }
+
+        void DrainPending() override
+        {
+          delivered += pending_.exchange(0, std::memory_order_relaxed);
+        }
+
+        std::atomic<int> delivered{0};
+
+      private:
+        PlatformDispatcher &dispatcher_;
+        std::atomic<int> pending_{0};
+      };
+
+      struct MixedLoadResult
+      {
+        uint64_t wakes = 0;
+        uint64_t drains = 0;
+        uint64_t poll_wakes = 0;
+      };
+
+      // Results at 50 Hz, media at 20 Hz and positions at 1 kHz for half a
+      // second, onto one fake platform thread. |shared| sends everything
+      // through one dispatcher; otherwise each kind has its own dispatcher
+      // and eventfd, as each StreamController had its own window.
+      MixedLoadResult RunMixedLoad(bool shared)
+      {
+        constexpr int kChannels = 3;
+        EventFdWake wakes[kChannels];
+        std::unique_ptr<PlatformDispatcher> dispatchers[kChannels];
+        dispatchers[0] = std::make_unique<PlatformDispatcher>(wakes[0]);
+        for (int i = 1; i < kChannels; ++i)
+        {
+          dispatchers[i] = shared ? nullptr : std::make_unique<PlatformDispatcher>(wakes[i]);
+        }
+        auto &results_dispatcher = *dispatchers[0];
+        CountingSource media(shared ? *dispatchers[0] : *dispatchers[1]);
+        CountingSource position(shared ? *dispatchers[0] : *dispatchers[2]);
+        std::atomic<int> results{0};
+
+        std::atomic<bool> quit{false};
+        uint64_t poll_wakes = 0;
+        std::thread platform([&]()
+                             {
+                               pollfd fds[kChannels];
+                               for (int i = 0; i < kChannels; ++i)
+                               {
+                                 fds[i] = pollfd{wakes[i].fd(), POLLIN, 0};
+                               }
+                               while (!quit)
+                               {
+                                 if (poll(fds, kChannels, 10) <= 0)
+                                 {
+                                   continue;
+                                 }
+                                 ++poll_wakes;
+                                 for (int i = 0; i < kChannels; ++i)
+                                 {
+                                   if ((fds[i].revents & POLLIN) && wakes[i].Consume() > 0)
+                                   {
+                                     dispatchers[i]->Drain();
+                                   }
+                                 }
+                               } });
+
+        auto start = Clock::now();
+        auto next = start;
+        for (int ms = 0; ms < 500; ++ms)
+        {
+          position.Send();
+          if (ms % 50 == 0)
+          {
+            media.Send();
+          }
+          if (ms % 20 == 0)
+          {
+            results_dispatcher.Post([&results]()
+                                    { ++results; });
+          }
+          next += 1ms;
+          std::this_thread::sleep_until(next);
+        }
+
+        auto deadline = Clock::now() + 2s;
+        while ((position.delivered < 500 || media.delivered < 10 || results < 25) && Clock::now() < deadline)
+        {
+          std::this_thread::sleep_for(1ms);
+        }
+        quit = true;
+        platform.join();
+
+        EXPECT_EQ(position.delivered, 500);
+        EXPECT_EQ(media.delivered, 10);
+        EXPECT_EQ(results, 25);
+
+        MixedLoadResult result;
+        result.poll_wakes = poll_wakes;
+        for (auto &dispatcher : dispatchers)
+        {
+          if (dispatcher)
+          {
+            result.wakes += dispatcher->WakeCount();
+            result.drains += dispatcher->DrainCount();
+          }
+        }
+        return result;
+      }
+
+      // Queues a fixed batch of results, media and positions before the fake
+      // platform thread looks, then lets it poll and drain once. Unlike
+      // RunMixedLoad, the counts do not depend on timing.
+      MixedLoadResult RunQueuedBatch(bool shared)
+      {
+        constexpr int kChannels = 3;
+        EventFdWake wakes[kChannels];
+        std::unique_ptr<PlatformDispatcher> dispatchers[kChannels];
+        dispatchers[0] = std::make_unique<PlatformDispatcher>(wakes[0]);
+        for (int i = 1; i < kChannels; ++i)
+        {
+          dispatchers[i] = shared ? nullptr : std::make_unique<PlatformDispatcher>(wakes[i]);
+        }
+        CountingSource media(shared ? *dispatchers[0] : *dispatchers[1]);
+        CountingSource position(shared ? *dispatchers[0] : *dispatchers[2]);
+        int results = 0;
+
+        for (int ms = 0; ms < 50; ++ms)
+        {
+          position.Send();
+          if (ms % 50 == 0)
+          {
+            media.Send();
+          }
+          if (ms % 20 == 0)
+          {
+            dispatchers[0]->Post([&results]()
+                                 { ++results; });
+          }
+        }
+
+        MixedLoadResult result;
+        pollfd fds[kChannels];
+        for (int i = 0; i < kChannels; ++i)
+        {
+          fds[i] = pollfd{wakes[i].fd(), POLLIN, 0};
+        }
+        if (poll(fds, kChannels, 0) > 0)
+        {
+          ++result.poll_wakes;
+          for (int i = 0; i < kChannels; ++i)
+          {
+            if ((fds[i].revents & POLLIN) && wakes[i].Consume() > 0)
+            {
+              dispatchers[i]->Drain();
+            }
+          }
+        }
+
+        EXPECT_EQ(position.delivered, 50);
+        EXPECT_EQ(media.delivered, 1);
+        EXPECT_EQ(results, 3);
+
+        for (auto &dispatcher : dispatchers)
+        {
+          if (dispatcher)
+          {
+            result.wakes += dispatcher->WakeCount();
+            result.drains += dispatcher->DrainCount();
+          }
+        }
+        return result;
+      }
+#endif
+
+    } // namespace
+
+    TEST(StreamDeliveryBenchmark, ProducerStallAt1kHz)
+    {
+      auto locked_copy = MeasureProducerStall(false, false);
+      auto swapped_move = MeasureProducerStall(true, true);
+
+      std::printf("%d events of %zu bytes every %lldms, %lldus to encode each\n",
+                  kEvents, kPayloadBytes,
+                  static_cast<long long>(std::chrono::milliseconds(kSendPeriod).count()),
+                  static_cast<long long>(std::chrono::microseconds(kEncodeTime).count()));
+      Print("copy, deliver under lock", locked_copy);
+      Print("move, swap-out drain", swapped_move);
+
+      EXPECT_LT(swapped_move.total, locked_copy.total);
+    }
+
+#if defined(__linux__)
+    TEST(StreamDeliveryBenchmark, SharedDispatcherUnderMixedLoad)
+    {
+      auto separate = RunMixedLoad(false);
+      auto shared = RunMixedLoad(true);
+
+      std::printf("per-stream channels: %llu wake-ups, %llu drains, %llu platform wakes\n",
+                  static_cast<unsigned long long>(separate.wakes),
+                  static_cast<unsigned long long>(separate.drains),
+                  static_cast<unsigned long long>(separate.poll_wakes));
+      std::printf("shared dispatcher: %llu wake-ups, %llu drains, %llu platform wakes\n",
+                  static_cast<unsigned long long>(shared.wakes),
+                  static_cast<unsigned long long>(shared.drains),
+                  static_cast<unsigned long long>(shared.poll_wakes));
+
+      // How many drains the load above takes depends on scheduling, so the
+      // comparison is made on a batch that is queued before any drain.
+      auto separate_batch = RunQueuedBatch(false);
+      auto shared_batch = RunQueuedBatch(true);
+      // One wake-up and one drain per channel with work, whatever the batch
+      // size.
+      EXPECT_EQ(separate_batch.wakes, 3u);
+      EXPECT_EQ(separate_batch.drains, 3u);
+      EXPECT_EQ(shared_batch.wakes, 1u);
+      EXPECT_EQ(shared_batch.drains, 1u);
+    }
+#endif
+
+  } // namespace test
+} // namespace media_notification_service
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "thumbnail_change_detector.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      // A thumbnail stream that counts how many bytes were read from it.
+      struct SyntheticStream
+      {
+        std::string content_type;
+        std::vector<uint8_t> bytes;
+        mutable uint64_t bytes_read = 0;
+
+        std::vector<uint8_t> Read(const SampleRange &range) const
+        {
+          bytes_read += range.length;
+          return std::vector<uint8_t>(bytes.begin() + static_cast<ptrdiff_t>(range.offset),
+                                      bytes.begin() + static_cast<ptrdiff_t>(range.offset + range.length));
+        }
+      };
+
+      SyntheticStream Image(size_t size, uint8_t seed, const std::string &type = "image/jpeg")
+      {
+        SyntheticStream stream{type, std::vector<uint8_t>(size)};
+        uint32_t state = seed + 1u;
+        for (auto &byte : stream.bytes)
+        {
+          state = state * 1664525u + 1013904223u;
+          byte = static_cast<uint8_t>(state >> 24);
+        }
+        return stream;
+      }
+
+      // The manager's flow: stage one, stage two, then a full read only if
+      // needed. Returns whether the art changed.
+      bool CheckArt(ThumbnailChangeDetector &detector, const SyntheticStream &stream)
+      {
+        if (!detector.ShapeDiffers(stream.bytes.size(), stream.content_type))
+        {
+          std::vector<uint8_t> samples;
+          for (const auto &range : ThumbnailChangeDetector::SampleRanges(stream.bytes.size()))
+          {
+            auto part = stream.Read(range);
+            samples.insert(samples.end(), part.begin(), part.end());
+          }
+          if (!detector.SamplesDiffer(samples))
+          {
+            return false;
+          }
+        }
+
+        auto full = stream.Read(SampleRange{0, static_cast<uint32_t>(stream.bytes.size())});
+        detector.Commit(stream.content_type, full);
+        return true;
+      }
+
+    } // namespace
+
+    TEST(ThumbnailChangeDetector, FirstThumbnailIsAlwaysRead)
+    {
+      ThumbnailChangeDetector detector;
+      auto art = Image(50000, 1);
+      EXPECT_TRUE(CheckArt(detector, art));
+      EXPECT_EQ(art.bytes_read, 50000u);
+    }
+
+    TEST(ThumbnailChangeDetector, SameArtReadsOnlyPrefixAndSuffix)
+    {
+      ThumbnailChangeDetector detector;
+      CheckArt(detector, Image(50000, 1));
+
+      // Next track on the same album: identical thumbnail, new stream.
+      auto same = Image(50000, 1);
+      EXPECT_FALSE(CheckArt(detector, same));
+      EXPECT_EQ(same.bytes_read, 2u * ThumbnailChangeDetector::kSampleBytes);
+      EXPECT_EQ(detector.UnchangedCount(), 1u);
+    }
+
+    TEST(ThumbnailChangeDetector, SizeOrTypeChangeSkipsHashing)
+    {
+      ThumbnailChangeDetector detector;
+      CheckArt(detector, Image(50000, 1));
+
+      auto bigger = Image(50001, 1);
+      EXPECT_TRUE(CheckArt(detector, bigger));
+      EXPECT_EQ(bigger.bytes_read, 50001u);
+
+      auto png = Image(50001, 1, "image/png");
+      EXPECT_TRUE(CheckArt(detector, png));
+      EXPECT_EQ(detector.SampleCheckCount(), 0u);
+      EXPECT_EQ(detector.ShapeCheckCount(), 3u);
+    }
+
+    TEST(ThumbnailChangeDetector, PrefixOrSuffixChangeIsCaught)
+    {
+      ThumbnailChangeDetector detector;
+      auto original = Image(50000, 1);
+      CheckArt(detector, original);
+
+      auto header = original;
+      header.bytes[10] ^= 0xff;
+      EXPECT_TRUE(CheckArt(detector, header));
+
+      auto trailer = header;
+      trailer.bytes[49990] ^= 0xff;
+      EXPECT_TRUE(CheckArt(detector, trailer));
+
+      // Same size, different image.
+      EXPECT_TRUE(CheckArt(detector, Image(50000, 2)));
+      EXPECT_EQ(detector.UnchangedCount(), 0u);
+    }
+
+    TEST(ThumbnailChangeDetector, SmallStreamIsComparedWhole)
+    {
+      ThumbnailChangeDetector detector;
+      auto small = Image(3000, 1);
+      CheckArt(detector, small);
+
+      auto ranges = ThumbnailChangeDetector::SampleRanges(3000);
+      ASSERT_EQ(ranges.size(), 1u);
+      EXPECT_EQ(ranges[0].length, 3000u);
+
+      auto edited = small;
+      edited.bytes[1500] ^= 0xff;
+      EXPECT_TRUE(CheckArt(detector, edited));
+    }
+
+    TEST(ThumbnailChangeDetector, MiddleOnlyEditIsTheAcceptedBlindSpot)
+    {
+      ThumbnailChangeDetector detector;
+      auto original = Image(50000, 1);
+      CheckArt(detector, original);
+
+      auto edited = original;
+      edited.bytes[25000] ^= 0xff;
+      EXPECT_FALSE(CheckArt(detector, edited));
+    }
+
+    TEST(ThumbnailChangeDetector, ResetForgetsTheLastThumbnail)
+    {
+      ThumbnailChangeDetector detector;
+      CheckArt(detector, Image(50000, 1));
+      detector.Reset();
+      EXPECT_TRUE(CheckArt(detector, Image(50000, 1)));
+    }
+
+  } // namespace test
+} // namespace media_notification_service
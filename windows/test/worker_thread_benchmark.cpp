@@ -0,0 +1,314 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "worker_thread.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      using Clock = std::chrono::steady_clock;
+
+      // The mutex + condition_variable worker that WorkerThread used to be,
+      // kept here as the baseline.
+      class MutexWorker
+      {
+      public:
+        MutexWorker() : thread_(&MutexWorker::Run, this) {}
+
+        ~MutexWorker()
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+          }
+          cv_.notify_one();
+          thread_.join();
+        }
+
+        void EnqueueTask(std::function<void()> task, TaskPriority = TaskPriority::Metadata)
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push(std::move(task));
+          }
+          cv_.notify_one();
+        }
+
+      private:
+        void Run()
+        {
+          while (true)
+          {
+            std::function<void()> task;
+            {
+              std::unique_lock<std::mutex> lock(mutex_);
+              cv_.wait(lock, [this]
+                       { return stop_ || !queue_.empty(); });
+              if (queue_.empty())
+              {
+                break;
+              }
+              task = std::move(queue_.front());
+              queue_.pop();
+            }
+            task();
+          }
+        }
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::queue<std::function<void()>> queue_;
+        bool stop_ = false;
+        std::thread thread_;
+      };
+
+      constexpr int kProducers = 4;
+      constexpr int kTasksPerProducer = 100000;
+
+      template <typename Worker>
+      double MeasureEnqueueThroughput()
+      {
+        std::atomic<int> ran{0};
+        Clock::duration elapsed;
+        {
+          Worker worker;
+          std::atomic<bool> go{false};
+          std::vector<std::thread> producers;
+          for (int p = 0; p < kProducers; ++p)
+          {
+            producers.emplace_back([&]()
+                                   {
+              while (!go)
+              {
+                std::this_thread::yield();
+              }
+              for (int i = 0; i < kTasksPerProducer; ++i)
+              {
+                worker.EnqueueTask([&ran]()
+                                   { ran.fetch_add(1, std::memory_order_relaxed); },
+                                   TaskPriority::Position);
+              } });
+          }
+
+          auto start = Clock::now();
+          go = true;
+          for (auto &producer : producers)
+          {
+            producer.join();
+          }
+          elapsed = Clock::now() - start;
+        }
+        EXPECT_EQ(ran, kProducers * kTasksPerProducer);
+
+        double seconds = std::chrono::duration<double>(elapsed).count();
+        return kProducers * kTasksPerProducer / seconds;
+      }
+
+      // Time from enqueue on an idle worker until the task starts running.
+      template <typename Worker>
+      Clock::duration MeasureWakeLatency()
+      {
+        Worker worker;
+        std::vector<Clock::duration> samples;
+        for (int i = 0; i < 200; ++i)
+        {
+          std::this_thread::sleep_for(std::chrono::microseconds(500));
+          std::atomic<bool> done{false};
+          Clock::duration latency{};
+          auto enqueued_at = Clock::now();
+          worker.EnqueueTask([&]()
+                             {
+            latency = Clock::now() - enqueued_at;
+            done.store(true, std::memory_order_release); },
+                             TaskPriority::Control);
+          while (!done.load(std::memory_order_acquire))
+          {
+            std::this_thread::yield();
+          }
+          samples.push_back(latency);
+        }
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+      }
+
+      long long ToMicros(Clock::duration d)
+      {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+      }
+
+      constexpr auto kTickPeriod = std::chrono::milliseconds(10);
+      // Three seconds per timer; raise it for soak runs.
+      constexpr int kTimerTicks = 300;
+
+      // The PeriodicTimer that position ticks used to come from: its own
+      // thread, sleeping from the start of each callback, hopping every tick
+      // over to the worker.
+      class ThreadTimer
+      {
+      public:
+        ThreadTimer(WorkerThread &worker, std::function<void()> tick)
+            : worker_(worker), tick_(std::move(tick)), thread_(&ThreadTimer::Run, this) {}
+
+        ~ThreadTimer()
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+          }
+          cv_.notify_one();
+          thread_.join();
+        }
+
+      private:
+        void Run()
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          while (running_)
+          {
+            auto start_time = Clock::now();
+            worker_.EnqueueTask([tick = tick_]()
+                                { tick(); },
+                                TaskPriority::Position);
+            cv_.wait_until(lock, start_time + kTickPeriod, [this]
+                           { return !running_; });
+          }
+        }
+
+        WorkerThread &worker_;
+        std::function<void()> tick_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool running_ = true;
+        std::thread thread_;
+      };
+
+      struct TimerStats
+      {
+        Clock::duration median_error;
+        Clock::duration p99_error;
+        Clock::duration max_error;
+        // How far the last tick is from where a perfect clock would put it.
+        Clock::duration drift;
+      };
+
+      // Collects |ticks| tick times on the worker and compares the spacing
+      // against kTickPeriod.
+      template <typename StartTicking>
+      TimerStats MeasureTimer(int ticks, StartTicking start_ticking)
+      {
+        WorkerThread worker;
+        std::vector<Clock::time_point> fired;
+        fired.reserve(ticks);
+        std::promise<void> done;
+
+        auto stop = start_ticking(worker, [&]()
+                                  {
+          if (static_cast<int>(fired.size()) < ticks)
+          {
+            fired.push_back(Clock::now());
+            if (static_cast<int>(fired.size()) == ticks)
+            {
+              done.set_value();
+            }
+          } });
+        done.get_future().wait();
+        stop();
+        worker.Stop();
+
+        std::vector<Clock::duration> errors;
+        for (size_t i = 1; i < fired.size(); ++i)
+        {
+          auto interval = fired[i] - fired[i - 1];
+          errors.push_back(interval > kTickPeriod ? interval - kTickPeriod : kTickPeriod - interval);
+        }
+        std::sort(errors.begin(), errors.end());
+
+        TimerStats stats;
+        stats.median_error = errors[errors.size() / 2];
+        stats.p99_error = errors[errors.size() * 99 / 100];
+        stats.max_error = errors.back();
+        stats.drift = (fired.back() - fired.front()) - kTickPeriod * (ticks - 1);
+        return stats;
+      }
+
+      void PrintTimerStats(const char *name, const TimerStats &stats)
+      {
+        std::printf("%s: interval error median %lldus, p99 %lldus, max %lldus; drift %lldus\n",
+                    name, ToMicros(stats.median_error), ToMicros(stats.p99_error),
+                    ToMicros(stats.max_error), ToMicros(stats.drift));
+      }
+
+    } // namespace
+
+    TEST(WorkerThreadBenchmark, EnqueueThroughput)
+    {
+      double mutex_rate = MeasureEnqueueThroughput<MutexWorker>();
+      double lock_free_rate = MeasureEnqueueThroughput<WorkerThread>();
+
+      std::printf("enqueue throughput (%d producers): mutex %.0f/s, lock-free %.0f/s\n",
+                  kProducers, mutex_rate, lock_free_rate);
+      RecordProperty("mutex_tasks_per_sec", static_cast<int>(mutex_rate));
+      RecordProperty("lock_free_tasks_per_sec", static_cast<int>(lock_free_rate));
+    }
+
+    TEST(WorkerThreadBenchmark, WakeLatency)
+    {
+      auto mutex_latency = MeasureWakeLatency<MutexWorker>();
+      auto lock_free_latency = MeasureWakeLatency<WorkerThread>();
+
+      std::printf("median wake latency: mutex %lldus, lock-free %lldus\n",
+                  ToMicros(mutex_latency), ToMicros(lock_free_latency));
+      RecordProperty("mutex_wake_us", static_cast<int>(ToMicros(mutex_latency)));
+      RecordProperty("lock_free_wake_us", static_cast<int>(ToMicros(lock_free_latency)));
+    }
+
+    TEST(WorkerThreadBenchmark, TimerAccuracyAndJitter)
+    {
+      int ticks = kTimerTicks;
+
+      auto thread_timer = MeasureTimer(ticks, [](WorkerThread &worker, std::function<void()> tick)
+                                       {
+        auto timer = std::make_shared<ThreadTimer>(worker, std::move(tick));
+        return [timer]() mutable
+        { timer.reset(); }; });
+
+      auto worker_timer = MeasureTimer(ticks, [](WorkerThread &worker, std::function<void()> tick)
+                                       {
+        auto shared_tick = std::make_shared<std::function<void()>>(std::move(tick));
+        auto id = worker.EnqueueEvery(kTickPeriod, [shared_tick]()
+                                      { (*shared_tick)(); });
+        return [&worker, id]()
+        { worker.CancelTimer(id); }; });
+
+      std::printf("%d ticks every %lldms\n", ticks, static_cast<long long>(kTickPeriod.count()));
+      PrintTimerStats("timer thread", thread_timer);
+      PrintTimerStats("worker timer", worker_timer);
+      RecordProperty("thread_timer_p99_us", static_cast<int>(ToMicros(thread_timer.p99_error)));
+      RecordProperty("worker_timer_p99_us", static_cast<int>(ToMicros(worker_timer.p99_error)));
+      RecordProperty("thread_timer_drift_us", static_cast<int>(ToMicros(thread_timer.drift)));
+      RecordProperty("worker_timer_drift_us", static_cast<int>(ToMicros(worker_timer.drift)));
+
+      // Ticks are scheduled from their due time, so they must not drift by
+      // more than a period no matter how long the run.
+      EXPECT_LT(worker_timer.drift, kTickPeriod);
+    }
+
+  } // namespace test
+} // namespace media_notification_service
@@ -0,0 +1,495 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mpsc_queue.h"
+#include "task_queue.h"
+#include "worker_thread.h"
+
+namespace media_notification_service
+{
+  namespace test
+  {
+
+    namespace
+    {
+
+      using Clock = std::chrono::steady_clock;
+
+      // Each background task stands in for a slow album art read.
+      constexpr auto kBackgroundTaskCost = std::chrono::milliseconds(2);
+
+      std::vector<Clock::duration> MeasureCommandLatency(TaskPriority command_priority, int samples)
+      {
+        // Keep roughly 100 background tasks queued for the whole measurement.
+        std::atomic<bool> saturating{true};
+        std::atomic<int> queued{0};
+        WorkerThread worker;
+
+        std::thread producer([&]()
+                             {
+          while (saturating)
+          {
+            if (queued < 100)
+            {
+              ++queued;
+              worker.EnqueueTask([&]()
+                                 {
+                std::this_thread::sleep_for(kBackgroundTaskCost);
+                --queued; },
+                                 TaskPriority::Background);
+            }
+            else
+            {
+              std::this_thread::yield();
+            }
+          } });
+
+        while (queued < 100)
+        {
+          std::this_thread::yield();
+        }
+
+        std::vector<Clock::duration> latencies;
+        for (int i = 0; i < samples; ++i)
+        {
+          std::promise<Clock::duration> done;
+          auto enqueued_at = Clock::now();
+          worker.EnqueueTask([&done, enqueued_at]()
+                             { done.set_value(Clock::now() - enqueued_at); },
+                             command_priority);
+          latencies.push_back(done.get_future().get());
+          std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+
+        saturating = false;
+        producer.join();
+        return latencies;
+      }
+
+    } // namespace
+
+    TEST(MpscQueue, KeepsPerProducerOrderAcrossOverflow)
+    {
+      // A tiny ring forces most pushes through the overflow path.
+      MpscQueue<int> queue(4);
+      constexpr int kProducers = 4;
+      constexpr int kPerProducer = 20000;
+
+      std::vector<std::thread> producers;
+      for (int p = 0; p < kProducers; ++p)
+      {
+        producers.emplace_back([&queue, p]()
+                               {
+          for (int i = 0; i < kPerProducer; ++i)
+          {
+            queue.Push(p * kPerProducer + i);
+          } });
+      }
+
+      std::vector<int> last(kProducers, -1);
+      int received = 0;
+      while (received < kProducers * kPerProducer)
+      {
+        int value;
+        if (!queue.TryPop(value))
+        {
+          std::this_thread::yield();
+          continue;
+        }
+        int producer = value / kPerProducer;
+        ASSERT_GT(value % kPerProducer, last[producer]);
+        last[producer] = value % kPerProducer;
+        ++received;
+      }
+
+      for (auto &producer : producers)
+      {
+        producer.join();
+      }
+      EXPECT_TRUE(queue.Empty());
+    }
+
+    TEST(TaskQueue, PopsHigherLanesFirst)
+    {
+      TaskQueue queue;
+      std::vector<int> order;
+
+      queue.Push([&]()
+                 { order.push_back(3); },
+                 TaskPriority::Background);
+      queue.Push([&]()
+                 { order.push_back(2); },
+                 TaskPriority::Metadata);
+      queue.Push([&]()
+                 { order.push_back(1); },
+                 TaskPriority::Position);
+      queue.Push([&]()
+                 { order.push_back(0); },
+                 TaskPriority::Control);
+      queue.Push([&]()
+                 { order.push_back(4); },
+                 TaskPriority::Background);
+
+      EXPECT_EQ(queue.Size(), 5u);
+      EXPECT_EQ(queue.Size(TaskPriority::Background), 2u);
+
+      Task task;
+      while (queue.TryPop(task))
+      {
+        task();
+      }
+
+      EXPECT_TRUE(queue.Empty());
+      EXPECT_EQ(order, (std::vector<int>{0, 1, 2, 3, 4}));
+    }
+
+    TEST(WorkerThread, RunsQueuedTasksBeforeStopping)
+    {
+      std::atomic<int> ran{0};
+      {
+        WorkerThread worker;
+        for (int i = 0; i < 50; ++i)
+        {
+          worker.EnqueueTask([&]()
+                             { ++ran; },
+                             TaskPriority::Background);
+        }
+      }
+      EXPECT_EQ(ran, 50);
+    }
+
+    TEST(WorkerThread, CoalescesEventBurstIntoOneFetch)
+    {
+      constexpr uint32_t kSongChanged = 1u << 0;
+      std::atomic<int> fetches{0};
+      std::atomic<uint32_t> seen_flags{0};
+
+      WorkerThread worker;
+
+      // Hold the worker so the whole burst lands while the refresh is pending.
+      std::promise<void> gate;
+      auto gate_future = gate.get_future().share();
+      worker.EnqueueTask([gate_future]()
+                         { gate_future.wait(); },
+                         TaskPriority::Control);
+
+      // SessionsChanged, CurrentSessionChanged, MediaPropertiesChanged and
+      // PlaybackInfoChanged, each from its own thread-pool thread.
+      const uint32_t burst[] = {kSongChanged, kSongChanged, kSongChanged, 0};
+      std::vector<std::thread> sources;
+      for (uint32_t flags : burst)
+      {
+        sources.emplace_back([&, flags]()
+                             { worker.EnqueueCoalesced(
+                                   0,
+                                   [&](uint32_t merged)
+                                   {
+                                     ++fetches;
+                                     seen_flags |= merged;
+                                   },
+                                   flags, TaskPriority::Metadata); });
+      }
+      for (auto &source : sources)
+      {
+        source.join();
+      }
+
+      gate.set_value();
+      worker.Stop();
+
+      EXPECT_EQ(fetches, 1);
+      EXPECT_EQ(seen_flags, kSongChanged);
+      EXPECT_EQ(worker.CoalescedCount(), 3u);
+    }
+
+    TEST(WorkerThread, CoalescingKeyIsReleasedOnceTaskStarts)
+    {
+      std::atomic<int> runs{0};
+      WorkerThread worker;
+
+      for (int i = 0; i < 3; ++i)
+      {
+        std::promise<void> done;
+        worker.EnqueueCoalesced(1, [&](uint32_t)
+                                {
+          ++runs;
+          done.set_value(); });
+        done.get_future().wait();
+      }
+
+      EXPECT_EQ(runs, 3);
+      EXPECT_EQ(worker.CoalescedCount(), 0u);
+    }
+
+    TEST(WorkerThread, DelayedTaskRunsOnTheWorkerAfterItsDelay)
+    {
+      WorkerThread worker;
+      std::promise<std::thread::id> worker_id;
+      worker.EnqueueTask([&worker_id]()
+                         { worker_id.set_value(std::this_thread::get_id()); });
+
+      std::promise<std::pair<Clock::time_point, std::thread::id>> fired;
+      auto enqueued_at = Clock::now();
+      worker.EnqueueAfter(std::chrono::milliseconds(30), [&fired]()
+                          { fired.set_value({Clock::now(), std::this_thread::get_id()}); });
+
+      auto [fired_at, fired_on] = fired.get_future().get();
+      EXPECT_GE(fired_at - enqueued_at, std::chrono::milliseconds(30));
+      EXPECT_EQ(fired_on, worker_id.get_future().get());
+    }
+
+    TEST(WorkerThread, RecurringTaskRepeatsUntilCancelled)
+    {
+      std::atomic<int> runs{0};
+      std::promise<void> third_run;
+
+      WorkerThread worker;
+      auto id = worker.EnqueueEvery(std::chrono::milliseconds(5), [&]()
+                                    {
+        if (++runs == 3)
+        {
+          third_run.set_value();
+        } });
+
+      third_run.get_future().wait();
+      worker.CancelTimer(id);
+
+      // Anything queued after the cancel runs after it has been applied.
+      std::promise<int> after_cancel;
+      worker.EnqueueTask([&]()
+                         { after_cancel.set_value(runs); });
+      int runs_at_cancel = after_cancel.get_future().get();
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(30));
+      EXPECT_EQ(runs, runs_at_cancel);
+    }
+
+    TEST(WorkerThread, TimerCanCancelItselfFromItsOwnRun)
+    {
+      std::atomic<int> runs{0};
+      WorkerThread worker;
+      auto id = std::make_shared<std::atomic<WorkerThread::TimerId>>(0);
+
+      std::promise<void> armed;
+      worker.EnqueueTask([&, id]()
+                         {
+        id->store(worker.EnqueueEvery(std::chrono::milliseconds(2), [&, id]()
+                                      {
+          ++runs;
+          worker.CancelTimer(id->load()); }));
+        armed.set_value(); });
+      armed.get_future().wait();
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(40));
+      EXPECT_EQ(runs, 1);
+    }
+
+    TEST(WorkerThread, DueTimerWaitsBehindAControlTask)
+    {
+      WorkerThread worker;
+      std::promise<void> release;
+      auto released = release.get_future().share();
+      std::promise<void> started;
+      worker.EnqueueTask([released, &started]()
+                         {
+        started.set_value();
+        released.wait(); },
+                         TaskPriority::Background);
+      started.get_future().wait();
+
+      std::mutex order_mutex;
+      std::vector<std::string> order;
+      auto record = [&](const char *what)
+      {
+        std::lock_guard<std::mutex> lock(order_mutex);
+        order.push_back(what);
+      };
+      std::promise<void> timer_ran;
+      worker.EnqueueAfter(std::chrono::milliseconds(0), [&]()
+                          {
+        record("timer");
+        timer_ran.set_value(); },
+                          std::chrono::milliseconds::zero(), TaskPriority::Position);
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      worker.EnqueueTask([&]()
+                         { record("control"); },
+                         TaskPriority::Control);
+
+      release.set_value();
+      timer_ran.get_future().wait();
+      EXPECT_EQ(order, (std::vector<std::string>{"control", "timer"}));
+    }
+
+    TEST(WorkerThread, SlackLetsTimersShareAWakeUp)
+    {
+      auto wakes_for = [](std::chrono::milliseconds first_slack)
+      {
+        WorkerThread worker;
+        std::promise<void> both;
+        std::atomic<int> fired{0};
+        auto on_fire = [&]()
+        {
+          if (++fired == 2)
+          {
+            both.set_value();
+          }
+        };
+
+        worker.EnqueueAfter(std::chrono::milliseconds(20), on_fire, first_slack);
+        worker.EnqueueAfter(std::chrono::milliseconds(40), on_fire);
+        both.get_future().wait();
+        return worker.TimerWakeCount();
+      };
+
+      EXPECT_EQ(wakes_for(std::chrono::milliseconds(0)), 2u);
+      EXPECT_EQ(wakes_for(std::chrono::milliseconds(30)), 1u);
+    }
+
+    TEST(WorkerThread, ShutdownDropsStaleTicksWithinBudget)
+    {
+      constexpr auto kBudget = std::chrono::milliseconds(500);
+      std::atomic<int> ticks_run{0};
+      std::atomic<bool> cleaned_up{false};
+
+      WorkerThread worker;
+
+      // The worker is busy with something until shortly after shutdown starts.
+      std::promise<void> gate;
+      auto gate_future = gate.get_future().share();
+      worker.EnqueueTask([gate_future]()
+                         { gate_future.wait(); },
+                         TaskPriority::Control);
+
+      // 10k position ticks that would take ten seconds to run.
+      for (int i = 0; i < 10000; ++i)
+      {
+        worker.EnqueueTask([&]()
+                           {
+          ++ticks_run;
+          std::this_thread::sleep_for(std::chrono::milliseconds(1)); },
+                           TaskPriority::Position);
+      }
+      worker.EnqueueTask([&]()
+                         { cleaned_up = true; },
+                         TaskPriority::Control);
+
+      std::thread releaser([&gate]()
+                           {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        gate.set_value(); });
+      auto report = worker.Shutdown(kBudget);
+      releaser.join();
+
+      EXPECT_FALSE(report.timed_out);
+      EXPECT_LT(report.total, kBudget);
+      EXPECT_TRUE(cleaned_up);
+      EXPECT_EQ(report.cleanup_tasks, 1u);
+      EXPECT_EQ(ticks_run, 0);
+      EXPECT_EQ(report.dropped_tasks, 10000u);
+      EXPECT_GE(report.current_task, std::chrono::milliseconds(10));
+
+      RecordProperty("current_task_us", static_cast<int>(report.current_task.count()));
+      RecordProperty("drop_us", static_cast<int>(report.drop.count()));
+      RecordProperty("cleanup_us", static_cast<int>(report.cleanup.count()));
+
+      // Late producers are turned away instead of queueing forever.
+      worker.EnqueueTask([&]()
+                         { ++ticks_run; },
+                         TaskPriority::Position);
+      EXPECT_EQ(ticks_run, 0);
+    }
+
+    TEST(WorkerThread, ShutdownGivesUpOnAStuckTask)
+    {
+      auto release = std::make_shared<std::promise<void>>();
+      auto released = release->get_future().share();
+      std::promise<void> started;
+
+      auto worker = std::make_unique<WorkerThread>();
+      worker->EnqueueTask([released, &started]()
+                          {
+        started.set_value();
+        released.wait(); },
+                          TaskPriority::Control);
+      started.get_future().wait();
+
+      auto report = worker->Shutdown(std::chrono::milliseconds(50));
+      EXPECT_TRUE(report.timed_out);
+      EXPECT_LT(report.total, std::chrono::milliseconds(500));
+
+      // The detached thread keeps its own state alive past the WorkerThread.
+      worker.reset();
+      release->set_value();
+    }
+
+    TEST(WorkerThread, TimedOutShutdownCleansUpWhileItHoldsItsOwner)
+    {
+      // Stands in for the plugin state that worker tasks reach through a raw
+      // pointer.
+      struct Owner
+      {
+        bool cleaned_up = false;
+        std::promise<bool> destroyed;
+
+        ~Owner() { destroyed.set_value(cleaned_up); }
+      };
+
+      std::promise<void> release;
+      auto released = release.get_future().share();
+      std::promise<void> started;
+      auto owner = std::make_shared<Owner>();
+      auto destroyed = owner->destroyed.get_future();
+
+      auto worker = std::make_unique<WorkerThread>();
+      worker->EnqueueTask([released, &started]()
+                          {
+        started.set_value();
+        released.wait(); },
+                          TaskPriority::Control);
+      started.get_future().wait();
+      worker->EnqueueTask([raw = owner.get()]()
+                          { raw->cleaned_up = true; },
+                          TaskPriority::Control);
+
+      auto report = worker->Shutdown(std::chrono::milliseconds(20), std::move(owner));
+      EXPECT_TRUE(report.timed_out);
+      EXPECT_EQ(report.cleanup_tasks, 0u);
+
+      // The owner returns at the budget; the worker finishes without it.
+      worker.reset();
+      release.set_value();
+      EXPECT_TRUE(destroyed.get());
+    }
+
+    TEST(WorkerThread, ControlLatencyUnderBackgroundSaturation)
+    {
+      auto control = MeasureCommandLatency(TaskPriority::Control, 20);
+      auto fifo = MeasureCommandLatency(TaskPriority::Background, 5);
+
+      auto control_max = *std::max_element(control.begin(), control.end());
+      std::sort(fifo.begin(), fifo.end());
+      auto fifo_median = fifo[fifo.size() / 2];
+
+      auto to_us = [](Clock::duration d)
+      { return std::chrono::duration_cast<std::chrono::microseconds>(d).count(); };
+      RecordProperty("control_max_us", static_cast<int>(to_us(control_max)));
+      RecordProperty("fifo_median_us", static_cast<int>(to_us(fifo_median)));
+
+      // A control task waits for at most the background task that is already
+      // running, while a FIFO command waits behind the whole backlog.
+      EXPECT_LT(control_max, std::chrono::milliseconds(50));
+      EXPECT_GT(fifo_median, control_max);
+    }
+
+  } // namespace test
+} // namespace media_notification_service
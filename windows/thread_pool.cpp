@@ -0,0 +1,102 @@
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#include <winrt/Windows.Foundation.h>
+#endif
+
+namespace media_notification_service
+{
+    ThreadPool::ThreadPool(size_t thread_count) : stop_(false)
+    {
+        if (thread_count == 0)
+        {
+            thread_count = 1;
+        }
+
+        threads_.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i)
+        {
+            threads_.emplace_back(&ThreadPool::WorkerThreadFunc, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        Stop();
+    }
+
+    void ThreadPool::Post(Task task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stop_ && threads_.empty())
+            {
+                return;
+            }
+            tasks_.push(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    void ThreadPool::Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+
+        for (auto &thread : threads_)
+        {
+            if (thread.joinable())
+            {
+                thread.join();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads_.clear();
+        tasks_ = {};
+    }
+
+    size_t ThreadPool::ThreadCount() const
+    {
+        return threads_.size();
+    }
+
+    void ThreadPool::WorkerThreadFunc()
+    {
+#ifdef _WIN32
+        winrt::init_apartment(winrt::apartment_type::multi_threaded);
+#endif
+
+        while (true)
+        {
+            Task task;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]
+                         { return stop_ || !tasks_.empty(); });
+
+                if (tasks_.empty())
+                {
+                    break;
+                }
+
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+
+            if (task)
+            {
+                task();
+            }
+        }
+
+#ifdef _WIN32
+        winrt::uninit_apartment();
+#endif
+    }
+
+} // namespace media_notification_service
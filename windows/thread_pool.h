@@ -0,0 +1,47 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include "inplace_task.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace media_notification_service
+{
+    // Fixed set of MTA threads shared by any number of Strands.
+    class ThreadPool
+    {
+    public:
+        using Task = InplaceTask;
+
+        explicit ThreadPool(size_t thread_count);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        void Post(Task task);
+
+        // Runs everything already posted, then joins the threads. Tasks posted
+        // afterwards are dropped.
+        void Stop();
+
+        size_t ThreadCount() const;
+
+    private:
+        void WorkerThreadFunc();
+
+        std::vector<std::thread> threads_;
+        std::queue<Task> tasks_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool stop_;
+    };
+
+} // namespace media_notification_service
+
+#endif // THREAD_POOL_H_
@@ -0,0 +1,70 @@
+#include "thumbnail_change_detector.h"
+
+namespace media_notification_service
+{
+    namespace
+    {
+        // FNV-1a, 64-bit.
+        constexpr uint64_t kHashSeed = 14695981039346656037ull;
+        constexpr uint64_t kHashPrime = 1099511628211ull;
+    } // namespace
+
+    uint64_t ThumbnailChangeDetector::Hash(const uint8_t *data, size_t size, uint64_t hash)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= data[i];
+            hash *= kHashPrime;
+        }
+        return hash;
+    }
+
+    bool ThumbnailChangeDetector::ShapeDiffers(uint64_t size, const std::string &content_type)
+    {
+        ++shape_checks_;
+        return !committed_ || size != size_ || content_type != content_type_;
+    }
+
+    std::vector<SampleRange> ThumbnailChangeDetector::SampleRanges(uint64_t size)
+    {
+        if (size <= 2 * static_cast<uint64_t>(kSampleBytes))
+        {
+            return {SampleRange{0, static_cast<uint32_t>(size)}};
+        }
+        return {SampleRange{0, kSampleBytes}, SampleRange{size - kSampleBytes, kSampleBytes}};
+    }
+
+    bool ThumbnailChangeDetector::SamplesDiffer(const std::vector<uint8_t> &samples)
+    {
+        ++sample_checks_;
+        if (Hash(samples.data(), samples.size(), kHashSeed) != sample_hash_)
+        {
+            return true;
+        }
+        ++unchanged_;
+        return false;
+    }
+
+    void ThumbnailChangeDetector::Commit(const std::string &content_type, const std::vector<uint8_t> &bytes)
+    {
+        uint64_t hash = kHashSeed;
+        for (const auto &range : SampleRanges(bytes.size()))
+        {
+            hash = Hash(bytes.data() + range.offset, range.length, hash);
+        }
+
+        committed_ = true;
+        size_ = bytes.size();
+        content_type_ = content_type;
+        sample_hash_ = hash;
+    }
+
+    void ThumbnailChangeDetector::Reset()
+    {
+        committed_ = false;
+        size_ = 0;
+        content_type_.clear();
+        sample_hash_ = 0;
+    }
+
+} // namespace media_notification_service
@@ -0,0 +1,65 @@
+#ifndef THUMBNAIL_CHANGE_DETECTOR_H_
+#define THUMBNAIL_CHANGE_DETECTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace media_notification_service
+{
+    struct SampleRange
+    {
+        uint64_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    // Decides whether a new thumbnail differs from the last one sent without
+    // reading all of it. Stage one compares size and content type, which
+    // costs nothing beyond opening the stream. If those match, stage two
+    // hashes a short prefix and suffix: image headers and trailers differ
+    // between almost any two images, even of the same dimensions. Only a
+    // thumbnail that fails both is read in full. An edit confined to the
+    // middle of a same-sized image goes unnoticed; that trade is the point.
+    class ThumbnailChangeDetector
+    {
+    public:
+        static constexpr uint32_t kSampleBytes = 2048;
+
+        // Stage one. True if the thumbnail certainly changed, including when
+        // nothing has been committed yet.
+        bool ShapeDiffers(uint64_t size, const std::string &content_type);
+
+        // What stage two reads: the prefix and the suffix, or the whole
+        // stream as one range when those would overlap.
+        static std::vector<SampleRange> SampleRanges(uint64_t size);
+
+        // Stage two. |samples| holds the SampleRanges bytes back to back.
+        bool SamplesDiffer(const std::vector<uint8_t> &samples);
+
+        // Makes a fully read thumbnail the one to compare against.
+        void Commit(const std::string &content_type, const std::vector<uint8_t> &bytes);
+
+        void Reset();
+
+        uint64_t ShapeCheckCount() const { return shape_checks_; }
+        uint64_t SampleCheckCount() const { return sample_checks_; }
+        // Full reads avoided because both stages matched.
+        uint64_t UnchangedCount() const { return unchanged_; }
+
+    private:
+        static uint64_t Hash(const uint8_t *data, size_t size, uint64_t hash);
+
+        bool committed_ = false;
+        uint64_t size_ = 0;
+        std::string content_type_;
+        uint64_t sample_hash_ = 0;
+
+        uint64_t shape_checks_ = 0;
+        uint64_t sample_checks_ = 0;
+        uint64_t unchanged_ = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // THUMBNAIL_CHANGE_DETECTOR_H_
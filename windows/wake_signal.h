@@ -0,0 +1,19 @@
+#ifndef WAKE_SIGNAL_H_
+#define WAKE_SIGNAL_H_
+
+namespace media_notification_service
+{
+    // Asks a consumer thread to come and drain its queue: a posted window
+    // message on Windows, a fake in tests.
+    class WakeSignal
+    {
+    public:
+        virtual ~WakeSignal() = default;
+
+        // Returns false if the wake-up could not be delivered.
+        virtual bool Wake() = 0;
+    };
+
+} // namespace media_notification_service
+
+#endif // WAKE_SIGNAL_H_
@@ -1,11 +1,32 @@
 #include "worker_thread.h"
+
+#include <algorithm>
+#include <cassert>
+
+#ifdef _WIN32
 #include <winrt/Windows.Foundation.h>
+#endif
 
 namespace media_notification_service
 {
-    WorkerThread::WorkerThread() : stop_worker_(false)
+    namespace
+    {
+        std::chrono::microseconds ElapsedMicros(std::chrono::steady_clock::time_point from,
+                                                std::chrono::steady_clock::time_point to)
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(to - from);
+        }
+
+        template <typename Entry>
+        bool DueLater(const Entry &a, const Entry &b)
+        {
+            return a.due > b.due;
+        }
+    } // namespace
+
+    WorkerThread::WorkerThread() : state_(std::make_shared<State>())
     {
-        thread_ = std::thread(&WorkerThread::WorkerThreadFunc, this);
+        thread_ = std::thread(&WorkerThread::WorkerThreadFunc, state_);
     }
 
     WorkerThread::~WorkerThread()
@@ -13,22 +34,246 @@ namespace media_notification_service
         Stop();
     }
 
-    void WorkerThread::EnqueueTask(Task task)
+    void WorkerThread::EnqueueTask(Task task, TaskPriority priority)
+    {
+        Enqueue(*state_, std::move(task), priority);
+    }
+
+    void WorkerThread::Enqueue(State &state, Task task, TaskPriority priority)
     {
+        if (priority != TaskPriority::Control &&
+            state.shutting_down.load(std::memory_order_acquire))
         {
-            std::lock_guard<std::mutex> lock(queue_mutex_);
-            task_queue_.push(std::move(task));
+            state.rejected_tasks.fetch_add(1, std::memory_order_relaxed);
+            return;
         }
-        queue_cv_.notify_one();
+
+        state.task_queue.Push(std::move(task), priority);
+        state.parker.Unpark();
     }
 
-    void WorkerThread::Stop()
+    void WorkerThread::Lane::Post(InplaceTask task)
+    {
+        Enqueue(state_, std::move(task), priority_);
+    }
+
+    void WorkerThread::EnqueueCoalesced(size_t key, CoalescedTask task, uint32_t flags,
+                                        TaskPriority priority)
+    {
+        assert(key < kMaxCoalesceKeys);
+        CoalesceSlot &slot = state_->coalesce_slots[key];
+
+        // Flags go in before the pending check so that a task which is just
+        // starting either sees them or leaves pending cleared for us.
+        slot.flags.fetch_or(flags);
+        if (slot.pending.exchange(true))
+        {
+            state_->coalesced_count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        // The worker only touches slot.task after dequeuing the task below.
+        slot.task = std::move(task);
+        EnqueueTask([state = state_.get(), key]()
+                    { RunCoalesced(*state, key); },
+                    priority);
+    }
+
+    uint64_t WorkerThread::CoalescedCount() const
+    {
+        return state_->coalesced_count.load(std::memory_order_relaxed);
+    }
+
+    std::shared_ptr<Executor> WorkerThread::LaneExecutor(TaskPriority priority)
+    {
+        return std::shared_ptr<Executor>(state_, &state_->lanes[static_cast<size_t>(priority)]);
+    }
+
+    WorkerThread::TimerId WorkerThread::EnqueueAfter(std::chrono::milliseconds delay, Task task,
+                                                     std::chrono::milliseconds slack,
+                                                     TaskPriority priority)
+    {
+        return AddTimer(delay, std::chrono::milliseconds::zero(), slack, priority, std::move(task));
+    }
+
+    WorkerThread::TimerId WorkerThread::EnqueueEvery(std::chrono::milliseconds period, Task task,
+                                                     std::chrono::milliseconds slack,
+                                                     TaskPriority priority)
+    {
+        return AddTimer(period, period, slack, priority, std::move(task));
+    }
+
+    WorkerThread::TimerId WorkerThread::AddTimer(std::chrono::milliseconds delay,
+                                                 std::chrono::milliseconds period,
+                                                 std::chrono::milliseconds slack, TaskPriority priority,
+                                                 Task task)
+    {
+        TimerId id = state_->next_timer_id.fetch_add(1, std::memory_order_relaxed);
+        TimerEntry entry{std::chrono::steady_clock::now() + delay, slack, period, id, priority};
+
+        {
+            std::lock_guard<std::mutex> lock(state_->timer_mutex);
+            state_->pending_timers.push_back(PendingTimer{entry, std::move(task)});
+            state_->timers_dirty.store(true, std::memory_order_release);
+        }
+        state_->parker.Unpark();
+        return id;
+    }
+
+    void WorkerThread::CancelTimer(TimerId id)
+    {
+        {
+            std::lock_guard<std::mutex> lock(state_->timer_mutex);
+            state_->pending_cancels.push_back(id);
+            state_->timers_dirty.store(true, std::memory_order_release);
+        }
+        state_->parker.Unpark();
+    }
+
+    uint64_t WorkerThread::TimerWakeCount() const
+    {
+        return state_->timer_wake_count.load(std::memory_order_relaxed);
+    }
+
+    void WorkerThread::MergePendingTimers(State &state)
     {
+        std::lock_guard<std::mutex> lock(state.timer_mutex);
+        state.timers_dirty.store(false, std::memory_order_relaxed);
+
+        for (auto &pending : state.pending_timers)
+        {
+            TimerTask &timer = state.timer_tasks[pending.entry.id];
+            timer.task = std::move(pending.task);
+            timer.periodic = pending.entry.period != std::chrono::milliseconds::zero();
+            state.timer_heap.push_back(pending.entry);
+            std::push_heap(state.timer_heap.begin(), state.timer_heap.end(), DueLater<TimerEntry>);
+        }
+        state.pending_timers.clear();
+
+        if (!state.pending_cancels.empty())
         {
-            std::lock_guard<std::mutex> lock(queue_mutex_);
-            stop_worker_ = true;
+            for (TimerId id : state.pending_cancels)
+            {
+                state.timer_tasks.erase(id);
+            }
+            state.pending_cancels.clear();
+
+            // Drop the heap entries too so they cannot cause a wake-up.
+            auto &heap = state.timer_heap;
+            heap.erase(std::remove_if(heap.begin(), heap.end(), [&state](const TimerEntry &entry)
+                                      { return state.timer_tasks.count(entry.id) == 0; }),
+                       heap.end());
+            std::make_heap(heap.begin(), heap.end(), DueLater<TimerEntry>);
         }
-        queue_cv_.notify_one();
+    }
+
+    void WorkerThread::RunDueTimers(State &state)
+    {
+        if (state.timers_dirty.load(std::memory_order_acquire))
+        {
+            MergePendingTimers(state);
+        }
+        if (state.timer_heap.empty())
+        {
+            return;
+        }
+
+        auto &heap = state.timer_heap;
+        auto now = std::chrono::steady_clock::now();
+        while (!heap.empty() && heap.front().due <= now)
+        {
+            std::pop_heap(heap.begin(), heap.end(), DueLater<TimerEntry>);
+            TimerEntry entry = heap.back();
+            heap.pop_back();
+
+            auto it = state.timer_tasks.find(entry.id);
+            if (it == state.timer_tasks.end())
+            {
+                continue;
+            }
+
+            // Into its lane rather than run here, so a due timer never gets
+            // ahead of a queued Control task.
+            if (!it->second.queued)
+            {
+                it->second.queued = true;
+                Enqueue(state, [&state, id = entry.id]()
+                        { RunTimer(state, id); },
+                        entry.priority);
+            }
+
+            if (entry.period == std::chrono::milliseconds::zero())
+            {
+                continue;
+            }
+
+            do
+            {
+                entry.due += entry.period;
+            } while (entry.due <= now);
+            heap.push_back(entry);
+            std::push_heap(heap.begin(), heap.end(), DueLater<TimerEntry>);
+        }
+    }
+
+    void WorkerThread::RunTimer(State &state, TimerId id)
+    {
+        // Cancels made by tasks that ran since this run was queued apply
+        // first.
+        if (state.timers_dirty.load(std::memory_order_acquire))
+        {
+            MergePendingTimers(state);
+        }
+        auto it = state.timer_tasks.find(id);
+        if (it == state.timer_tasks.end())
+        {
+            return;
+        }
+        it->second.queued = false;
+
+        if (!it->second.periodic)
+        {
+            Task task = std::move(it->second.task);
+            state.timer_tasks.erase(it);
+            task();
+            return;
+        }
+
+        // Nothing touches timer_tasks while a timer runs; a cancel from
+        // inside the task is only merged on the next pass.
+        it->second.task();
+    }
+
+    std::chrono::steady_clock::time_point WorkerThread::NextTimerWake(const State &state)
+    {
+        // Waking at the earliest latest-acceptable time lets every timer
+        // whose window has opened by then fire together.
+        auto wake = std::chrono::steady_clock::time_point::max();
+        for (const auto &entry : state.timer_heap)
+        {
+            wake = std::min(wake, entry.due + entry.slack);
+        }
+        return wake;
+    }
+
+    void WorkerThread::RunCoalesced(State &state, size_t key)
+    {
+        CoalesceSlot &slot = state.coalesce_slots[key];
+
+        CoalescedTask task = std::move(slot.task);
+        slot.pending.store(false);
+        uint32_t flags = slot.flags.exchange(0);
+
+        if (task)
+        {
+            task(flags);
+        }
+    }
+
+    void WorkerThread::Stop()
+    {
+        state_->stop_worker.store(true, std::memory_order_release);
+        state_->parker.Unpark();
 
         if (thread_.joinable())
         {
@@ -36,38 +281,151 @@ namespace media_notification_service
         }
     }
 
-    void WorkerThread::WorkerThreadFunc()
+    WorkerThread::ShutdownReport WorkerThread::Shutdown(std::chrono::milliseconds budget,
+                                                        std::shared_ptr<void> keep_alive)
     {
+        auto requested_at = std::chrono::steady_clock::now();
+        ShutdownReport report;
+
+        if (!thread_.joinable())
+        {
+            return report;
+        }
+
+        state_->shutdown_requested_at = requested_at;
+        state_->shutting_down.store(true, std::memory_order_release);
+        state_->parker.Unpark();
+
+        std::unique_lock<std::mutex> lock(state_->shutdown_mutex);
+        bool finished = state_->shutdown_cv.wait_until(lock, requested_at + budget, [this]
+                                                       { return state_->shutdown_finished; });
+        report = state_->shutdown_report;
+
+        if (finished)
+        {
+            lock.unlock();
+            thread_.join();
+        }
+        else
+        {
+            report.timed_out = true;
+            // Published by |abandoned|; the worker reads it only after that.
+            state_->keep_alive = std::move(keep_alive);
+            state_->abandoned.store(true, std::memory_order_release);
+            lock.unlock();
+            thread_.detach();
+        }
+
+        report.dropped_tasks += static_cast<size_t>(state_->rejected_tasks.load(std::memory_order_relaxed));
+        report.total = ElapsedMicros(requested_at, std::chrono::steady_clock::now());
+        return report;
+    }
+
+    void WorkerThread::RunShutdown(State &state)
+    {
+        ShutdownReport report;
+        auto started_at = std::chrono::steady_clock::now();
+        report.current_task = ElapsedMicros(state.shutdown_requested_at, started_at);
+
+        for (size_t lane = 0; lane < kTaskPriorityCount; ++lane)
+        {
+            auto priority = static_cast<TaskPriority>(lane);
+            if (priority != TaskPriority::Control)
+            {
+                report.dropped_tasks += state.task_queue.Clear(priority);
+            }
+        }
+        MergePendingTimers(state);
+        report.dropped_tasks += state.timer_tasks.size();
+        state.timer_tasks.clear();
+        state.timer_heap.clear();
+        auto dropped_at = std::chrono::steady_clock::now();
+        report.drop = ElapsedMicros(started_at, dropped_at);
+
+        // Once abandoned, the Control tasks may only run if the owner left
+        // the worker what they reach.
+        auto stranded = [&state]()
+        {
+            return state.abandoned.load(std::memory_order_acquire) && !state.keep_alive;
+        };
+        Task task;
+        while (!stranded() && state.task_queue.TryPop(task, TaskPriority::Control))
+        {
+            if (task)
+            {
+                task();
+            }
+            task = nullptr;
+            ++report.cleanup_tasks;
+        }
+        report.cleanup = ElapsedMicros(dropped_at, std::chrono::steady_clock::now());
+
+        // Released last, once nothing else runs here.
+        std::shared_ptr<void> keep_alive;
+        {
+            std::lock_guard<std::mutex> lock(state.shutdown_mutex);
+            state.shutdown_report = report;
+            state.shutdown_finished = true;
+            keep_alive = std::move(state.keep_alive);
+        }
+        state.shutdown_cv.notify_all();
+    }
+
+    void WorkerThread::WorkerThreadFunc(std::shared_ptr<State> state)
+    {
+#ifdef _WIN32
         winrt::init_apartment(winrt::apartment_type::multi_threaded);
+#endif
 
         while (true)
         {
+            if (state->shutting_down.load(std::memory_order_acquire))
+            {
+                RunShutdown(*state);
+                break;
+            }
+
+            RunDueTimers(*state);
+
             Task task;
 
+            if (state->task_queue.TryPop(task))
             {
-                std::unique_lock<std::mutex> lock(queue_mutex_);
-                queue_cv_.wait(lock, [this]
-                               { return stop_worker_ || !task_queue_.empty(); });
-
-                if (stop_worker_ && task_queue_.empty())
+                if (task)
                 {
-                    break;
+                    task();
                 }
+                continue;
+            }
 
-                if (!task_queue_.empty())
-                {
-                    task = std::move(task_queue_.front());
-                    task_queue_.pop();
-                }
+            if (state->stop_worker.load(std::memory_order_acquire))
+            {
+                break;
             }
 
-            if (task)
+            state->parker.PrepareToPark();
+            if (!state->task_queue.Empty() ||
+                state->stop_worker.load(std::memory_order_acquire) ||
+                state->shutting_down.load(std::memory_order_acquire) ||
+                state->timers_dirty.load(std::memory_order_acquire))
             {
-                task();
+                state->parker.CancelPark();
+                continue;
+            }
+
+            if (state->timer_heap.empty())
+            {
+                state->parker.Park();
+            }
+            else if (!state->parker.ParkUntil(NextTimerWake(*state)))
+            {
+                state->timer_wake_count.fetch_add(1, std::memory_order_relaxed);
             }
         }
 
+#ifdef _WIN32
         winrt::uninit_apartment();
+#endif
     }
 
-} // namespace media_notification_service
\ No newline at end of file
+} // namespace media_notification_service
@@ -1,18 +1,47 @@
 #ifndef WORKER_THREAD_H_
 #define WORKER_THREAD_H_
 
-#include <thread>
-#include <queue>
-#include <mutex>
+#include "executor.h"
+#include "parker.h"
+#include "task_queue.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <functional>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace media_notification_service
 {
     class WorkerThread
     {
     public:
-        using Task = std::function<void()>;
+        using Task = media_notification_service::Task;
+        using CoalescedTask = InplaceFunction<void(uint32_t flags)>;
+        using TimerId = uint64_t;
+
+        static constexpr size_t kMaxCoalesceKeys = 8;
+
+        struct ShutdownReport
+        {
+            // Time spent waiting for the task that was running when shutdown
+            // was requested.
+            std::chrono::microseconds current_task{0};
+            // Time spent discarding droppable tasks.
+            std::chrono::microseconds drop{0};
+            // Time spent running the remaining Control tasks.
+            std::chrono::microseconds cleanup{0};
+            std::chrono::microseconds total{0};
+
+            size_t dropped_tasks = 0;
+            size_t cleanup_tasks = 0;
+            bool timed_out = false;
+        };
 
         WorkerThread();
         ~WorkerThread();
@@ -20,20 +49,168 @@ namespace media_notification_service
         WorkerThread(const WorkerThread &) = delete;
         WorkerThread &operator=(const WorkerThread &) = delete;
 
-        void EnqueueTask(Task task);
+        void EnqueueTask(Task task, TaskPriority priority = TaskPriority::Metadata);
 
+        // Queues |task| under |key| unless a task with the same key is still
+        // pending, in which case |flags| are OR-ed into the pending one and
+        // |task| is dropped. Tasks sharing a key must therefore only differ in
+        // their flags. The task receives every flag merged into it. |key| must
+        // be below kMaxCoalesceKeys.
+        void EnqueueCoalesced(size_t key, CoalescedTask task, uint32_t flags = 0,
+                              TaskPriority priority = TaskPriority::Metadata);
+
+        // Number of enqueues that were folded into an already pending task.
+        uint64_t CoalescedCount() const;
+
+        // Queues |task| on the |priority| lane once |delay| has passed, so it
+        // waits behind higher priority work like any other task. It may be
+        // queued up to |slack| late so that timers with overlapping windows
+        // share one wake-up. Callable from any thread.
+        TimerId EnqueueAfter(std::chrono::milliseconds delay, Task task,
+                             std::chrono::milliseconds slack = std::chrono::milliseconds::zero(),
+                             TaskPriority priority = TaskPriority::Metadata);
+
+        // Like EnqueueAfter, repeating every |period|. Runs are scheduled from
+        // when the previous one was due, so lateness does not accumulate; runs
+        // missed entirely (e.g. behind a long task, or while the previous one
+        // is still queued) are skipped.
+        TimerId EnqueueEvery(std::chrono::milliseconds period, Task task,
+                             std::chrono::milliseconds slack = std::chrono::milliseconds::zero(),
+                             TaskPriority priority = TaskPriority::Metadata);
+
+        // Applied at the worker's next timer check, so a run that is already in
+        // progress, or just about to start, may still happen once. Called from
+        // a task or timer on the worker, no further run happens.
+        void CancelTimer(TimerId id);
+
+        // Number of times the worker woke because a timer deadline passed.
+        uint64_t TimerWakeCount() const;
+
+        // Executor view of one lane, e.g. for resuming coroutines on the
+        // worker. It shares ownership of the queues, so a late Post (say, from
+        // an async operation completing after the worker went away) is safe;
+        // the task is simply never run.
+        std::shared_ptr<Executor> LaneExecutor(TaskPriority priority);
+
+        // Runs every queued task, then joins the thread.
         void Stop();
 
+        // Bounded shutdown: once the current task returns, everything outside
+        // the Control lane is discarded (and later enqueues of it rejected),
+        // the Control lane is drained, and the thread exits. If that has not
+        // happened within |budget| the thread is detached and left to finish
+        // its current task on its own. Given |keep_alive|, it then holds it
+        // until it exits and still drains the Control lane; without it, it
+        // runs nothing after that task. The worker may hold the last
+        // reference, so whatever |keep_alive| owns may be destroyed on it.
+        ShutdownReport Shutdown(std::chrono::milliseconds budget,
+                                std::shared_ptr<void> keep_alive = nullptr);
+
     private:
-        void WorkerThreadFunc();
+        struct CoalesceSlot
+        {
+            std::atomic<bool> pending{false};
+            std::atomic<uint32_t> flags{0};
+            CoalescedTask task;
+        };
+
+        struct TimerEntry
+        {
+            std::chrono::steady_clock::time_point due;
+            std::chrono::milliseconds slack;
+            std::chrono::milliseconds period;
+            TimerId id;
+            TaskPriority priority;
+        };
+
+        struct TimerTask
+        {
+            Task task;
+            bool periodic = false;
+            // A run is waiting in its lane.
+            bool queued = false;
+        };
+
+        struct PendingTimer
+        {
+            TimerEntry entry;
+            Task task;
+        };
+
+        struct State;
+
+        class Lane : public Executor
+        {
+        public:
+            Lane(State &state, TaskPriority priority) : state_(state), priority_(priority) {}
+
+            void Post(InplaceTask task) override;
+
+        private:
+            State &state_;
+            TaskPriority priority_;
+        };
+
+        // Owned jointly with the thread so that a detached worker keeps a
+        // valid queue to return to.
+        struct State
+        {
+            State()
+                : lanes{Lane(*this, TaskPriority::Control),
+                        Lane(*this, TaskPriority::Position),
+                        Lane(*this, TaskPriority::Metadata),
+                        Lane(*this, TaskPriority::Background)} {}
+
+            TaskQueue task_queue;
+            Parker parker;
+            std::atomic<bool> stop_worker{false};
+
+            std::array<CoalesceSlot, kMaxCoalesceKeys> coalesce_slots;
+            std::atomic<uint64_t> coalesced_count{0};
+
+            std::atomic<bool> shutting_down{false};
+            std::atomic<bool> abandoned{false};
+            std::atomic<uint64_t> rejected_tasks{0};
+            std::chrono::steady_clock::time_point shutdown_requested_at;
+
+            // Timer requests from any thread wait here until the worker picks
+            // them up at the top of its loop.
+            std::mutex timer_mutex;
+            std::vector<PendingTimer> pending_timers;
+            std::vector<TimerId> pending_cancels;
+            std::atomic<bool> timers_dirty{false};
+            std::atomic<TimerId> next_timer_id{1};
+            std::atomic<uint64_t> timer_wake_count{0};
+
+            // Worker only: min-heap on |due|, and the task of each live timer.
+            std::vector<TimerEntry> timer_heap;
+            std::unordered_map<TimerId, TimerTask> timer_tasks;
+
+            std::mutex shutdown_mutex;
+            std::condition_variable shutdown_cv;
+            bool shutdown_finished = false;
+            ShutdownReport shutdown_report;
+            // What a timed-out Shutdown() left the detached thread to hold.
+            std::shared_ptr<void> keep_alive;
+
+            std::array<Lane, kTaskPriorityCount> lanes;
+        };
+
+        static void Enqueue(State &state, Task task, TaskPriority priority);
+        TimerId AddTimer(std::chrono::milliseconds delay, std::chrono::milliseconds period,
+                         std::chrono::milliseconds slack, TaskPriority priority, Task task);
+        static void MergePendingTimers(State &state);
+        static void RunDueTimers(State &state);
+        static void RunTimer(State &state, TimerId id);
+        static std::chrono::steady_clock::time_point NextTimerWake(const State &state);
+        static void WorkerThreadFunc(std::shared_ptr<State> state);
+        static void RunCoalesced(State &state, size_t key);
+        static void RunShutdown(State &state);
 
+        std::shared_ptr<State> state_;
         std::thread thread_;
-        std::queue<Task> task_queue_;
-        std::mutex queue_mutex_;
-        std::condition_variable queue_cv_;
-        bool stop_worker_;
     };
 
 } // namespace media_notification_service
 
-#endif // WORKER_THREAD_H_
\ No newline at end of file
+#endif // WORKER_THREAD_H_